@@ -18,6 +18,7 @@
 
 #include "array.h"
 #include "mpiutil.h"
+#include <sched.h>
 
 static char *rcsid="$Id: array.c,v 1.17 2005/07/20 19:43:19 mfgu Exp $";
 #if __GNUC__ == 2
@@ -39,6 +40,14 @@ static double _totalsize = 0;
 static double _overheadsize = 0;
 static ARRAY *_multistats = NULL;
 
+/* initial table size, first data chunk, max number of chunks,
+   migration chunk, and size of the lock pool of OMULTI */
+#define OMULTI_TSIZE 1024
+#define OMULTI_DBLOCK 256
+#define OMULTI_NCHUNKS 48
+#define OMULTI_MCHUNK 64
+#define OMULTI_NLOCKS 512
+
 //#undef SetLock
 //#define SetLock(x) SetLockWT((x))
 void InitMultiStats(void) {
@@ -58,7 +67,7 @@ void ReportMultiStats(void) {
     MULTI *ma = *pma;
     if (ma == NULL) continue;
     if (ma->numelem > 0) {
-      MPrintf(-1, "idx=%d, id=%s, nd=%d, hs=%d, ne=%d, me=%d, ts=%g, os=%g, ms=%g, c=%d, ch=%g, isize=%d, esize=%d, lock=%x\n", i, ma->id, ma->ndim, ma->hsize, ma->numelem, ma->maxelem, ma->totalsize, ma->overheadsize, ma->maxsize, ma->clean_flag, ma->cth, ma->isize, ma->esize, ma->lock);
+      MPrintf(-1, "idx=%d, id=%s, nd=%d, hs=%d, ne=%d, me=%d, ts=%g, os=%g, ms=%g, c=%d, ch=%g, kp=%g, ev=%ld, isize=%d, esize=%d, lock=%x\n", i, ma->id, ma->ndim, ma->hsize, ma->numelem, ma->maxelem, ma->totalsize, ma->overheadsize, ma->maxsize, ma->clean_flag, ma->cth, ma->keep, ma->nevict, ma->isize, ma->esize, ma->lock);
     }
   }
 }
@@ -77,6 +86,15 @@ void RemoveMultiLocks(void) {
       free(ma->lock);
       ma->lock = NULL;
     }
+#if USE_NMULTI == 3
+    if (ma->olocks) {
+      for (j = 0; j < OMULTI_NLOCKS; j++) {
+	DestroyLock(&ma->olocks[j]);
+      }
+      free(ma->olocks);
+      ma->olocks = NULL;
+    }
+#else
     for (j = 0; j < ma->hsize; j++) {
       ARRAY *a = &ma->array[j];
       if (a->lock) {
@@ -85,6 +103,7 @@ void RemoveMultiLocks(void) {
 	a->lock = NULL;
       }
     }
+#endif
   }
 }
       
@@ -474,6 +493,10 @@ int SMultiInit(MULTI *ma, int esize, int ndim, int *block, char *id) {
   ma->cth = 0;
   ma->clean_mode = -1;
   ma->clean_flag = 0;
+  ma->keep = 0;
+  ma->ostamp = 0;
+  ma->nevict = 0;
+  ma->ElemSize = NULL;
   ma->ndim = ndim;
   ma->esize = esize;
   ma->block = (unsigned short *) malloc(sizeof(unsigned short)*ndim);
@@ -752,6 +775,19 @@ void LimitMultiSize(MULTI *ma, double r) {
   }
 }
 
+/*
+** when the size limit is exceeded, keep the most recently used
+** elements up to the fraction keep of the limit, instead of freeing
+** them all. ElemSize returns the size of the data owned by an
+** element, if any. keep should be less than 1. only the
+** open-addressing implementation evicts this way, the others still
+** free all elements.
+*/
+void SetMultiLRU(MULTI *ma, double keep, int (*ElemSize)(void *)) {
+  ma->keep = keep;
+  ma->ElemSize = ElemSize;
+}
+
 double TotalSize() {
 #if PMALLOC_CHECK == 2
   return (double) msize();
@@ -772,6 +808,85 @@ inline int IdxCmp(int *i0, int *i1, int n) {
   return 0;
 }
 
+/*
+** check whether the MULTI array has outgrown its size limits, free
+** its data if no other thread is using it, and register the calling
+** thread as a user. the caller decrements ma->iset when done.
+*/
+static void MultiCheckClean(MULTI *ma, void (*FreeElem)(void *),
+			    int (*FreeData)(MULTI *, void (*)(void *))) {
+  int clocked = 0;
+  int myrank = MyRankMPI()+1;
+  int cleanmode;
+  cleanmode = ma->clean_mode;
+  if (cleanmode < 0) {
+    if (_maxsize > 0 && ma->cth > 0) {
+      double ts = TotalSize();
+      double ats = TotalArraySize();
+      if (ts >= _maxsize && ma->totalsize > ma->cth*ats) {
+	cleanmode = 1;
+      }
+    } else if (ma->maxsize > 0 && ma->totalsize >= ma->maxsize) {
+      cleanmode = 0;
+    } else if (ma->clean_flag > 0) {
+      cleanmode = 0;
+    }
+  }
+  if (cleanmode >= 0) {
+    if (ma->clean_lock) {
+      SetLock(ma->clean_lock);
+      clocked = 1;
+    }
+    if (ma->iset == 0) {
+      ma->clean_mode = cleanmode;
+      FreeData(ma, FreeElem);
+    }
+  }
+#pragma omp atomic
+  ma->iset += myrank;  
+  if (clocked) {
+    ReleaseLock(ma->clean_lock);
+  }
+}
+
+/*
+** decide whether a clean requested by ma->clean_mode should proceed.
+** must be called with ma->lock held.
+*/
+static int MultiCleanStart(MULTI *ma) {
+  int clean = 1;
+  if (ma->clean_mode == 0) {
+    if (ma->totalsize < ma->maxsize && ma->clean_flag <= 0) clean = 0;
+    if (clean) {
+      MPrintf(-1,
+	      "clean0 %s t=%g o=%g m=%g tt=%g to=%g tm=%g c=%d ch=%g\n",
+	      ma->id, ma->totalsize, ma->overheadsize, ma->maxsize,	    
+	      _totalsize, _overheadsize, _maxsize, ma->clean_flag, ma->cth);
+    }
+  } else if (ma->clean_mode == 1) {
+    double ts = TotalSize();
+    double ats = TotalArraySize();
+    if (ts < _maxsize || ma->totalsize <= ma->cth*ats) clean = 0;
+    if (clean) {
+      MPrintf(-1,
+	      "clean1: %s t=%g o=%g m=%g tt=%g to=%g tm=%g c=%d ch=%g\n",
+	      ma->id, ma->totalsize, ma->overheadsize, ma->maxsize,
+	      _totalsize, _overheadsize, _maxsize, ma->clean_flag, ma->cth);
+    }
+  } else {
+    if (ma->totalsize <= 0 && ma->clean_flag <= 0) clean = 0;
+  }
+  if (clean) {
+    ma->clean_thread = MyRankMPI();
+    if (ma->iset > 0 && ma->clean_mode >= 0) {
+      printf("invalid clean with iset: %s: %d %lud\n",
+	     ma->id, ma->clean_thread, ma->iset);
+      Abort(1);
+    }
+  }
+  return clean;
+}
+
 int NMultiInit(MULTI *ma, int esize, int ndim, int *block, char *id) {
   int i, n, s;
   if (id != NULL) {
@@ -784,6 +899,10 @@ int NMultiInit(MULTI *ma, int esize, int ndim, int *block, char *id) {
   ma->cth = 0;
   ma->clean_mode = -1;
   ma->clean_flag = 0;
+  ma->keep = 0;
+  ma->ostamp = 0;
+  ma->nevict = 0;
+  ma->ElemSize = NULL;
   ma->ndim = ndim;
   ma->isize = sizeof(int)*ndim;
   ma->esize = esize;
@@ -857,41 +976,12 @@ void *NMultiGet(MULTI *ma, int *k, LOCK **lock) {
 void *NMultiSet(MULTI *ma, int *k, void *d, LOCK **lock,
 		void (*InitData)(void *, int),
 		void (*FreeElem)(void *)) {
-  int i, j, m, h, size, locked = 0, clocked = 0;
+  int i, j, m, h, size, locked = 0;
   MDATA *pt;
   ARRAY *a;
   DATA *p, *p0;
-  int myrank = MyRankMPI()+1;
-  int cleanmode;
-  cleanmode = ma->clean_mode;
-  if (cleanmode < 0) {
-    if (_maxsize > 0 && ma->cth > 0) {
-      double ts = TotalSize();
-      double ats = TotalArraySize();
-      if (ts >= _maxsize && ma->totalsize > ma->cth*ats) {
-	cleanmode = 1;
-      }
-    } else if (ma->maxsize > 0 && ma->totalsize >= ma->maxsize) {
-      cleanmode = 0;
-    } else if (ma->clean_flag > 0) {
-      cleanmode = 0;
-    }
-  }
-  if (cleanmode >= 0) {
-    if (ma->clean_lock) {
-      SetLock(ma->clean_lock);
-      clocked = 1;
-    }
-    if (ma->iset == 0) {
-      ma->clean_mode = cleanmode;
-      NMultiFreeData(ma, FreeElem);
-    }
-  }
-#pragma omp atomic
-  ma->iset += myrank;  
-  if (clocked) {
-    ReleaseLock(ma->clean_lock);
-  }
+
+  MultiCheckClean(ma, FreeElem, NMultiFreeData);
 
   h = Hash2(k, ma->ndim, 0, ma->ndim, ma->hmask);
   a = &(ma->array[h]);
@@ -1084,35 +1174,8 @@ int NMultiFreeData(MULTI *ma, void (*FreeElem)(void *)) {
   int i;
 #pragma omp flush
   if (ma->lock) SetLock(ma->lock);
-  int clean = 1;
-  if (ma->clean_mode == 0) {
-    if (ma->totalsize < ma->maxsize && ma->clean_flag <= 0) clean = 0;
-    if (clean) {
-      MPrintf(-1,
-	      "clean0 %s t=%g o=%g m=%g tt=%g to=%g tm=%g c=%d ch=%g\n",
-	      ma->id, ma->totalsize, ma->overheadsize, ma->maxsize,	    
-	      _totalsize, _overheadsize, _maxsize, ma->clean_flag, ma->cth);
-    }
-  } else if (ma->clean_mode == 1) {
-    double ts = TotalSize();
-    double ats = TotalArraySize();
-    if (ts < _maxsize || ma->totalsize <= ma->cth*ats) clean = 0;
-    if (clean) {
-      MPrintf(-1,
-	      "clean1: %s t=%g o=%g m=%g tt=%g to=%g tm=%g c=%d ch=%g\n",
-	      ma->id, ma->totalsize, ma->overheadsize, ma->maxsize,
-	      _totalsize, _overheadsize, _maxsize, ma->clean_flag, ma->cth);
-    }
-  } else {
-    if (ma->totalsize <= 0 && ma->clean_flag <= 0) clean = 0;
-  }
+  int clean = MultiCleanStart(ma);
   if (clean) {
-    ma->clean_thread = MyRankMPI();
-    if (ma->iset > 0 && ma->clean_mode >= 0) {
-      printf("invalid clean with iset: %s: %d %lud\n",
-	     ma->id, ma->clean_thread, ma->iset);
-      Abort(1);
-    }
     for (i = 0; i < ma->hsize; i++) {
       a = &(ma->array[i]);
       if (a->lock) SetLock(a->lock);
@@ -1155,6 +1218,16 @@ int MultiFreeLock(MULTI *ma, void (*FreeElem)(void *)) {
     free(ma->clean_lock);
     ma->clean_lock = NULL;
   }
+#if USE_NMULTI == 3
+  if (ma->olocks) {
+    int i;
+    for (i = 0; i < OMULTI_NLOCKS; i++) {
+      DestroyLock(&ma->olocks[i]);
+    }
+    free(ma->olocks);
+    ma->olocks = NULL;
+  }
+#endif
   return 0;
 }
 
@@ -1170,6 +1243,10 @@ int MMultiInit(MULTI *ma, int esize, int ndim, int *block, char *id) {
   ma->cth = 0;
   ma->clean_mode = -1;
   ma->clean_flag = 0;
+  ma->keep = 0;
+  ma->ostamp = 0;
+  ma->nevict = 0;
+  ma->ElemSize = NULL;
   ma->ndim = ndim;
   ma->ndim1 = ndim-1;
   ma->isize = sizeof(unsigned short)*ndim;
@@ -1357,6 +1434,620 @@ int MMultiFree(MULTI *ma, void (*FreeElem)(void *)) {
   return 0;
 }
 
+/*
+** open-addressing implementation of the MULTI array.
+** the indexes are stored inline in a flat table probed linearly.
+** a slot is claimed with compare-and-swap on its state flag and
+** becomes visible to other threads only when the flag turns READY,
+** so lookups and insertions never take a lock. elements are
+** allocated from chunks that never move, so the returned pointers
+** stay valid when the table grows. the table is doubled when half
+** full, and the old one is migrated a chunk at a time by the
+** threads inserting new elements. the lock returned to the caller
+** is taken from a small pool of recursive locks selected by the
+** hash of the index, instead of allocating one per element.
+*/
+#define OSLOT_EMPTY 0
+#define OSLOT_BUSY 1
+#define OSLOT_READY 2
+#define OSLOT_FROZEN 3
+
+#define OLoad(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define OStore(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define OCas(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+#define OAdd(p, n) __sync_fetch_and_add((p), (n))
+
+typedef struct _OSLOT_ {
+  int state;
+  unsigned int hash;
+  void *data;
+  unsigned int stamp;
+  int index[];
+} OSLOT;
+
+/* time stamp of the last use, only kept if the lru eviction is on */
+#define OTouch(ma, s) \
+  if ((ma)->keep > 0) (s)->stamp = OAdd(&(ma)->ostamp, 1)
+
+#define OSlot(ma, t, i) ((OSLOT *) ((t)->slots + (i)*(ma)->ostride))
+
+/* wait for a slot claimed by another thread to be published. */
+static int OWait(OSLOT *s) {
+  int st, n;
+
+  n = 0;
+  while ((st = OLoad(&s->state)) == OSLOT_BUSY) {
+    if (++n > 64) sched_yield();
+  }
+  return st;
+}
+
+static OTABLE *ONewTable(MULTI *ma, long n) {
+  OTABLE *t;
+  double size;
+
+  t = (OTABLE *) malloc(sizeof(OTABLE));
+  t->size = n;
+  t->mask = n-1;
+  t->nused = 0;
+  t->mpos = 0;
+  t->mdone = 0;
+  t->prev = NULL;
+  t->slots = (char *) calloc(n, ma->ostride);
+  size = sizeof(OTABLE) + ((double)n)*ma->ostride;
+#pragma omp atomic
+  ma->totalsize += size;
+#pragma omp atomic
+  _totalsize += size;
+  return t;
+}
+
+static double OFreeTables(MULTI *ma, OTABLE *t) {
+  OTABLE *p;
+  double size = 0;
+
+  while (t) {
+    p = t->prev;
+    size += sizeof(OTABLE) + ((double)t->size)*ma->ostride;
+    free(t->slots);
+    free(t);
+    t = p;
+  }
+  return size;
+}
+
+/* 
+** 2-dimensional indexes are treated as one 64-bit word, 
+** hashed with the finalizer of MurmurHash3 and compared at once.
+*/
+static unsigned int OHash(MULTI *ma, int *k) {
+  unsigned long long x;
+
+  if (ma->ndim == 2) {
+    memcpy(&x, k, sizeof(x));
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (unsigned int) x;
+  }
+  return (unsigned int) Hash2(k, ma->ndim, 0, ma->ndim, -1);
+}
+
+static inline int OIdxCmp(MULTI *ma, int *i0, int *i1) {
+  unsigned long long x0, x1;
+
+  if (ma->ndim == 2) {
+    memcpy(&x0, i0, sizeof(x0));
+    memcpy(&x1, i1, sizeof(x1));
+    return x0 != x1;
+  }
+  return IdxCmp(i0, i1, ma->ndim);
+}
+
+/*
+** allocate one element from the chunk list. chunk c holds
+** OMULTI_DBLOCK*2^c elements, so the list never needs to be moved.
+*/
+static void *ONewData(MULTI *ma, int locked) {
+  long r, q, i, n;
+  int c;
+  char *p;
+  double size;
+
+  r = OAdd(&ma->ndata, 1);
+  q = r/OMULTI_DBLOCK + 1;
+  c = 8*sizeof(long)-1-__builtin_clzl((unsigned long) q);
+  i = r - OMULTI_DBLOCK*((1L<<c)-1);
+  p = OLoad(&ma->odata[c]);
+  if (p == NULL) {
+    if (ma->lock && !locked) SetLock(ma->lock);
+    p = ma->odata[c];
+    if (p == NULL) {
+      n = ((long)OMULTI_DBLOCK)<<c;
+      p = (char *) malloc(n*ma->dsize);
+      size = ((double)n)*ma->dsize;
+#pragma omp atomic
+      ma->totalsize += size;
+#pragma omp atomic
+      _totalsize += size;
+      OStore(&ma->odata[c], p);
+    }
+    if (ma->lock && !locked) ReleaseLock(ma->lock);
+  }
+  return p + i*ma->dsize;
+}
+
+/*
+** look up index k in table t.
+** returns 1 if found, 0 if absent, -1 if the probe ran into a
+** slot frozen by the migration, in which case the newer table
+** has to be searched instead.
+*/
+static int OFind(MULTI *ma, OTABLE *t, int *k, unsigned int h,
+		 OSLOT **r) {
+  long i, n;
+  int st;
+  OSLOT *s;
+
+  i = h & t->mask;
+  for (n = 0; n < t->size; n++) {
+    s = OSlot(ma, t, i);
+    st = OWait(s);
+    if (st == OSLOT_EMPTY) return 0;
+    if (st == OSLOT_FROZEN) return -1;
+    if (s->hash == h && OIdxCmp(ma, s->index, k) == 0) {
+      *r = s;
+      return 1;
+    }
+    i = (i+1) & t->mask;
+  }
+  return 0;
+}
+
+/*
+** find index k in table t, or claim the first empty slot of its
+** probe sequence. if frz is set, the empty slot is frozen instead,
+** so that no other thread can insert k into this table any more.
+** returns 1 if found, 2 if a slot was claimed and must be filled
+** and published by the caller, 0 if absent and frz is set, -1 if
+** the probe ran into a frozen slot.
+*/
+static int OClaim(MULTI *ma, OTABLE *t, int *k, unsigned int h,
+		  int frz, OSLOT **r) {
+  long i;
+  int st;
+  OSLOT *s;
+
+  i = h & t->mask;
+  while (1) {
+    s = OSlot(ma, t, i);
+    st = OLoad(&s->state);
+    if (st == OSLOT_EMPTY) {
+      if (frz) {
+	if (OCas(&s->state, OSLOT_EMPTY, OSLOT_FROZEN)) return 0;
+      } else {
+	if (OCas(&s->state, OSLOT_EMPTY, OSLOT_BUSY)) {
+	  *r = s;
+	  return 2;
+	}
+      }
+      continue;
+    }
+    if (st == OSLOT_BUSY) st = OWait(s);
+    if (st == OSLOT_FROZEN) return frz?0:-1;
+    if (s->hash == h && OIdxCmp(ma, s->index, k) == 0) {
+      *r = s;
+      return 1;
+    }
+    i = (i+1) & t->mask;
+  }
+}
+
+static void OPublish(MULTI *ma, OTABLE *t, OSLOT *s, int *k,
+		     unsigned int h, void *data, unsigned int stamp) {
+  s->hash = h;
+  s->data = data;
+  s->stamp = stamp;
+  memcpy(s->index, k, ma->isize);
+  OStore(&s->state, OSLOT_READY);
+  OAdd(&t->nused, 1);
+}
+
+/* insert an existing element into table t, if not there yet. */
+static void *OInsertData(MULTI *ma, OTABLE *t, int *k, unsigned int h,
+			 void *data, unsigned int stamp) {
+  OSLOT *s;
+
+  if (OClaim(ma, t, k, h, 0, &s) == 2) {
+    OPublish(ma, t, s, k, h, data, stamp);
+    return data;
+  }
+  return s->data;
+}
+
+/*
+** migrate slots of the old table o into t, one chunk, or all
+** remaining chunks if all is set.
+*/
+static void OMigrate(MULTI *ma, OTABLE *o, OTABLE *t, int all) {
+  long i, i0, i1;
+  int st;
+  OSLOT *s;
+
+  do {
+    i0 = OAdd(&o->mpos, OMULTI_MCHUNK);
+    if (i0 >= o->size) break;
+    i1 = Min(i0 + OMULTI_MCHUNK, o->size);
+    for (i = i0; i < i1; i++) {
+      s = OSlot(ma, o, i);
+      st = OLoad(&s->state);
+      while (st != OSLOT_READY && st != OSLOT_FROZEN) {
+	if (st == OSLOT_EMPTY) {
+	  if (OCas(&s->state, OSLOT_EMPTY, OSLOT_FROZEN)) break;
+	  st = OLoad(&s->state);
+	} else {
+	  st = OWait(s);
+	}
+      }
+      if (st == OSLOT_READY) {
+	OInsertData(ma, t, s->index, s->hash, s->data, s->stamp);
+      }
+    }
+    OAdd(&o->mdone, i1-i0);
+  } while (all);
+}
+
+/* the table being migrated into t, NULL if none. */
+static OTABLE *OMigrating(OTABLE *t) {
+  OTABLE *o = t->prev;
+  if (o && OLoad(&o->mdone) < o->size) return o;
+  return NULL;
+}
+
+static void OGrow(MULTI *ma, OTABLE *t) {
+  OTABLE *n;
+
+  if (ma->lock) SetLock(ma->lock);
+  if (ma->otab == t && OMigrating(t) == NULL) {
+    n = ONewTable(ma, 2*t->size);
+    n->prev = t;
+    OStore(&ma->otab, n);
+    ma->hsize = n->size;
+    ma->hmask = n->mask;
+  }
+  if (ma->lock) ReleaseLock(ma->lock);
+}
+
+int OMultiInit(MULTI *ma, int esize, int ndim, int *block, char *id) {
+  int i, s;
+  if (id != NULL) {
+    strncpy(ma->id, id, MULTI_IDLEN-1);
+  } else {
+    ma->id[0] = '\0';
+  }
+  ma->maxsize = -1;
+  ma->totalsize = 0;
+  ma->overheadsize = 0;
+  ma->numelem = 0;
+  ma->cth = 0;
+  ma->clean_mode = -1;
+  ma->clean_flag = 0;
+  ma->keep = 0;
+  ma->ostamp = 0;
+  ma->nevict = 0;
+  ma->ElemSize = NULL;
+  ma->ndim = ndim;
+  ma->isize = sizeof(int)*ndim;
+  ma->esize = esize;
+  s = sizeof(unsigned short)*ndim;
+  ma->block = (unsigned short *) malloc(s);
+  for (i = 0; i < ndim; i++) ma->block[i] = block[i];
+  ma->overheadsize += s;
+  _overheadsize += s;
+  ma->ostride = sizeof(OSLOT) + ma->isize;
+  ma->ostride = 8*((ma->ostride+7)/8);
+  ma->dsize = 8*((esize+7)/8);
+  ma->ndata = 0;
+  s = sizeof(char *)*OMULTI_NCHUNKS;
+  ma->odata = (char **) malloc(s);
+  for (i = 0; i < OMULTI_NCHUNKS; i++) ma->odata[i] = NULL;
+  ma->overheadsize += s;
+  _overheadsize += s;
+  ma->otab = ONewTable(ma, OMULTI_TSIZE);
+  ma->hsize = ma->otab->size;
+  ma->hmask = ma->otab->mask;
+  ma->array = NULL;
+#if USE_MPI == 2
+  ma->lock = (LOCK *) malloc(sizeof(LOCK));
+  if (0 != InitLock(ma->lock)) {
+    printf("cannot InitLock0 in OMultiInit: %s\n", ma->id);
+    free(ma->lock);
+    ma->lock = NULL;
+    Abort(1);
+  }
+
+  ma->clean_lock = (LOCK *) malloc(sizeof(LOCK));
+  if (0 != InitLock(ma->clean_lock)) {
+    printf("cannot InitLock1 in OMultiInit: %s\n", ma->id);
+    free(ma->clean_lock);
+    ma->clean_lock = NULL;
+    Abort(1);
+  }
+
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  s = sizeof(LOCK)*OMULTI_NLOCKS;
+  ma->olocks = (LOCK *) malloc(s);
+  for (i = 0; i < OMULTI_NLOCKS; i++) {
+    if (0 != pthread_mutex_init(&ma->olocks[i], &attr)) {
+      printf("cannot InitLock2 in OMultiInit: %s\n", ma->id);
+      Abort(1);
+    }
+  }
+  pthread_mutexattr_destroy(&attr);
+  ma->overheadsize += s;
+  _overheadsize += s;
+#else
+  ma->lock = NULL;
+  ma->clean_lock = NULL;
+  ma->olocks = NULL;
+#endif
+  if (_multistats != NULL && ma->id[0]) {
+    ArrayAppend(_multistats, &ma, InitPointerData);    
+  }
+  ma->iset = 0;
+  return 0;
+}
+
+void *OMultiGet(MULTI *ma, int *k, LOCK **lock) {
+  OTABLE *t, *o;
+  OSLOT *s;
+  unsigned int h;
+  int r;
+
+  h = OHash(ma, k);
+  while (1) {
+    t = OLoad(&ma->otab);
+    o = OMigrating(t);
+    r = OFind(ma, t, k, h, &s);
+    if (r < 0) continue;
+    if (r == 0 && o != NULL) {
+      r = OFind(ma, o, k, h, &s);
+    }
+    break;
+  }
+  if (r <= 0) return NULL;
+  OTouch(ma, s);
+  if (lock && ma->olocks) *lock = &ma->olocks[h&(OMULTI_NLOCKS-1)];
+  return s->data;
+}
+
+void *OMultiSet(MULTI *ma, int *k, void *d, LOCK **lock,
+		void (*InitData)(void *, int),
+		void (*FreeElem)(void *)) {
+  OTABLE *t, *o;
+  OSLOT *s;
+  unsigned int h;
+  void *data;
+  int r;
+
+  MultiCheckClean(ma, FreeElem, OMultiFreeData);
+
+  h = OHash(ma, k);
+  while (1) {
+    t = OLoad(&ma->otab);
+    o = OMigrating(t);
+    if (o != NULL) {
+      OMigrate(ma, o, t, 2*t->nused > t->size);
+    }
+    r = OFind(ma, t, k, h, &s);
+    if (r < 0) continue;
+    if (r > 0) {
+      OTouch(ma, s);
+      data = s->data;
+      break;
+    }
+    if (o != NULL) {
+      r = OClaim(ma, o, k, h, 1, &s);
+      if (r > 0) {
+	OTouch(ma, s);
+	data = OInsertData(ma, t, k, h, s->data, s->stamp);
+	break;
+      }
+    }
+    if (4*OLoad(&t->nused) > 3*t->size) {
+      /* the migration into t lags behind, wait for it and grow */
+      if (OMigrating(t)) sched_yield();
+      else OGrow(ma, t);
+      continue;
+    }
+    r = OClaim(ma, t, k, h, 0, &s);
+    if (r < 0) continue;
+    if (r == 1) {
+      OTouch(ma, s);
+      data = s->data;
+      break;
+    }
+    data = ONewData(ma, 0);
+    if (InitData) InitData(data, 1);
+    OPublish(ma, t, s, k, h, data,
+	     ma->keep > 0 ? OAdd(&ma->ostamp, 1) : 0);
+#pragma omp atomic
+    ma->numelem++;
+    if (2*t->nused > t->size) {
+      OGrow(ma, t);
+    }
+    break;
+  }
+  if (d) memcpy(data, d, ma->esize);
+  if (lock) {
+    if (ma->olocks) *lock = &ma->olocks[h&(OMULTI_NLOCKS-1)];
+    else *lock = NULL;
+  }
+  return data;
+}
+
+static int OStampCmp(const void *p1, const void *p2) {
+  unsigned int s1, s2;
+
+  s1 = (*((OSLOT **) p1))->stamp;
+  s2 = (*((OSLOT **) p2))->stamp;
+  if (s1 > s2) return -1;
+  if (s1 < s2) return 1;
+  return 0;
+}
+
+/*
+** evict the least recently used elements, keeping the newer ones
+** that fit in the fraction ma->keep of the size limit, or of the
+** current size if the clean was not caused by the limit. the kept
+** elements are copied into new chunks and a new table, so the
+** memory of the evicted ones is returned. must be called with
+** ma->lock held and no other thread using the array.
+*/
+static void OEvict(MULTI *ma, void (*FreeElem)(void *)) {
+  OTABLE *t, *o;
+  OSLOT *s, **sp;
+  char *odata[OMULTI_NCHUNKS];
+  long i, n, m, q;
+  double size, limit, esize;
+  void *d;
+  int c;
+
+  t = ma->otab;
+  o = OMigrating(t);
+  if (o != NULL) OMigrate(ma, o, t, 1);
+  sp = (OSLOT **) malloc(sizeof(OSLOT *)*(t->nused+1));
+  n = 0;
+  for (i = 0; i < t->size; i++) {
+    s = OSlot(ma, t, i);
+    if (s->state == OSLOT_READY) sp[n++] = s;
+  }
+  qsort(sp, n, sizeof(OSLOT *), OStampCmp);
+  if (ma->clean_mode == 0 && ma->maxsize > 0) limit = ma->keep*ma->maxsize;
+  else limit = ma->keep*ma->totalsize;
+  size = 0;
+  for (m = 0; m < n; m++) {
+    esize = ma->dsize + 2.0*ma->ostride;
+    if (ma->ElemSize) esize += ma->ElemSize(sp[m]->data);
+    if (size + esize > limit) break;
+    size += esize;
+  }
+  /* if all would fit, evict the older half, so that a limit dominated
+     by the table overhead does not make the cleans no-ops */
+  if (m >= n) m = n/2;
+  memcpy(odata, ma->odata, sizeof(char *)*OMULTI_NCHUNKS);
+  for (c = 0; c < OMULTI_NCHUNKS; c++) ma->odata[c] = NULL;
+  ma->ndata = 0;
+  q = OMULTI_TSIZE;
+  while (q < 2*m+2) q *= 2;
+  ma->otab = ONewTable(ma, q);
+  for (i = 0; i < m; i++) {
+    s = sp[i];
+    d = ONewData(ma, 1);
+    memcpy(d, s->data, ma->esize);
+    OInsertData(ma, ma->otab, s->index, s->hash, d, s->stamp);
+  }
+  size = 0;
+  for (i = m; i < n; i++) {
+    if (ma->ElemSize) size += ma->ElemSize(sp[i]->data);
+    if (FreeElem) FreeElem(sp[i]->data);
+  }
+  free(sp);
+  for (c = 0; c < OMULTI_NCHUNKS && odata[c]; c++) {
+    size += ((double)(((long)OMULTI_DBLOCK)<<c))*ma->dsize;
+    free(odata[c]);
+  }
+  size += OFreeTables(ma, t);
+  ma->totalsize -= size;
+  _totalsize -= size;
+  ma->hsize = ma->otab->size;
+  ma->hmask = ma->otab->mask;
+  ma->numelem = m;
+  ma->nevict += n-m;
+}
+
+int OMultiFreeData(MULTI *ma, void (*FreeElem)(void *)) {
+  long r, q, i, n;
+  int c;
+#pragma omp flush
+  if (ma->lock) SetLock(ma->lock);
+  int clean = MultiCleanStart(ma);
+  if (clean && ma->keep > 0 && ma->clean_mode >= 0) {
+    OEvict(ma, FreeElem);
+    ma->clean_flag = 0;
+  } else if (clean) {
+    r = 0;
+    for (c = 0; c < OMULTI_NCHUNKS && ma->odata[c]; c++) {
+      n = ((long)OMULTI_DBLOCK)<<c;
+      if (FreeElem) {
+	q = Min(n, ma->ndata - r);
+	for (i = 0; i < q; i++) {
+	  FreeElem(ma->odata[c] + i*ma->dsize);
+	}
+      }
+      r += n;
+      free(ma->odata[c]);
+      ma->odata[c] = NULL;
+    }
+    ma->ndata = 0;
+    OFreeTables(ma, ma->otab);
+    _totalsize -= ma->totalsize;
+    ma->totalsize = 0;
+    ma->otab = ONewTable(ma, OMULTI_TSIZE);
+    ma->hsize = ma->otab->size;
+    ma->hmask = ma->otab->mask;
+    ma->numelem = 0;
+    ma->clean_flag = 0;
+  }
+  ma->clean_mode = -1;
+#pragma omp flush
+  if (ma->lock) ReleaseLock(ma->lock);
+  return 0;
+}
+
+int OMultiFree(MULTI *ma, void (*FreeElem)(void *)) {
+  double size;
+  if (!ma) return 0;
+  if (ma->ndim <= 0) return 0;
+  OMultiFreeData(ma, FreeElem);
+  size = OFreeTables(ma, ma->otab);
+  ma->totalsize -= size;
+  _totalsize -= size;
+  ma->otab = NULL;
+  free(ma->odata);
+  ma->odata = NULL;
+  free(ma->block);
+  ma->block = NULL;
+  ma->ndim = 0;
+  ma->iset = 0;
+  return 0;
+}
+
+typedef union _MKEY64_ {
+  unsigned long long k;
+  int i[2];
+} MKEY64;
+
+void *MultiGet64(MULTI *ma, unsigned long long k, LOCK **lock) {
+  MKEY64 x;
+
+  x.k = k;
+  return MultiGet(ma, x.i, lock);
+}
+
+void *MultiSet64(MULTI *ma, unsigned long long k, void *d, LOCK **lock,
+		 void (*InitData)(void *, int),
+		 void (*FreeElem)(void *)) {
+  MKEY64 x;
+
+  x.k = k;
+  return MultiSet(ma, x.i, d, lock, InitData, FreeElem);
+}
+
 void InitIdxAry(IDXARY *ia, int n, int *d) {
   int k;
   ia->n = n;
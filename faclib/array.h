@@ -78,7 +78,7 @@
 
 #include "global.h"
 
-#define USE_NMULTI 1
+#define USE_NMULTI 3
 
 /* choose MULTI implementation */
 #if USE_NMULTI == 1
@@ -93,6 +93,12 @@
 #define MultiSet SMultiSet
 #define MultiFreeData SMultiFreeData
 #define MultiFree SMultiFree
+#elif USE_NMULTI == 3
+#define MultiInit OMultiInit
+#define MultiGet OMultiGet
+#define MultiSet OMultiSet
+#define MultiFreeData OMultiFreeData
+#define MultiFree OMultiFree
 #else
 #define MultiInit MMultiInit
 #define MultiGet MMultiGet
@@ -137,6 +143,32 @@ typedef struct _ARRAY_ {
   LOCK *lock;
 } ARRAY;
 
+/*
+** STRUCT:      OTABLE
+** PURPOSE:     flat open-addressed hash table of the OMULTI array.
+** FIELDS:      {long size, mask},
+**              number of slots, a power of 2, and size-1.
+**              {long nused},
+**              number of occupied slots.
+**              {long mpos, mdone},
+**              migration cursor and number of migrated slots
+**              when the table is being replaced by a larger one.
+**              {char *slots},
+**              the slots, each holding a state flag, the hash,
+**              the data pointer and the index inline.
+**              {OTABLE *prev},
+**              the smaller table migrated into this one, which
+**              links to the older retired tables in turn.
+** NOTE:        the retired tables are freed with the data.
+*/
+typedef struct _OTABLE_ {
+  long size, mask;
+  long nused;
+  long mpos, mdone;
+  char *slots;
+  struct _OTABLE_ *prev;
+} OTABLE;
+
 /*
 ** STRUCT:      MULTI
 ** PURPOSE:     a multi-dimensional array.
@@ -166,6 +198,15 @@ typedef struct _MULTI_ {
   ARRAY *array;
   ARRAY *ia, *da;
   LOCK *lock, *clean_lock;
+  int ostride, dsize;
+  long ndata;
+  char **odata;
+  OTABLE *otab;
+  LOCK *olocks;
+  double keep;
+  unsigned int ostamp;
+  long nevict;
+  int (*ElemSize)(void *);
 } MULTI;
 
 typedef struct _IDXARY_ {
@@ -233,8 +274,30 @@ void *MMultiSet(MULTI *ma, int *k, void *d, LOCK **lock,
 int   MMultiFree(MULTI *ma, 
 		 void (*FreeElem)(void *));
 int   MMultiFreeData(MULTI *ma, void (*FreeElem)(void *));
+/*
+** open-addressing implementation of MULTI array, with lock-free
+** lookup and insertion.
+*/
+int   OMultiInit(MULTI *ma, int esize, int ndim, int *block, char *id);
+void *OMultiGet(MULTI *ma, int *k, LOCK **lock);
+void *OMultiSet(MULTI *ma, int *k, void *d, LOCK **lock,
+		void (*InitData)(void *, int),
+		void (*FreeElem)(void *));
+int   OMultiFree(MULTI *ma, 
+		 void (*FreeElem)(void *));
+int   OMultiFreeData(MULTI *ma, void (*FreeElem)(void *));
+
+/*
+** access a 2-dimensional MULTI array with the index packed into
+** a single 64-bit key. only for the hashed implementations.
+*/
+void *MultiGet64(MULTI *ma, unsigned long long k, LOCK **lock);
+void *MultiSet64(MULTI *ma, unsigned long long k, void *d, LOCK **lock,
+		 void (*InitData)(void *, int),
+		 void (*FreeElem)(void *));
 void AddMultiSize(MULTI *ma, int size);
 void LimitMultiSize(MULTI *ma, double d);
+void SetMultiLRU(MULTI *ma, double keep, int (*ElemSize)(void *));
 
 void  InitIntData(void *p, int n);
 void  InitDoubleData(void *p, int n);
@@ -251,6 +251,13 @@
 		  INT, DOUBLEV, INT, DOUBLE, DOUBLEV, INT,\
 		  A1,A2,A3,A4,A5,A6,A7,A8,A9,A10,A11)
 
+     PROTOCCALLSFSUB13(DGEMM, dgemm, STRING, STRING, INT, INT, INT, DOUBLE,\
+		       DOUBLEV, INT, DOUBLEV, INT, DOUBLE, DOUBLEV, INT)
+#define DGEMM(A1,A2,A3,A4,A5,A6,A7,A8,A9,A10,A11,A12,A13)\
+     CCALLSFSUB13(DGEMM, dgemm, STRING, STRING, INT, INT, INT, DOUBLE,\
+		  DOUBLEV, INT, DOUBLEV, INT, DOUBLE, DOUBLEV, INT,\
+		  A1,A2,A3,A4,A5,A6,A7,A8,A9,A10,A11,A12,A13)
+
      PROTOCCALLSFSUB11(DSBEV, dsbev, STRING, STRING, INT, INT, DOUBLEV,\
 		       INT, DOUBLEV, DOUBLEV, INT, DOUBLEV, INTV)
 #define DSBEV(A1,A2,A3,A4,A5,A6,A7,A8,A9,A10,A11)\
@@ -273,6 +280,72 @@
 		 DOUBLEV, DOUBLEV, INT, DOUBLEV, INTV,\
 		 A1,A2,A3,A4,A5,A6,A7,A8,A9)
 
+     PROTOCCALLSFSUB10(DSYTRD, dsytrd, STRING, INT, DOUBLEV, INT,\
+		       DOUBLEV, DOUBLEV, DOUBLEV, DOUBLEV, INT, INTV)
+#define DSYTRD(A1,A2,A3,A4,A5,A6,A7,A8,A9,A10)\
+     CCALLSFSUB10(DSYTRD, dsytrd, STRING, INT, DOUBLEV, INT,\
+		  DOUBLEV, DOUBLEV, DOUBLEV, DOUBLEV, INT, INTV,\
+		  A1,A2,A3,A4,A5,A6,A7,A8,A9,A10)
+
+     PROTOCCALLSFSUB11(DSTEDC, dstedc, STRING, INT, DOUBLEV, DOUBLEV,\
+		       DOUBLEV, INT, DOUBLEV, INT, INTV, INT, INTV)
+#define DSTEDC(A1,A2,A3,A4,A5,A6,A7,A8,A9,A10,A11)\
+     CCALLSFSUB11(DSTEDC, dstedc, STRING, INT, DOUBLEV, DOUBLEV,\
+		  DOUBLEV, INT, DOUBLEV, INT, INTV, INT, INTV,\
+		  A1,A2,A3,A4,A5,A6,A7,A8,A9,A10,A11)
+
+     PROTOCCALLSFSUB13(DORMTR, dormtr, STRING, STRING, STRING, INT, INT,\
+		       DOUBLEV, INT, DOUBLEV, DOUBLEV, INT, DOUBLEV, INT,\
+		       INTV)
+#define DORMTR(A1,A2,A3,A4,A5,A6,A7,A8,A9,A10,A11,A12,A13)\
+     CCALLSFSUB13(DORMTR, dormtr, STRING, STRING, STRING, INT, INT,\
+		  DOUBLEV, INT, DOUBLEV, DOUBLEV, INT, DOUBLEV, INT,\
+		  INTV, A1,A2,A3,A4,A5,A6,A7,A8,A9,A10,A11,A12,A13)
+
+#ifdef USE_SCALAPACK
+     PROTOCCALLSFSUB3(BLACS_GET, blacs_get, INT, INT, INTV)
+#define BLACS_GET(A1,A2,A3)\
+     CCALLSFSUB3(BLACS_GET, blacs_get, INT, INT, INTV, A1,A2,A3)
+
+     PROTOCCALLSFSUB4(BLACS_GRIDINIT, blacs_gridinit, INTV, STRING, INT, INT)
+#define BLACS_GRIDINIT(A1,A2,A3,A4)\
+     CCALLSFSUB4(BLACS_GRIDINIT, blacs_gridinit, INTV, STRING, INT, INT,\
+		 A1,A2,A3,A4)
+
+     PROTOCCALLSFSUB5(BLACS_GRIDINFO, blacs_gridinfo, INT, INTV, INTV,\
+		      INTV, INTV)
+#define BLACS_GRIDINFO(A1,A2,A3,A4,A5)\
+     CCALLSFSUB5(BLACS_GRIDINFO, blacs_gridinfo, INT, INTV, INTV,\
+		 INTV, INTV, A1,A2,A3,A4,A5)
+
+     PROTOCCALLSFFUN5(INT, NUMROC, numroc, INT, INT, INT, INT, INT)
+#define NUMROC(A1,A2,A3,A4,A5)\
+     CCALLSFFUN5(NUMROC, numroc, INT, INT, INT, INT, INT, A1,A2,A3,A4,A5)
+
+     PROTOCCALLSFSUB10(DESCINIT, descinit, INTV, INT, INT, INT, INT,\
+		       INT, INT, INT, INT, INTV)
+#define DESCINIT(A1,A2,A3,A4,A5,A6,A7,A8,A9,A10)\
+     CCALLSFSUB10(DESCINIT, descinit, INTV, INT, INT, INT, INT,\
+		  INT, INT, INT, INT, INTV,\
+		  A1,A2,A3,A4,A5,A6,A7,A8,A9,A10)
+
+     PROTOCCALLSFSUB17(PDSYEVD, pdsyevd, STRING, STRING, INT, DOUBLEV,\
+		       INT, INT, INTV, DOUBLEV, DOUBLEV, INT, INT, INTV,\
+		       DOUBLEV, INT, INTV, INT, INTV)
+#define PDSYEVD(A1,A2,A3,A4,A5,A6,A7,A8,A9,A10,A11,A12,A13,A14,A15,A16,A17)\
+     CCALLSFSUB17(PDSYEVD, pdsyevd, STRING, STRING, INT, DOUBLEV,\
+		  INT, INT, INTV, DOUBLEV, DOUBLEV, INT, INT, INTV,\
+		  DOUBLEV, INT, INTV, INT, INTV,\
+		  A1,A2,A3,A4,A5,A6,A7,A8,A9,A10,A11,A12,A13,A14,A15,A16,A17)
+
+     PROTOCCALLSFSUB11(PDGEMR2D, pdgemr2d, INT, INT, DOUBLEV, INT, INT,\
+		       INTV, DOUBLEV, INT, INT, INTV, INT)
+#define PDGEMR2D(A1,A2,A3,A4,A5,A6,A7,A8,A9,A10,A11)\
+     CCALLSFSUB11(PDGEMR2D, pdgemr2d, INT, INT, DOUBLEV, INT, INT,\
+		  INTV, DOUBLEV, INT, INT, INTV, INT,\
+		  A1,A2,A3,A4,A5,A6,A7,A8,A9,A10,A11)
+#endif
+
      PROTOCCALLSFSUB14(DGEEV, dgeev, STRING, STRING, INT, DOUBLEV, INT,	\
 		       DOUBLEV, DOUBLEV, DOUBLEV, INT, DOUBLEV, INT, DOUBLEV, \
 		       INT, INTV)
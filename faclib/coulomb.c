@@ -41,7 +41,9 @@ static int dipole_nmax = 0;
 static double **dipole_array = NULL;
 
 static int _cbindex[CBMULT][CBMULT+1];
-static double *_cb[MAXNE][MAXNTE][MAXNE][MAXNCB];
+/* coulomb-bethe tails, MAXNCB per (ie2, ite, ie1) of the last grids */
+static double **_cb = NULL;
+static int _ncb[3] = {0, 0, 0};
 
 void SetHydrogenicNL(int n, int kl, int nm, int klm) {
   if (n > 0) n_hydrogenic = n;
@@ -537,8 +539,12 @@ double CoulombPhaseShift(double z, double e, int kappa) {
   return phase;
 }
 
+static double **CBArray(int ie2, int ite, int ie1) {
+  return _cb + ((ie2*_ncb[1] + ite)*_ncb[2] + ie1)*MAXNCB;
+}
+
 double *GetCoulombBethe(int ie2, int ite, int ie1, int t, int q) {
-  return _cb[ie2][ite][ie1][_cbindex[t-1][q]];
+  return CBArray(ie2, ite, ie1)[_cbindex[t-1][q]];
 }
 
 double GetCoulombBetheAsymptotic(double te, double e1) {
@@ -678,26 +684,21 @@ int PrepCoulombBethe(int ne2, int nte, int ne1, double z,
   double w2, w3, *wr, *ws, *wt, *w, *tcb, *r[CBMULT];
   double bms;
   
-  if (ne2 > MAXNE || ne1 > MAXNE || nte > MAXNTE) {
-    printf("Array multipoles not large enough in CoulombMultipoles\n");
-    exit(1);
-  }
   bms = MColl();
   if (bms <= 0) bms = 1.0;
   for (i = 0; i < CBMULT; i++) {
     r[i] = malloc(sizeof(double)*(i+2)*(CBLMAX+1));
   }
-  for (ie2 = 0; ie2 < MAXNE; ie2++) {
-    for (ite = 0; ite < MAXNTE; ite++) {
-      for (ie1 = 0; ie1 < MAXNE; ie1++) {
-	for (i = 0; i < MAXNCB; i++) {
-	  free(_cb[ie2][ite][ie1][i]);
-	  _cb[ie2][ite][ie1][i] = malloc(sizeof(double)*nkl);
-	  for (ik = 0; ik < nkl; ik++) {
-	    _cb[ie2][ite][ie1][i][ik] = 0.0;
-	  }
-	}
-      }
+  FreeCoulombBethe();
+  _ncb[0] = ne2;
+  _ncb[1] = nte;
+  _ncb[2] = ne1;
+  m = ne2*nte*ne1*MAXNCB;
+  _cb = malloc(sizeof(double *)*m);
+  for (i = 0; i < m; i++) {
+    _cb[i] = malloc(sizeof(double)*nkl);
+    for (ik = 0; ik < nkl; ik++) {
+      _cb[i][ik] = 0.0;
     }
   }
   
@@ -724,7 +725,7 @@ int PrepCoulombBethe(int ne2, int nte, int ne1, double z,
 	  a = a/(1-a);
 	  for (i = 0; i < MAXNCB; i++) {
 	    for (m = 0; m < nkl; m++) {
-	      _cb[ie2][ite][ie1][i][m] = 0;
+	      CBArray(ie2, ite, ie1)[i][m] = 0;
 	    }
 	  }
 	  continue;
@@ -765,7 +766,7 @@ int PrepCoulombBethe(int ne2, int nte, int ne1, double z,
 	    if (q1 <= q0) {
 	      for (i = 0; i < MAXNCB; i++) {
 		for (m = 0; m < nkl; m++) {
-		  _cb[ie2][ite][ie1][i][m] = 0;
+		  CBArray(ie2, ite, ie1)[i][m] = 0;
 		}
 	      }
 	      goto NEXTE;
@@ -792,7 +793,7 @@ int PrepCoulombBethe(int ne2, int nte, int ne1, double z,
 	    if (k < q1) {
 	      for (i = 0; i < MAXNCB; i++) {
 		for (m = 0; m < nkl; m++) {
-		  _cb[ie2][ite][ie1][i][m] = 0;
+		  CBArray(ie2, ite, ie1)[i][m] = 0;
 		}
 	      }
 	      goto NEXTE;
@@ -956,18 +957,22 @@ int CoulombMultip(char *fn, double z, double te, double e1,
   return 0;
 }
 
-int InitCoulomb(void) {
-  int i, ie1, ie2, ite;
+void FreeCoulombBethe(void) {
+  int i, m;
 
-  for (ie2 = 0; ie2 < MAXNE; ie2++) {
-    for (ite = 0; ite < MAXNTE; ite++) {
-      for (ie1 = 0; ie1 < MAXNE; ie1++) {
-	for (i = 0; i < MAXNCB; i++) {
-	  _cb[ie2][ite][ie1][i] = NULL;
-	}
-      }
-    }
+  if (_cb == NULL) return;
+  m = _ncb[0]*_ncb[1]*_ncb[2]*MAXNCB;
+  for (i = 0; i < m; i++) {
+    free(_cb[i]);
   }
+  free(_cb);
+  _cb = NULL;
+  _ncb[0] = 0;
+  _ncb[1] = 0;
+  _ncb[2] = 0;
+}
+
+int InitCoulomb(void) {
   PrepCBIndex();
   SetHydrogenicNL(-1, -1, -1, -1);
   InitHydrogenicDipole(150);
@@ -94,6 +94,7 @@ int     PrepCoulombBethe(int ne2, int nte, int ne1, double z,
 			 double *e2, double *te, double *e1,
 			 int nkl, double *kl, int mode);
 int     CoulombBethe(char *s, double z, double te, double e1);
+void    FreeCoulombBethe(void);
 int     InitCoulomb(void);
 void InitHydrogenicDipole(int n);
 
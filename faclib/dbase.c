@@ -55,6 +55,11 @@ static int iground;
 static int iuta = 0;
 static int utaci = 1;
 static int itrf = 0;
+/*
+** compress the CE file in frames when it is closed, the readers go
+** through BFILE and decode it transparently.
+*/
+static int db_compress = 0;
 static double clock_start=0, clock_last=0;
 
 static double born_mass = 1.0;
@@ -3389,6 +3394,16 @@ int CloseFile(TFILE *f, F_HEADER *fhdr) {
   FSEEK(f, 0, SEEK_SET); 
   fheader[ihdr].type = fhdr->type;
   WriteFHeader(f, &(fheader[ihdr]));
+#ifdef USEBF
+  if (db_compress && fhdr->type == DB_CE && f->fn && MyRankMPI() == 0) {
+    char *fn = malloc(strlen(f->fn)+1);
+    strcpy(fn, f->fn);
+    FCLOSE(f);
+    BFileCompress(fn, ZFRAME);
+    free(fn);
+    return 0;
+  }
+#endif
   FCLOSE(f);
   return 0;
 }
@@ -3829,61 +3844,312 @@ static int StrTrimCmp(char *s1, char *s2) {
   return 0;
 }
    
-int FindLevelByName(char *fn, int nele, char *nc, char *cnr, char *cr) {
-  F_HEADER fh;  
+/*
+** in-memory copies of level files for repeated lookups. the records
+** of a file are kept in one array indexed by ilev, with open-addressed
+** hash indices on the full level name and on the (ncomplex, sname)
+** pair. records with the same key are chained in file order, so the
+** first one is what a linear scan of the file would find. a table is
+** read again when its file changes on disk.
+*/
+#define MAXLEVTABLES 16
+
+typedef struct _LEVEL_TABLE_ {
+  char fn[1024];
+  time_t mtime;
+  off_t size;
+  ino_t ino;
+  int n, hmask;
+  EN_RECORD *r;
+  int *nele;
+  int *hname, *hsname;
+  int *nname, *nsname;
+} LEVEL_TABLE;
+
+static LEVEL_TABLE *_lev_tables[MAXLEVTABLES];
+static int _lev_tables_next = 0;
+
+/* hash of a string without its leading and trailing blanks */
+static unsigned int StrTrimHash(unsigned int h, char *s) {
+  int i, n;
+
+  while (*s == ' ' || *s == '\t') s++;
+  n = strlen(s);
+  while (n > 0 && (s[n-1] == ' ' || s[n-1] == '\t')) n--;
+  for (i = 0; i < n; i++) {
+    h ^= (unsigned char) s[i];
+    h *= 16777619U;
+  }
+  h ^= 0xff;
+  h *= 16777619U;
+  return h;
+}
+
+static unsigned int LevelNameHash(int nele, char *nc, char *cnr, char *cr) {
+  unsigned int h;
+
+  h = 2166136261U ^ (unsigned int) nele;
+  h *= 16777619U;
+  h = StrTrimHash(h, nc);
+  h = StrTrimHash(h, cnr);
+  if (cr) h = StrTrimHash(h, cr);
+  return h;
+}
+
+static int LevelNameMatch(LEVEL_TABLE *t, int i, int nele,
+			  char *nc, char *cnr, char *cr) {
+  if (t->nele[i] != nele) return 0;
+  if (StrTrimCmp(t->r[i].ncomplex, nc) != 0) return 0;
+  if (StrTrimCmp(t->r[i].sname, cnr) != 0) return 0;
+  if (cr && StrTrimCmp(t->r[i].name, cr) != 0) return 0;
+  return 1;
+}
+
+/*
+** the slot of the key in the index h, either empty or holding the
+** first record of the key.
+*/
+static int *LevelHashSlot(LEVEL_TABLE *t, int *h, int nele,
+			  char *nc, char *cnr, char *cr) {
+  unsigned int k;
+
+  k = LevelNameHash(nele, nc, cnr, cr) & t->hmask;
+  while (h[k] >= 0) {
+    if (LevelNameMatch(t, h[k], nele, nc, cnr, cr)) break;
+    k = (k+1) & t->hmask;
+  }
+  return h+k;
+}
+
+static void FreeLevelTable(LEVEL_TABLE *t) {
+  if (t == NULL) return;
+  free(t->r);
+  free(t->nele);
+  free(t->hname);
+  free(t->hsname);
+  free(t->nname);
+  free(t->nsname);
+  free(t);
+}
+
+/* link record i at the end of the chain of its key */
+static void AddLevelHash(LEVEL_TABLE *t, int *h, int *nx, int i, char *cr) {
+  int *p;
+
+  nx[i] = -1;
+  p = LevelHashSlot(t, h, t->nele[i], t->r[i].ncomplex, t->r[i].sname, cr);
+  while (*p >= 0) p = nx + *p;
+  *p = i;
+}
+
+static LEVEL_TABLE *ReadLevelTable(char *fn, struct stat *st) {
+  F_HEADER fh;
   EN_HEADER h;
   EN_RECORD r;
   TFILE *f;
-  int n, k;
-  int swp;
-  
+  LEVEL_TABLE *t;
+  long pos;
+  int n, i, nb, swp;
+
   f = FOPEN(fn, "r");
   if (f == NULL) {
     printf("cannot open file %s\n", fn);
-    return -1;
+    return NULL;
   }
   n = ReadFHeader(f, &fh, &swp);
-  if (n == 0) {
-    FCLOSE(f);
-    return 0;
-  }
-
-  if (fh.type != DB_EN) {
-    printf("File type is not DB_EN\n");
+  if (n == 0 || fh.type != DB_EN) {
+    if (n > 0) printf("File type is not DB_EN\n");
     FCLOSE(f);
-    return -1;
+    return NULL;
   }
-
+  pos = FTELL(f);
+  nb = 0;
   while (1) {
     n = ReadENHeader(f, &h, swp);
     if (n == 0) break;
-    if (h.nele != nele) {
-      FSEEK(f, h.length, SEEK_CUR);
-      continue;
-    }
-    for (k = 0; k < h.nlevels; k++) {
+    for (i = 0; i < h.nlevels; i++) {
       n = ReadENRecord(f, &r, swp);
-      if (StrTrimCmp(r.ncomplex, nc) == 0 &&
-	  StrTrimCmp(r.sname, cnr) == 0 &&
-	  StrTrimCmp(r.name, cr) == 0) {
-	FCLOSE(f);
-	return r.ilev;
-      }
+      if (n == 0) break;
+      if (r.ilev >= nb) nb = r.ilev+1;
+    }
+  }
+  t = malloc(sizeof(LEVEL_TABLE));
+  strncpy(t->fn, fn, 1023);
+  t->fn[1023] = '\0';
+  t->mtime = st->st_mtime;
+  t->size = st->st_size;
+  t->ino = st->st_ino;
+  t->n = nb;
+  for (t->hmask = 1; t->hmask < 2*nb; t->hmask <<= 1);
+  t->hname = malloc(sizeof(int)*t->hmask);
+  t->hsname = malloc(sizeof(int)*t->hmask);
+  for (i = 0; i < t->hmask; i++) {
+    t->hname[i] = -1;
+    t->hsname[i] = -1;
+  }
+  t->hmask--;
+  nb = Max(nb, 1);
+  t->r = malloc(sizeof(EN_RECORD)*nb);
+  t->nele = malloc(sizeof(int)*nb);
+  t->nname = malloc(sizeof(int)*nb);
+  t->nsname = malloc(sizeof(int)*nb);
+  for (i = 0; i < t->n; i++) {
+    t->r[i].ilev = -1;
+    t->nele[i] = -1;
+  }
+  FSEEK(f, pos, SEEK_SET);
+  while (1) {
+    n = ReadENHeader(f, &h, swp);
+    if (n == 0) break;
+    for (i = 0; i < h.nlevels; i++) {
+      n = ReadENRecord(f, &r, swp);
+      if (n == 0) break;
+      if (r.ilev < 0 || t->r[r.ilev].ilev >= 0) continue;
+      memcpy(t->r+r.ilev, &r, sizeof(EN_RECORD));
+      t->nele[r.ilev] = h.nele;
+      AddLevelHash(t, t->hname, t->nname, r.ilev, r.name);
+      AddLevelHash(t, t->hsname, t->nsname, r.ilev, NULL);
     }
   }
-  
   FCLOSE(f);
-  return -1;
+  return t;
 }
-      
+
+/*
+** the level table of the file fn, read on the first call, and again
+** whenever the file has changed. must be called in the critical
+** section level_table.
+*/
+static LEVEL_TABLE *GetLevelTable(char *fn) {
+  struct stat st;
+  LEVEL_TABLE *t;
+  int i;
+
+  if (stat(fn, &st) != 0) {
+    printf("cannot open file %s\n", fn);
+    return NULL;
+  }
+  for (i = 0; i < MAXLEVTABLES; i++) {
+    t = _lev_tables[i];
+    if (t == NULL || strcmp(t->fn, fn) != 0) continue;
+    if (t->mtime == st.st_mtime && t->size == st.st_size &&
+	t->ino == st.st_ino) {
+      return t;
+    }
+    FreeLevelTable(t);
+    _lev_tables[i] = ReadLevelTable(fn, &st);
+    return _lev_tables[i];
+  }
+  i = _lev_tables_next;
+  _lev_tables_next = (i+1)%MAXLEVTABLES;
+  FreeLevelTable(_lev_tables[i]);
+  _lev_tables[i] = ReadLevelTable(fn, &st);
+  return _lev_tables[i];
+}
+
+void FreeLevelTables(void) {
+  int i;
+
+#pragma omp critical(level_table)
+  {
+    for (i = 0; i < MAXLEVTABLES; i++) {
+      FreeLevelTable(_lev_tables[i]);
+      _lev_tables[i] = NULL;
+    }
+    _lev_tables_next = 0;
+  }
+}
+
+/*
+** copy the level table of the file fn into r, indexed by ilev. the
+** records missing from the file have ilev = -1. returns the number
+** of records, or -1 on error.
+*/
+int LevelTable(char *fn, EN_RECORD **r) {
+  LEVEL_TABLE *t;
+  int n;
+
+  n = -1;
+  *r = NULL;
+#pragma omp critical(level_table)
+  {
+    t = GetLevelTable(fn);
+    if (t != NULL) {
+      n = t->n;
+      if (n > 0) {
+	*r = malloc(sizeof(EN_RECORD)*n);
+	memcpy(*r, t->r, sizeof(EN_RECORD)*n);
+      }
+    }
+  }
+  return n;
+}
+
+/*
+** the levels of nele electrons with the given complex and relativistic
+** configuration, in file order. returns the number of levels found,
+** with their indices in ilev, or -1 on error.
+*/
+int FindLevelsBySName(char *fn, int nele, char *nc, char *cnr, int **ilev) {
+  LEVEL_TABLE *t;
+  int i, n;
+
+  n = -1;
+  *ilev = NULL;
+#pragma omp critical(level_table)
+  {
+    t = GetLevelTable(fn);
+    if (t != NULL) {
+      n = 0;
+      i = *LevelHashSlot(t, t->hsname, nele, nc, cnr, NULL);
+      for (; i >= 0; i = t->nsname[i]) n++;
+      if (n > 0) {
+	*ilev = malloc(sizeof(int)*n);
+	n = 0;
+	i = *LevelHashSlot(t, t->hsname, nele, nc, cnr, NULL);
+	for (; i >= 0; i = t->nsname[i]) (*ilev)[n++] = i;
+      }
+    }
+  }
+  return n;
+}
+
+int FindLevelByName(char *fn, int nele, char *nc, char *cnr, char *cr) {
+  LEVEL_TABLE *t;
+  int i;
+
+  i = -1;
+#pragma omp critical(level_table)
+  {
+    t = GetLevelTable(fn);
+    if (t != NULL) {
+      i = *LevelHashSlot(t, t->hname, nele, nc, cnr, cr);
+    }
+  }
+  return i;
+}
+
 int LevelInfor(char *fn, int ilev, EN_RECORD *r0) {
   F_HEADER fh;  
   EN_HEADER h;
-  EN_RECORD r;
   TFILE *f;
+  LEVEL_TABLE *t;
   int n, i, k, nlevels;
-  int swp, sr;
+  int swp;
   
+  if (ilev >= 0) {
+    k = -1;
+#pragma omp critical(level_table)
+    {
+      t = GetLevelTable(fn);
+      if (t != NULL && ilev < t->n && t->r[ilev].ilev == ilev) {
+	memcpy(r0, t->r+ilev, sizeof(EN_RECORD));
+	k = 0;
+      }
+    }
+    return k;
+  }
+
   f = FOPEN(fn, "r");
   if (f == NULL) {
     printf("cannot open file %s\n", fn);
@@ -3899,76 +4165,45 @@ int LevelInfor(char *fn, int ilev, EN_RECORD *r0) {
     FCLOSE(f);
     return -1;
   }
-  if (version_read[DB_EN-1] < 109) sr = sizeof(EN_RECORD);
-  else if (version_read[DB_EN-1] < 115) sr = SIZE_EN_RECORD0;
-  else sr = SIZE_EN_RECORD;
-
-  if (ilev >= 0) {
-    k = ilev;
+  k = -ilev;
+  if (k == 1000) k = 0;
+  if (k < 1000) {
     nlevels = 0;
     for (i = 0; i < fh.nblocks; i++) {
       n = ReadENHeader(f, &h, swp);
       if (n == 0) break;
+      if (h.nele == k) break;
       nlevels += h.nlevels;
-      if (k < h.nlevels) {
-	if (k > 0) FSEEK(f, sr*k, SEEK_CUR);
-	n = ReadENRecord(f, &r, swp);
-	if (n == 0) break;
-	if (r.ilev != ilev) {
-	  FCLOSE(f);
-	  return -1;
-	}
-	memcpy(r0, &r, sizeof(EN_RECORD));
-	break;
-      } else {
-	k -= h.nlevels;
-	FSEEK(f, h.length, SEEK_CUR);
-      }
+      FSEEK(f, h.length, SEEK_CUR);
     }
     FCLOSE(f);
     if (i == fh.nblocks) return -1;
-    return 0;
+    return nlevels;
   } else {
-    k = -ilev;
-    if (k == 1000) k = 0;
-    if (k < 1000) {
-      nlevels = 0;
+    nlevels = 0;
+    k -= 1000;
+    if (k == 1) {
       for (i = 0; i < fh.nblocks; i++) {
 	n = ReadENHeader(f, &h, swp);
 	if (n == 0) break;
-	if (h.nele == k) break;
 	nlevels += h.nlevels;
 	FSEEK(f, h.length, SEEK_CUR);
       }
-      FCLOSE(f);
-      if (i == fh.nblocks) return -1;
-      return nlevels;
-    } else {
-      nlevels = 0;
+    } else if (k == 2) {
+      nlevels = fh.nblocks;
+    } else if (k >= 1000) {
       k -= 1000;
-      if (k == 1) {
-	for (i = 0; i < fh.nblocks; i++) {
-	  n = ReadENHeader(f, &h, swp);
-	  if (n == 0) break;
-	  nlevels += h.nlevels;
-	  FSEEK(f, h.length, SEEK_CUR);
-	}
-      } else if (k == 2) {
-	nlevels = fh.nblocks;
-      } else if (k >= 1000) {
-	k -= 1000;
-	for (i = 0; i < fh.nblocks; i++) {
-	  if (i >= k) break;
-	  n = ReadENHeader(f, &h, swp);
-	  if (n == 0) break;
-	  nlevels += h.nlevels;
-	  FSEEK(f, h.length, SEEK_CUR);
-	}
+      for (i = 0; i < fh.nblocks; i++) {
+	if (i >= k) break;
+	n = ReadENHeader(f, &h, swp);
+	if (n == 0) break;
+	nlevels += h.nlevels;
+	FSEEK(f, h.length, SEEK_CUR);
       }
-      FCLOSE(f);
-      return nlevels;
     }
-  }  
+    FCLOSE(f);
+    return nlevels;
+  }
 }
 
 EN_SRECORD *GetMemENTable(int *s) {
@@ -6299,6 +6534,9 @@ void RecoupleRO(char *ifn, char *ofn) {
 }
 
 void SetOptionDBase(char *s, char *sp, int ip, double dp) {
-  
+  if (strcmp("dbase:compress", s) == 0) {
+    db_compress = ip;
+    return;
+  }
 }
 
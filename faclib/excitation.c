@@ -45,15 +45,17 @@ static double log_xusr[MAXNUSR];
 
 static int n_egrid = 0;
 static int n_egrid1 = 0;
-static double egrid[MAXNE+2];
-static double log_egrid[MAXNE+2];
+static int m_egrid = 0;
+static double *egrid = NULL;
+static double *log_egrid = NULL;
 static double egrid_min;
 static double egrid_max;
 static int egrid_limits_type = 0;
 
 static int n_tegrid = 0;
-static double tegrid[MAXNTE];
-static double log_te[MAXNTE];
+static int m_tegrid = 0;
+static double *tegrid = NULL;
+static double *log_te = NULL;
 
 static int n_thetagrid = 0;
 static double thetagrid[MAXNTHETA];
@@ -75,14 +77,19 @@ static double xborn1 = XBORN1;
 static double eborn = EBORN;
 static double _gosm1[MAXMSUB][NKINT];
 static double _gosm2[MAXMSUB][NKINT];
-static double _qk[MAXMSUB][MAXNKL];
-static double _dqk[MAXMSUB][MAXNKL];
-static double _rq[MAXMSUB][MAXNTE][MAXNE+2];
-static double _drq[MAXMSUB][MAXNTE][MAXNE+2];
-static double _brq[MAXMSUB][MAXNTE][MAXNE+2];
-static double _xp[MAXMSUB][MAXNTE];
-
-#pragma omp threadprivate (kgrid, log_kgrid, kint, log_kint, gos1, gos2, gost, gosint, xusr, log_xusr, _gosm1, _gosm2, _qk, _dqk, _rq, _drq, _brq, _xp)
+/* 
+** per-thread work arrays sized by the current energy and partial wave
+** grids. one slot per call level, the collision strengths call the
+** qk interpolation, which calls the qk table.
+*/
+#define CEW_CS    0
+#define CEW_QK    1
+#define CEW_QKT   2
+#define NCEWORK   3
+static double *_cew[NCEWORK];
+static int _ncew[NCEWORK];
+
+#pragma omp threadprivate (kgrid, log_kgrid, kint, log_kint, gos1, gos2, gost, gosint, xusr, log_xusr, _gosm1, _gosm2, _cew, _ncew)
 
 static FILE *fpw=NULL;
 
@@ -94,11 +101,46 @@ static CEPW_SCRATCH pw_scratch = {1, 0, MAXKL, 100, 5E-2, 0, 0, 10};
 
 static int maxcecache = MAXCECACHE;
 static CECACHE cecache = {0};
+static int pk_pipeline = 1;
+static int ce_batch = 64;
+/*
+** tolerance of the adaptive partial wave sum in CERadialPk, 0 samples
+** the whole kl grid. pw_klcut holds, for each incident energy of the
+** current block, the largest kl reached, the number of pk tables and
+** the number stopped before kl_max. it is NULL outside SaveExcitation.
+*/
+static double pw_tol = 0.0;
+static int *pw_klcut = NULL;
 
 static MULTI *pk_array;
 static MULTI *qk_array;
 static MULTI *qkm_array;
 
+/*
+** return the work array of slot i with room for at least n elements.
+*/
+static double *CEWork(int i, int n) {
+  if (n > _ncew[i]) {
+    free(_cew[i]);
+    _cew[i] = (double *) malloc(sizeof(double)*n);
+    _ncew[i] = n;
+  }
+  return _cew[i];
+}
+
+/*
+** make room for n points in a grid and its log. the grid values
+** are not preserved.
+*/
+static void AllocCEGrid(double **x, double **logx, int *m, int n) {
+  if (n <= *m) return;
+  free(*x);
+  free(*logx);
+  *x = (double *) malloc(sizeof(double)*n);
+  *logx = (double *) malloc(sizeof(double)*n);
+  *m = n;
+}
+
 static void InitCEPK(void *p, int n) {
   CEPK *d;
   int i;
@@ -118,16 +160,22 @@ void SetMaxCECache(int n) {
   FreeCECache(0);
 }
 
-void AllocCECache(int msub) {
+/*
+** allocate the cache for n transitions, at most maxcecache.
+*/
+void AllocCECache(int msub, int n) {
+  if (n <= 0 || n > maxcecache) n = maxcecache;
+  cecache.m = n;
+  cecache.nc = 0;
   cecache.msub = msub;
-  cecache.low = malloc(sizeof(int)*maxcecache);
-  cecache.up = malloc(sizeof(int)*maxcecache);
-  cecache.nz = malloc(sizeof(int)*maxcecache);
-  cecache.az = malloc(sizeof(ANGULAR_ZMIX *)*maxcecache);
-  cecache.nmk = malloc(sizeof(int)*maxcecache);
-  cecache.mbk = malloc(sizeof(double *)*maxcecache);
+  cecache.low = malloc(sizeof(int)*n);
+  cecache.up = malloc(sizeof(int)*n);
+  cecache.nz = malloc(sizeof(int)*n);
+  cecache.az = malloc(sizeof(ANGULAR_ZMIX *)*n);
+  cecache.nmk = malloc(sizeof(int)*n);
+  cecache.mbk = malloc(sizeof(double *)*n);
   int i;
-  for (i = 0; i < maxcecache; i++) {
+  for (i = 0; i < n; i++) {
     cecache.low[i] = -1;
     cecache.up[i] = -1;
     cecache.nz[i] = 0;
@@ -212,13 +260,20 @@ void FreeCECache(int m) {
     FreeCEQKK(cecache.qk, cecache.msub);
     cecache.qk = NULL;
   }
-  if (m == 0) {
+  if (m == 0 && cecache.low) {
     free(cecache.low);
     free(cecache.up);
     free(cecache.nz);
     free(cecache.az);
     free(cecache.nmk);
     free(cecache.mbk);
+    cecache.low = NULL;
+    cecache.up = NULL;
+    cecache.nz = NULL;
+    cecache.az = NULL;
+    cecache.nmk = NULL;
+    cecache.mbk = NULL;
+    cecache.m = 0;
   }
   cecache.nc = 0;
 }
@@ -313,16 +368,19 @@ int SetCEPWGridType(int type) {
 }
 
 int SetCETEGridDetail(int n, double *x) {
+  AllocCEGrid(&tegrid, &log_te, &m_tegrid, n);
   n_tegrid = SetTEGridDetail(tegrid, log_te, n, x);
   return n_tegrid;
 }
 
 int SetCETEGrid(int n, double emin, double emax) {
+  AllocCEGrid(&tegrid, &log_te, &m_tegrid, n);
   n_tegrid = SetTEGrid(tegrid, log_te, n, emin, emax);
   return n_tegrid;
 }
 
 int SetCEEGridDetail(int n, double *xg) {
+  AllocCEGrid(&egrid, &log_egrid, &m_egrid, n+2);
   n_egrid = SetEGridDetail(egrid, log_egrid, n, xg);
   return n_egrid;
 }
@@ -333,6 +391,7 @@ int SetCEEGrid(int n, double emin, double emax, double eth) {
   BornFormFactorTE(&bte);
   bms = BornMass();
   eth = (eth + bte)/bms;
+  AllocCEGrid(&egrid, &log_egrid, &m_egrid, n+2);
   n_egrid = SetEGrid(egrid, log_egrid, n, emin, emax, eth);
   return n_egrid;
 }
@@ -418,6 +477,27 @@ void SetCETol(double t) {
   pw_scratch.tolerance = t;
 }
 
+/*
+** make room for mkl partial wave grid points, keeping the points
+** already set.
+*/
+static void AllocCEPWGrid(int mkl) {
+  double *kl, *log_kl;
+
+  if (mkl <= pw_scratch.mkl) return;
+  kl = (double *) malloc(sizeof(double)*(mkl+1));
+  log_kl = (double *) malloc(sizeof(double)*mkl);
+  if (pw_scratch.mkl > 0) {
+    memcpy(kl, pw_scratch.kl, sizeof(double)*(pw_scratch.mkl+1));
+    memcpy(log_kl, pw_scratch.log_kl, sizeof(double)*pw_scratch.mkl);
+    free(pw_scratch.kl);
+    free(pw_scratch.log_kl);
+  }
+  pw_scratch.kl = kl;
+  pw_scratch.log_kl = log_kl;
+  pw_scratch.mkl = mkl;
+}
+
 int SetCEPWOptions(int qr, int max, int kl_cb, double tol) {
   if (qr >= 0) {
     pw_scratch.qr = qr;
@@ -432,6 +512,7 @@ int SetCEPWOptions(int qr, int max, int kl_cb, double tol) {
   pw_scratch.max_kl = max;
   pw_scratch.kl_cb = kl_cb;
   pw_scratch.tolerance = tol;
+  AllocCEPWGrid(max+2);
   pw_scratch.nkl0 = 1;
   pw_scratch.kl[0] = 0;
   pw_scratch.log_kl[0] = -100.0;
@@ -440,11 +521,12 @@ int SetCEPWOptions(int qr, int max, int kl_cb, double tol) {
 }
 
 int SetCEPWGrid(int ns, int *n, int *step) {
+  AllocCEPWGrid(pw_scratch.max_kl+2);
   pw_scratch.nkl = SetPWGrid(&(pw_scratch.nkl0),
 			     pw_scratch.kl,
 			     pw_scratch.log_kl,
 			     pw_scratch.max_kl,
-			     &ns, n, step);
+			     &ns, n, step, pw_scratch.mkl);
   pw_scratch.ns = ns;
   if (pw_scratch.min_kl > 0) {
     int i, j, k;
@@ -463,17 +545,147 @@ int SetCEPWGrid(int ns, int *n, int *step) {
   return 0;
 }
 
+/*
+** list the free orbitals of the partial waves in CERadialPk at the
+** incident energy egrid[ie], for all energy transfers, up to the kl
+** index nkl. the arrays must hold 2*nkl*(1+n_tegrid) elements.
+** returns the number listed.
+*/
+static int CEOrbitalsE(int ie, int nkl, int *n, int *ka, double *e) {
+  int t, j, kl, kl2, kappa, i, m;
+  double e1, mc, mc1;
+
+  mc = MColl();
+  if (fabs(mc-1)<1e-3) mc = 0;
+  mc1 = mc;
+  if (mc1 <= 0) mc1 = 1.0;
+  e1 = egrid[ie];
+  m = 0;
+  for (t = 0; t < nkl; t++) {
+    kl = pw_scratch.kl[t];
+    if (kl > pw_scratch.max_kl) break;
+    kl2 = 2*kl;
+    for (j = abs(kl2-1); j <= kl2+1; j += 2) {
+      kappa = GetKappaFromJL(j, kl2);
+      if (kl >= pw_scratch.qr && kappa > 0) {
+	if (j == kl2-1) continue;
+	kappa = -kappa-1;
+      }
+      n[m] = 0;
+      ka[m] = kappa;
+      e[m] = e1;
+      if (mc > 0) e[m] *= mc;
+      m++;
+      for (i = 0; i < n_tegrid; i++) {
+	n[m] = 0;
+	ka[m] = kappa;
+	e[m] = e1 + tegrid[i]/mc1;
+	if (mc > 0) e[m] *= mc;
+	m++;
+      }
+    }
+  }
+  return m;
+}
+
+/*
+** solve the free orbitals of the partial waves in CERadialPk for the
+** current energy grids at once, before the transitions are processed.
+*/
+static void PrepCEOrbitals(void) {
+  int ie, m, nm;
+  int *n, *ka;
+  double *e;
+
+  nm = 2*pw_scratch.nkl*n_egrid*(1+n_tegrid);
+  if (nm <= 0) return;
+  n = malloc(sizeof(int)*nm);
+  ka = malloc(sizeof(int)*nm);
+  e = malloc(sizeof(double)*nm);
+  m = 0;
+  for (ie = 0; ie < n_egrid; ie++) {
+    m += CEOrbitalsE(ie, pw_scratch.nkl, n+m, ka+m, e+m);
+  }
+  SolveOrbitalsBatch(m, n, ka, e);
+  free(n);
+  free(ka);
+  free(e);
+}
+
+/*
+** convergence test of the partial wave sum in CERadialPk after the kl
+** index t. d holds the direct sums at kl[t] for each te, and dx the
+** sums with exchange, used until noex marks the exchange negligible.
+** w keeps the previous d, the running sums including the kl between
+** the samples, and the totals with the top-up of CERadialQkTable.
+** converged when, for two samples in a row at all te, the top-up is
+** below pw_tol of the total and the total changes by less than that.
+*/
+static int CEPkConverged(int t, int ie, int type, double e1,
+			 double *d, double *dx, int *noex, double *w,
+			 int *nc) {
+  int i, j, kl0, kl1, conv;
+  double *dp, *s, *r, c, b, x, tail, mc;
+
+  dp = w;
+  s = dp + n_tegrid;
+  r = s + n_tegrid;
+  mc = MColl();
+  if (mc <= 0) mc = 1.0;
+  conv = 1;
+  kl1 = pw_scratch.kl[t];
+  for (i = 0; i < n_tegrid; i++) {
+    if (t == 0) {
+      s[i] = d[i];
+      r[i] = 0.0;
+      dp[i] = d[i];
+      nc[i] = 0;
+      conv = 0;
+      continue;
+    }
+    kl0 = pw_scratch.kl[t-1];
+    c = 0.0;
+    if (dp[i] > 0 && d[i] > 0) c = pow(d[i]/dp[i], 1.0/(kl1-kl0));
+    for (j = kl0+1; j < kl1; j++) {
+      if (c > 0) s[i] += dp[i]*pow(c, j-kl0);
+      else s[i] += dp[i] + (d[i]-dp[i])*(j-kl0)/(kl1-kl0);
+    }
+    s[i] += d[i];
+    b = 0.0;
+    if (d[i] && dp[i] && type >= 0) {
+      if (type == 0 || type > CBMULT) {
+	b = -1.0;
+      } else {
+	b = (GetCoulombBethe(0, i, ie, type, 0))[t];
+      }
+      b = TopUpQk(b, c, kl1, -1.0, tegrid[i], e1*mc);
+    }
+    tail = d[i]*b;
+    x = s[i] + tail;
+    if (x > 0 && tail <= pw_tol*x && fabs(x-r[i]) <= pw_tol*x &&
+	(noex[i] || fabs(dx[i]-d[i]) <= pw_tol*x)) {
+      nc[i]++;
+    } else {
+      nc[i] = 0;
+    }
+    if (nc[i] < 2) conv = 0;
+    r[i] = x;
+    dp[i] = d[i];
+  }
+  return conv;
+}
+
 int CERadialPk(CEPK **pk, int ie, int k0, int k1, int k, int trylock) {
-  int type, ko2, i, m, t, q;
+  int type, ko2, i, m, t, t1, q, *nc;
   int kf0, kf1, kpp0, kpp1, km0, km1;
   int kl0, kl1, kl0p, kl1p;
   int j0, j1, kl_max, j1min, j1max;
   ORBITAL *orb0, *orb1;
   int index[3];
   double te, e0, e1, sd, se;
-  double a, tdi[MAXNTE], tex[MAXNTE];
+  double a, *tdi, *tex, *tkl, *tw;
   int js1, js3, js[4], ks[4];
-  int nkappa, noex[MAXNTE];
+  int nkappa, *noex, *kb1, *kb3;
   short *kappa0, *kappa1;
   double *pkd, *pke;
 
@@ -483,7 +695,7 @@ int CERadialPk(CEPK **pk, int ie, int k0, int k1, int k, int trylock) {
 #endif
 
   ko2 = k/2;  
-  index[0] = ko2*MAXNE + ie;
+  index[0] = ie*(1+GetMaxRank()/2) + ko2;
   index[1] = k0;
   index[2] = k1;    
 
@@ -519,11 +731,19 @@ int CERadialPk(CEPK **pk, int ie, int k0, int k1, int k, int trylock) {
     return type;
   }
 
-  nkappa = (MAXNKL)*(GetMaxRank()+1)*4;
+  nkappa = (pw_scratch.nkl)*(GetMaxRank()+1)*4;
   kappa0 = (short *) malloc(sizeof(short)*nkappa);
   kappa1 = (short *) malloc(sizeof(short)*nkappa);
   pkd = (double *) malloc(sizeof(double)*(nkappa*n_tegrid));
   pke = (double *) malloc(sizeof(double)*(nkappa*n_tegrid));
+  tdi = (double *) malloc(sizeof(double)*n_tegrid*6);
+  tex = tdi + n_tegrid;
+  tkl = tex + n_tegrid;
+  tw = tkl + n_tegrid;
+  noex = (int *) malloc(sizeof(int)*n_tegrid*4);
+  kb1 = noex + n_tegrid;
+  kb3 = kb1 + n_tegrid;
+  nc = kb3 + n_tegrid;
 
   e1 = egrid[ie];
   e1w = e1;
@@ -573,6 +793,7 @@ int CERadialPk(CEPK **pk, int ie, int k0, int k1, int k, int trylock) {
 	tdi[i] = 0.0;
 	tex[i] = 0.0;
       }
+      tkl[i] = 0.0;
     }
     for (j0 = abs(kl0p-1); j0 <= kl0p+1; j0 += 2) {
       kpp0 = GetKappaFromJL(j0, kl0p); 
@@ -637,6 +858,7 @@ int CERadialPk(CEPK **pk, int ie, int k0, int k1, int k, int trylock) {
 	      }
 	      tdi[i] += sd*sd;
 	      tex[i] += (sd+se)*(sd+se);
+	      tkl[i] += sd*sd;
 	    } else {
 	      se = 0.0;
 	      if (kl1 >= pw_scratch.qr &&
@@ -650,6 +872,19 @@ int CERadialPk(CEPK **pk, int ie, int k0, int k1, int k, int trylock) {
 		  break;
 		}
 	      }
+	      tkl[i] += sd*sd;
+	    }
+	    if (i == 0 && sd != 0.0 && n_tegrid > 1) {
+	      /* the direct integrals at the other energies share the 
+		 Yk of the two bound orbitals, evaluate them at once. */
+	      for (t1 = 1; t1 < n_tegrid; t1++) {
+		e0w = e1 + tegrid[t1]/mc1;
+		if (mc > 0) e0w *= mc;
+		kb1[t1-1] = OrbitalIndex(0, pw_type==0?km0:km1, e0w);
+		kb3[t1-1] = ks[3];
+	      }
+	      SlaterBatch(ks[0], ks[2], ko2, n_tegrid-1, kb1, kb3, NULL,
+			  (kl1 >= pw_scratch.qr && kl0 >= pw_scratch.qr)?-1:1);
 	    }
 	    pkd[q] = sd;
 	    pke[q] = se;
@@ -663,6 +898,22 @@ int CERadialPk(CEPK **pk, int ie, int k0, int k1, int k, int trylock) {
 	}
       }
     }
+    if (pw_klcut && pw_tol > 0 &&
+	CEPkConverged(t, ie, type, e1, tkl, tex, noex, tw, nc)) {
+      t++;
+      break;
+    }
+  }
+  if (pw_klcut) {
+    i = (t > 0)?pw_scratch.kl[t-1]:0;
+#pragma omp critical(ce_klcut)
+    {
+      if (i > pw_klcut[3*ie]) pw_klcut[3*ie] = i;
+      pw_klcut[3*ie+1]++;
+      if (t < pw_scratch.nkl && pw_scratch.kl[t] <= kl_max) {
+	pw_klcut[3*ie+2]++;
+      }
+    }
   }
 
   (*pk)->nkappa = m;
@@ -676,6 +927,8 @@ int CERadialPk(CEPK **pk, int ie, int k0, int k1, int k, int trylock) {
   (*pk)->pkd = ReallocNew(pkd, sizeof(double)*q);
   (*pk)->pke = ReallocNew(pke, sizeof(double)*q);  
   (*pk)->nkl = t;
+  free(tdi);
+  free(noex);
   
   if (locked) ReleaseLock(lock);
 #pragma omp flush
@@ -1029,13 +1282,12 @@ double *CERadialQkTable(int k0, int k1, int k2, int k3, int k, int trylock) {
   short *kappa0, *kappa1, *kappa0p, *kappa1p;
   double *pkd, *pke, *pkdp, *pkep, *pd;
   double r, rd, s, b, c, d;
-  double qk[MAXNKL], dqk[MAXNKL];
-  double brq[MAXNTE][MAXNE+1];
-  double rq[MAXNTE][MAXNE+1], e1, te, te0;
-  double drq[MAXNTE][MAXNE+1], *rqc, **p, *ptr;
+  double *qk, *dqk, *xp, e1, te, te0;
+  double (*rq)[n_egrid1], (*drq)[n_egrid1], (*brq)[n_egrid1];
+  double *rqc, **p, *ptr;
   int index[5], mb, mk;
   int np = 3, one = 1;
-  double logj, xb, xp[MAXNTE];
+  double logj, xb;
 
 #ifdef PERFORM_STATISTICS
   clock_t start, stop;
@@ -1067,6 +1319,13 @@ double *CERadialQkTable(int k0, int k1, int k2, int k3, int k, int trylock) {
     if (locked) ReleaseLock(lock);
     return *p;
   }
+  nqk = n_tegrid*n_egrid1;
+  qk = CEWork(CEW_QKT, 2*pw_scratch.nkl + 3*nqk + n_tegrid);
+  dqk = qk + pw_scratch.nkl;
+  rq = (double (*)[n_egrid1]) (dqk + pw_scratch.nkl);
+  drq = rq + n_tegrid;
+  brq = drq + n_tegrid;
+  xp = (double *) (brq + n_tegrid);
   double mc = MColl();
   if (mc <= 0) mc = 1.0;
   if (xborn == 0 || xborn < -1E30) {
@@ -1228,7 +1487,6 @@ double *CERadialQkTable(int k0, int k1, int k2, int k3, int k, int trylock) {
     }
   }  
 
-  nqk = n_tegrid*n_egrid1;
   t = nqk + 1;
   if (type >= 0 && k > 0) {
     mk = GetMaxKMBPT();
@@ -1282,6 +1540,9 @@ double *CERadialQkMSubTable(int k0, int k1, int k2, int k3, int k, int kp,
   int ie, ite, q[MAXMSUB], nq, iq, ipk, ipkp;
   double rqt[MAXMSUB];
   double *rqc, **p;
+  double (*qk)[pw_scratch.nkl], (*dqk)[pw_scratch.nkl], (*xp)[n_tegrid];
+  double (*rq)[n_tegrid][n_egrid1], (*drq)[n_tegrid][n_egrid1];
+  double (*brq)[n_tegrid][n_egrid1];
   int index[5], mb;
   int np = 3, one = 1;
   double logj;
@@ -1327,6 +1588,13 @@ double *CERadialQkMSubTable(int k0, int k1, int k2, int k3, int k, int kp,
     q[iq] = q[iq-1] + 2;
   }  
   nqk = nq*n_tegrid*n_egrid1;
+  qk = (double (*)[pw_scratch.nkl])
+    CEWork(CEW_QKT, nq*(2*pw_scratch.nkl + 3*n_tegrid*n_egrid1 + n_tegrid));
+  dqk = qk + nq;
+  rq = (double (*)[n_tegrid][n_egrid1]) (dqk + nq);
+  drq = rq + nq;
+  brq = drq + nq;
+  xp = (double (*)[n_tegrid]) (brq + nq);
   double *pd = (double *) malloc(sizeof(double)*(nqk+1));
   rqc = pd;
   if (xborn == 0) {
@@ -1345,7 +1613,7 @@ double *CERadialQkMSubTable(int k0, int k1, int k2, int k3, int k, int kp,
 	type1 = CERadialQkBornMSub(k0, k1, k2, k3, k, kp, te, e1, 
 				   nq, q, rqt, mb);	
 	for (iq = 0; iq < nq; iq++) {
-	  _rq[iq][ite][ie] = rqt[iq];
+	  rq[iq][ite][ie] = rqt[iq];
 	}
       }
     }
@@ -1360,8 +1628,8 @@ double *CERadialQkMSubTable(int k0, int k1, int k2, int k3, int k, int kp,
 	type1 = CERadialQkBornMSub(k0, k1, k2, k3, k, kp, te, e1, 
 				   nq, q, rqt, 1);
 	for (iq = 0; iq < nq; iq++) {
-	  _rq[iq][ite][ie] = rqt[iq];
-	  _brq[iq][ite][ie] = rqt[iq];
+	  rq[iq][ite][ie] = rqt[iq];
+	  brq[iq][ite][ie] = rqt[iq];
 	}
       }
     }
@@ -1402,8 +1670,8 @@ double *CERadialQkMSubTable(int k0, int k1, int k2, int k3, int k, int kp,
 	if (mc > 0) e0w *= mc;
 	for (i = 0; i < nq; i++) { 
 	  for (j = 0; j < nkl; j++) { 
-	    _qk[i][j] = 0.0; 
-	    _dqk[i][j] = 0.0;
+	    qk[i][j] = 0.0; 
+	    dqk[i][j] = 0.0;
 	  }   
 	} 
       
@@ -1470,8 +1738,8 @@ double *CERadialQkMSubTable(int k0, int k1, int k2, int k3, int k, int kp,
 	      } 
 	    }
 	    for (iq = 0; iq < nq; iq++) { 
-	      _qk[iq][i] += s*rqt[iq]; 
-	      _dqk[iq][i] += sd*rqt[iq];
+	      qk[iq][i] += s*rqt[iq]; 
+	      dqk[iq][i] += sd*rqt[iq];
 	    } 
 
 	    ipkp += n_tegrid;
@@ -1480,41 +1748,41 @@ double *CERadialQkMSubTable(int k0, int k1, int k2, int k3, int k, int kp,
 	}
       
 	for (iq = 0; iq < nq; iq++) { 
-	  r = _qk[iq][0];
-	  rd = _qk[iq][0];
+	  r = qk[iq][0];
+	  rd = qk[iq][0];
 	  for (i = 1; i < nkl; i++) { 
-	    r += _qk[iq][i]; 
-	    rd += _qk[iq][i];
+	    r += qk[iq][i]; 
+	    rd += qk[iq][i];
 	    kl0 = pw_scratch.kl[i-1]; 
 	    kl1 = pw_scratch.kl[i]; 
 	    for (j = kl0+1; j < kl1; j++) {       
 	      logj = LnInteger(j);
-	      UVIP3P(np, nkl, pw_scratch.log_kl, _qk[iq],
+	      UVIP3P(np, nkl, pw_scratch.log_kl, qk[iq],
 		     one, &logj, &s);
 	      r += s;
-	      UVIP3P(np, nkl, pw_scratch.log_kl, _dqk[iq],
+	      UVIP3P(np, nkl, pw_scratch.log_kl, dqk[iq],
 		     one, &logj, &s);
 	      rd += s;
 	    }      
 	  }    
-	  _rq[iq][ite][ie] = r;
-	  _drq[iq][ite][ie] = rd;
+	  rq[iq][ite][ie] = r;
+	  drq[iq][ite][ie] = rd;
 	} 
 
 	i = nkl - 1;
 	r = 0.0;
 	for (iq = 0; iq < nq; iq++) {
 	  b = 0.0;
-	  if (_dqk[iq][i] && _dqk[iq][i-1]) {
+	  if (dqk[iq][i] && dqk[iq][i-1]) {
 	    if (k != kp || type1 == 0 || type1 > CBMULT) {
-	      c = _dqk[iq][i]/_dqk[iq][i-1];
+	      c = dqk[iq][i]/dqk[iq][i-1];
 	      if (c > 0) {
 		c = pow(c, 1.0/(pw_scratch.kl[i]-pw_scratch.kl[i-1]));
 	      }
 	      b = TopUpQk(-1.0, c, pw_scratch.kl[i], -1.0, te, e1*mc1);
 	    } else if (type1 >= 0) {
 	      b = (GetCoulombBethe(0, ite, ie, k/2, abs(q[iq])/2))[i];
-	      c = _dqk[iq][i]/_dqk[iq][i-1];
+	      c = dqk[iq][i]/dqk[iq][i-1];
 	      if (c > 0) {
 		c = pow(c, 1.0/(pw_scratch.kl[i]-pw_scratch.kl[i-1]));
 	      }
@@ -1523,15 +1791,15 @@ double *CERadialQkMSubTable(int k0, int k1, int k2, int k3, int k, int kp,
 	      b = 0.0;
 	    }
 	  }
-	  s = _dqk[iq][i]*b;
-	  _rq[iq][ite][ie] += s;
-	  _drq[iq][ite][ie] += s;
+	  s = dqk[iq][i]*b;
+	  rq[iq][ite][ie] += s;
+	  drq[iq][ite][ie] += s;
 	  if (s) {
-	    s = fabs(s/_drq[iq][ite][ie]);
-	    if (ie < n_egrid-1 && s > _xp[iq][ite]) s = _xp[iq][ite];
-	    else _xp[iq][ite] = s;
-	    d = _drq[iq][ite][ie]*(1-s) + _brq[iq][ite][ie]*s;
-	    _rq[iq][ite][ie] = _rq[iq][ite][ie]-_drq[iq][ite][ie] + d;
+	    s = fabs(s/drq[iq][ite][ie]);
+	    if (ie < n_egrid-1 && s > xp[iq][ite]) s = xp[iq][ite];
+	    else xp[iq][ite] = s;
+	    d = drq[iq][ite][ie]*(1-s) + brq[iq][ite][ie]*s;
+	    rq[iq][ite][ie] = rq[iq][ite][ie]-drq[iq][ite][ie] + d;
 	  }
 	}
       }
@@ -1543,7 +1811,7 @@ double *CERadialQkMSubTable(int k0, int k1, int k2, int k3, int k, int kp,
     for (ite = 0; ite < n_tegrid; ite++) {
       for (ie = 0; ie < n_egrid1; ie++) {
 	ptr[ie] =
-	  _rq[iq][ite][ie];
+	  rq[iq][ite][ie];
       }
       ptr += n_egrid1;
     }
@@ -1565,11 +1833,12 @@ int CERadialQk(double *rqc, double te, int k0, int k1, int k2, int k3,
 	       int k, int trylock) {
   int i, np, nd, type;
   int j, m, mk;
-  double *rqe, rq[MAXNTE];
+  double *rqe, *rq;
   double *xte, x0;
   
   rqe = CERadialQkTable(k0, k1, k2, k3, k, trylock);
   if (rqe == NULL) return -9999;
+  rq = CEWork(CEW_QK, n_tegrid);
   if (n_tegrid == 1) {
     for (i = 0; i < n_egrid1; i++) {
       rqc[i] = rqe[i];
@@ -1634,10 +1903,11 @@ int CERadialQkMSub(double *rqc, double te, int k0, int k1, int k2, int k3,
 		   int k, int kp, int trylock) {
   int i, np, nd, iq, n;
   int j, m, type, nq;
-  double *rqe, rq[MAXNTE];
+  double *rqe, *rq;
   double *xte, x0;
   rqe = CERadialQkMSubTable(k0, k1, k2, k3, k, kp, trylock);
   if (rqe == NULL) return -9999;
+  rq = CEWork(CEW_QK, n_tegrid);
   nq = Min(k, kp)/2 + 1;
 
   if (n_tegrid == 1) {
@@ -1799,15 +2069,21 @@ int CollisionStrengthUTA(double *qkt, double *params, double *e, double *bethe,
   int p1, p2, j1, j2, k0, k1, type, ty;
   int ns, q1, q2, ie, kmin, kmax, k, np;
   double te, *rqk, tol;
-  double rq[MAXMSUB*(MAXNE+1)], qkc[MAXMSUB*(MAXNE+1)];
+  double *rq, *qkc;
   int ierr, ipvt[NPARAMS];
-  int lwa=5*NPARAMS+MAXNE;
-  double wa[5*NPARAMS+MAXNE];
-  double fvec[MAXNE], fjac[MAXNE*NPARAMS];
+  int lwa;
+  double *wa, *fvec, *fjac;
   double born_egrid, born_cross, c, d, r;
   double bte, bms;
   FORM_FACTOR *bform;
   
+  lwa = 5*NPARAMS + n_egrid;
+  rq = CEWork(CEW_CS, 2*MAXMSUB*n_egrid1 + lwa + n_egrid*(1+NPARAMS));
+  qkc = rq + MAXMSUB*n_egrid1;
+  wa = qkc + MAXMSUB*n_egrid1;
+  fvec = wa + lwa;
+  fjac = fvec + n_egrid;
+
   lev1 = GetLevel(lower);
   if (lev1 == NULL) return -1;
   lev2 = GetLevel(upper);
@@ -1928,7 +2204,7 @@ int CollisionStrengthUTA(double *qkt, double *params, double *e, double *bethe,
 	params[3] = 0.1;
       }
       np = NPARAMS;
-      ierr = NLSQFit(np, params, tol, ipvt, fvec, fjac, MAXNE, wa, lwa,
+      ierr = NLSQFit(np, params, tol, ipvt, fvec, fjac, n_egrid, wa, lwa,
 		     n_egrid, xusr, log_xusr, qkc, qkt, 
 		     CERadialQkFromFit, (void *) bethe);
       if (ierr > 3) params[0] = ierr*1E30;
@@ -1969,7 +2245,7 @@ int CollisionStrengthEB(double *qkt, double *e, double *bethe,
 			int lower, int upper) {
   LEVEL *lev1, *lev2, *plev1, *plev1p, *plev2, *plev2p;
   double te, a, ap, c, cp, r, s[3];
-  double rq[MAXNE+1], qkc[MAXNE+1];
+  double *rq, *qkc;
   double born_egrid, born_cross, *mbk;
   int ie, i1, i2, i1p, i2p, p1, p2, p1p, p2p;
   int j1, j2, j1p, j2p, mlev1, mlev2, mlev1p, mlev2p;
@@ -1978,6 +2254,8 @@ int CollisionStrengthEB(double *qkt, double *e, double *bethe,
   double bte, bms;
   FORM_FACTOR *bform;
         
+  rq = CEWork(CEW_CS, 2*n_egrid1);
+  qkc = rq + n_egrid1;
   lev1 = GetEBLevel(lower);
   if (lev1 == NULL) return -1;
   lev2 = GetEBLevel(upper);
@@ -2084,7 +2362,7 @@ int CollisionStrengthEBD(double *qkt, double *e, double *bethe, double *born,
 			 int lower, int upper) {
   LEVEL *lev1, *lev2, *plev1, *plev1p, *plev2, *plev2p;
   double te, a, ap, c, cp, r, s[3];
-  double rq[(MAXNE+2)*MAXMSUB];
+  double *rq;
   double d, d1, d2, rs;
   int q, nq, kkp, qb, qbp, ith, iph, m, ka, nmk;
   double born_egrid, born_cross, *mbk;
@@ -2095,6 +2373,7 @@ int CollisionStrengthEBD(double *qkt, double *e, double *bethe, double *born,
   double bte, bms;
   FORM_FACTOR *bform;
       
+  rq = CEWork(CEW_CS, (n_egrid+2)*MAXMSUB);
   lev1 = GetEBLevel(lower);
   if (lev1 == NULL) return -1;
   lev2 = GetEBLevel(upper);
@@ -2221,40 +2500,34 @@ double AngZCorrection(int nmk, double *mbk, ANGULAR_ZMIX *ang, int t) {
   return r;
 }
 
-int CollisionStrength(double *qkt, double *params, double *e, double *bethe,
-		      int lower, int upper, int msub) {
+/*
+** collision strength of the transition lower -> upper with the angular
+** coefficients ang and the mbpt corrections mbk already computed.
+*/
+static int CollisionStrengthZ(double *qkt, double *params, double *e,
+			      double *bethe, int lower, int upper, int msub,
+			      int nz, ANGULAR_ZMIX *ang, int nmk, double *mbk,
+			      double *qkz, int tyz) {
   int i, j, t, h, p, m, type, ty, p1, p2, gauge;  
   LEVEL *lev1, *lev2;
-  double te, c, r, s3j, c1, c2, *mbk, aw;
-  int j1, j2, ie, nk, np, nq, kkp, nmk;
-  double rq[MAXMSUB*(MAXNE+1)];
-  double qkc[MAXMSUB*(MAXNE+1)];
+  double te, c, r, s3j, c1, c2, aw;
+  int j1, j2, ie, nk, np, nq, kkp;
+  double *rq, *qkc;
   double *rqk, *rqkt, tol;
   int ierr, ipvt[NPARAMS];
-  int lwa=5*NPARAMS+MAXNE;
-  double wa[5*NPARAMS+MAXNE];
-  double fvec[MAXNE], fjac[MAXNE*NPARAMS];
+  int lwa;
+  double *wa, *fvec, *fjac;
   double born_egrid, born_cross, bt, ubt[MAXNUSR];
   double bte, bms;
   FORM_FACTOR *bform;
-  int nz;
-  ANGULAR_ZMIX *ang;
 
-  /*
-  nz = cecache.nz[ic];
-  ang = cecache.az[ic];
-  nmk = cecache.nmk[ic];
-  mbk = cecache.mbk[ic];
-  if (nz <= 0) {
-    if (nmk > 0) {
-      free(mbk);
-      cecache.nmk[ic] = 0;
-      cecache.mbk[ic] = NULL;
-    }
-    cecache.az[ic] = NULL;
-    return -1;
-  }
-  */
+  if (nz <= 0) return -1;
+  lwa = 5*NPARAMS + n_egrid;
+  rq = CEWork(CEW_CS, 2*MAXMSUB*n_egrid1 + lwa + n_egrid*(1+NPARAMS));
+  qkc = rq + MAXMSUB*n_egrid1;
+  wa = qkc + MAXMSUB*n_egrid1;
+  fvec = wa + lwa;
+  fjac = fvec + n_egrid;
   lev1 = GetLevel(lower);
   if (lev1 == NULL) return -1;
   lev2 = GetLevel(upper);
@@ -2286,6 +2559,11 @@ int CollisionStrength(double *qkt, double *params, double *e, double *bethe,
 	}
       }
     }
+  } else if (qkz) {
+    /* already contracted in CEQkZBatch */
+    for (ie = 0; ie < 2*n_egrid1; ie++) {
+      qkc[ie] = qkz[ie];
+    }
   } else {
     for (ie = 0; ie < n_egrid1; ie++) {
       qkc[ie] = 0.0;
@@ -2293,11 +2571,6 @@ int CollisionStrength(double *qkt, double *params, double *e, double *bethe,
     }    
   }
   gauge = GetTransitionGauge();
-  nz = AngularZMix(&ang, lower, upper, -1, -1, &nmk, &mbk);
-  if (nz <= 0) {
-    if (nmk > 0) free(mbk);
-    return -1;
-  }
 
   type = -1;
   short **ia;
@@ -2305,7 +2578,7 @@ int CollisionStrength(double *qkt, double *params, double *e, double *bethe,
   for (i = 0; i < nz; i++) {
     ia[i] = malloc(sizeof(short)*nz);
     for (j = i; j < nz; j++) {
-      ia[i][j] = 0;
+      ia[i][j] = (qkz != NULL);
     }
   }
   //int iter = 0;
@@ -2414,6 +2687,7 @@ int CollisionStrength(double *qkt, double *params, double *e, double *bethe,
     free(ia[i]);
   }
   free(ia);
+  if (qkz) type = tyz;
   BornFormFactorTE(&bte);
   bms = BornMass();
   bte = (te + bte)/bms;
@@ -2504,16 +2778,6 @@ int CollisionStrength(double *qkt, double *params, double *e, double *bethe,
     bethe[2] = 0.0;
   }
 
-  free(ang);
-  /*
-  cecache.az[ic] = NULL;
-  cecache.nz[ic] = 0;
-  if (nmk > 0) {
-    free(mbk);
-    cecache.nmk[ic] = 0;
-    cecache.mbk[ic] = NULL;
-  }
-  */
   /* there is a factor of 4 coming from normalization and the 2 
      from the formula */
   if (!msub) {
@@ -2549,7 +2813,7 @@ int CollisionStrength(double *qkt, double *params, double *e, double *bethe,
 	  params[3] = 0.1;
 	}
 	np = NPARAMS;
-	ierr = NLSQFit(np, params, tol, ipvt, fvec, fjac, MAXNE, wa, lwa,
+	ierr = NLSQFit(np, params, tol, ipvt, fvec, fjac, n_egrid, wa, lwa,
 		       n_egrid, xusr, log_xusr, qkc, qkt, 
 		       CERadialQkFromFit, (void *) bethe);
 	if (ierr > 3) params[0] = ierr*1E30;
@@ -2649,7 +2913,7 @@ int CollisionStrength(double *qkt, double *params, double *e, double *bethe,
     rqkt = qkt;
     for (t = -j1; t <= 0; t += 2) {
       for (h = -j2; h <= j2; h += 2) {
-	for (ie = 0; ie < n_egrid; ie++) {
+	for (ie = 0; ie < n_usr; ie++) {
 	  ubt[ie] += rqkt[ie];
 	  if (t != 0) ubt[ie] += rqkt[ie];
 	}
@@ -2661,235 +2925,368 @@ int CollisionStrength(double *qkt, double *params, double *e, double *bethe,
   }
 }
 
-void ProcessCECache(int msub, int iuta, TFILE *f) {
-  int ic, iz, jz, ie, skip, ilow, iup, nparams;
+int CollisionStrength(double *qkt, double *params, double *e, double *bethe,
+		      int lower, int upper, int msub) {
+  int k, nz, nmk;
+  ANGULAR_ZMIX *ang;
+  double *mbk;
 
-  if (qk_mode == QK_FIT) 
-    nparams = NPARAMS;
-  else
-    nparams = 0;
+  nz = AngularZMix(&ang, lower, upper, -1, -1, &nmk, &mbk);
+  k = CollisionStrengthZ(qkt, params, e, bethe, lower, upper, msub,
+			 nz, ang, nmk, mbk, NULL, -1);
+  if (nz > 0) free(ang);
+  if (nmk > 0) free(mbk);
+  return k;
+}
 
-  if (!iuta) {
-    /*
-    int nb = GetNumBounds();
-    int i, *kb;
-    kb = malloc(sizeof(int)*nb);
-    for (i = 0; i < nb; i++) kb[i] = 0;
-    */
-    ResetWidMPI();    
-#pragma omp parallel default(shared) private(ic, iz, ilow, iup, skip)
+static int CompareCEPkIndex(const void *p1, const void *p2) {
+  const int *i1, *i2;
+  int i;
+
+  i1 = (const int *) p1;
+  i2 = (const int *) p2;
+  for (i = 0; i < 3; i++) {
+    if (i1[i] < i2[i]) return -1;
+    if (i1[i] > i2[i]) return 1;
+  }
+  return 0;
+}
+
+/*
+** compute CERadialPk for all (k0, k1, k) of the cached transitions, one
+** incident energy at a time. the free orbitals of an energy are solved
+** in one batch and shared by all its integrals. unless the m-sublevel
+** integrals still need their phase shifts, the wavefunctions are
+** released before moving on to the next energy.
+*/
+static void PrepCEPk(int msub) {
+  int ic, iz, i, j, ie, m, np, nkl, nklp;
+  int *ik, *n, *ka;
+  double *e, c, cmax, mc, mc1;
+
+  /* pure born approximation, no partial waves */
+  if (xborn == 0 || xborn < -1E30) return;
+  np = 0;
+  for (ic = 0; ic < cecache.nc; ic++) {
+    if (cecache.nz[ic] > 0) np += cecache.nz[ic];
+  }
+  if (np == 0) return;
+  ik = malloc(sizeof(int)*3*np);
+  np = 0;
+  for (ic = 0; ic < cecache.nc; ic++) {
+    cmax = 0.0;
+    for (iz = 0; iz < cecache.nz[ic]; iz++) {
+      c = fabs(cecache.az[ic][iz].coeff);
+      if (c > cmax) cmax = c;
+    }
+    for (iz = 0; iz < cecache.nz[ic]; iz++) {
+      /* the pairs skipped in CollisionStrengthZ */
+      c = fabs(cecache.az[ic][iz].coeff);
+      if (c*cmax < EPS30) continue;
+      ik[3*np] = cecache.az[ic][iz].k0;
+      ik[3*np+1] = cecache.az[ic][iz].k1;
+      ik[3*np+2] = cecache.az[ic][iz].k;
+      np++;
+    }
+  }
+  if (np == 0) {
+    free(ik);
+    return;
+  }
+  qsort(ik, np, sizeof(int)*3, CompareCEPkIndex);
+  j = 0;
+  for (i = 1; i < np; i++) {
+    if (CompareCEPkIndex(ik+3*j, ik+3*i) == 0) continue;
+    j++;
+    if (j < i) memcpy(ik+3*j, ik+3*i, sizeof(int)*3);
+  }
+  np = j+1;
+
+  mc = MColl();
+  if (fabs(mc-1)<1e-3) mc = 0;
+  mc1 = mc;
+  if (mc1 <= 0) mc1 = 1.0;
+  m = 2*pw_scratch.nkl*(1+n_tegrid);
+  n = malloc(sizeof(int)*m);
+  ka = malloc(sizeof(int)*m);
+  e = malloc(sizeof(double)*m);
+  nkl = pw_scratch.nkl;
+  for (ie = n_egrid-1; ie >= 0; ie--) {
+    m = CEOrbitalsE(ie, nkl, n, ka, e);
+    SolveOrbitalsBatch(m, n, ka, e);
+    nklp = 0;
+#pragma omp parallel default(shared) private(i)
     {
-      for (ic = 0; ic < cecache.nc; ic++) {
-	ilow = cecache.low[ic];
-	iup = cecache.up[ic];
-	skip = SkipMPI();
-	if (skip) continue;
-	cecache.nz[ic] = AngularZMix(&cecache.az[ic], ilow, iup,
-				     -1, -1,
-				     &cecache.nmk[ic],
-				     &cecache.mbk[ic]);
-	/*
-	for (iz = 0; iz < cecache.nz[ic]; iz++) {
-	  if (cecache.az[ic][iz].k0 != cecache.az[ic][iz].k1) {
-	    kb[cecache.az[ic][iz].k0] |= 1;
-	    kb[cecache.az[ic][iz].k1] |= 2;
-	  } else {
-	    kb[cecache.az[ic][iz].k0] |= 4;
-	  }
-	}
-	*/
+#pragma omp for schedule(dynamic) reduction(max:nklp)
+      for (i = 0; i < np; i++) {
+	CEPK *cepk;
+	CERadialPk(&cepk, ie, ik[3*i], ik[3*i+1], ik[3*i+2], 0);
+	if (cepk->nkl > nklp) nklp = cepk->nkl;
       }
     }
-    /*
-    int nks, nkd0, nkd1;
-    nks = 0;
-    nkd0 = 0;
-    nkd1 = 0;
-    for (i = 0; i < nb; i++) {
-      if (kb[i] == 4) nks++;
-      else {
-	if (kb[i] & 1) nkd0++;
-	if (kb[i] & 2) nkd1++;
+    /* 
+    ** with the adaptive partial wave sum, the lower energies are
+    ** expected to stop earlier. the partial waves beyond the cutoff of
+    ** this energy are solved on demand by CERadialPk.
+    */
+    if (pw_klcut && pw_tol > 0) {
+      nkl = Min(nklp+1, pw_scratch.nkl);
+    }
+    if (!msub) {
+      /* all energies of the partial waves, including those beyond
+	 max_kl solved on demand by CERadialPk */
+      e[0] = egrid[ie];
+      for (i = 0; i < n_tegrid; i++) {
+	e[i+1] = egrid[ie] + tegrid[i]/mc1;
+      }
+      if (mc > 0) {
+	for (i = 0; i <= n_tegrid; i++) e[i] *= mc;
       }
+      ReleaseContinua(n_tegrid+1, e);
     }
-    int *ks = NULL, *kd0 = NULL, *kd1 = NULL;
-    if (nks > 0) {
-      ks = malloc(sizeof(int)*nks);
+  }
+  free(n);
+  free(ka);
+  free(e);
+  free(ik);
+}
+
+/*
+** the cache entries from ic0 up to the returned index are processed
+** together. they share the lower level, at most ce_batch of them.
+*/
+static int CEBlockEnd(int ic0, int msub, int iuta) {
+  int ic;
+
+  if (msub || iuta || fpw || ce_batch <= 1) return ic0+1;
+  for (ic = ic0+1; ic < cecache.nc && ic-ic0 < ce_batch; ic++) {
+    if (cecache.low[ic] != cecache.low[ic0]) break;
+  }
+  return ic;
+}
+
+/*
+** contract the mixing coefficients of the cache entries ic0..ic1-1
+** against the qk tables. for each rank, the coefficients form a matrix
+** C of entries by (k0, k1) channels, and the quadratic forms C.Q.C^T
+** on all tegrid and egrid points come from one dgemm per te axis type.
+** the results are then interpolated to the transition energy, as in
+** CERadialQk. qkz receives 2*n_egrid1 values per entry, and tyz the
+** type, or -9999 for the entries left to the pair loop of
+** CollisionStrengthZ, i.e., those with mbpt corrections.
+*/
+static void CEQkZBatch(int ic0, int ic1, double *qkz, int *tyz) {
+  int nu, nch, ic, u, i, a, b, a0, nk, k, cls, ite, ie, nqk, nc, *p;
+  int *iu, *ch, *tyq, t[3], np = 1, one = 1, ty, haveq;
+  double *te, *cm, *qm, *tm, *rq, *y, **rqp, *xte, x0, c, r;
+  LEVEL *lev1, *lev2;
+  ANGULAR_ZMIX *ang;
+  char trans[] = "N";
+
+  nc = ic1 - ic0;
+  for (i = 0; i < nc; i++) tyz[i] = -9999;
+  iu = malloc(sizeof(int)*nc);
+  te = malloc(sizeof(double)*nc);
+  nu = 0;
+  nch = 0;
+  for (ic = ic0; ic < ic1; ic++) {
+    if (cecache.nz[ic] <= 0 || cecache.nmk[ic] > 0) continue;
+    lev1 = GetLevel(cecache.low[ic]);
+    lev2 = GetLevel(cecache.up[ic]);
+    if (lev1 == NULL || lev2 == NULL) continue;
+    c = lev2->energy - lev1->energy;
+    if (c <= 0) continue;
+    iu[nu] = ic;
+    te[nu] = c;
+    nu++;
+    nch += cecache.nz[ic];
+  }
+  if (nu == 0) {
+    free(iu);
+    free(te);
+    return;
+  }
+  ch = malloc(sizeof(int)*3*nch);
+  nch = 0;
+  for (u = 0; u < nu; u++) {
+    ang = cecache.az[iu[u]];
+    for (i = 0; i < cecache.nz[iu[u]]; i++) {
+      ch[3*nch] = ang[i].k;
+      ch[3*nch+1] = ang[i].k0;
+      ch[3*nch+2] = ang[i].k1;
+      nch++;
     }
-    if (nkd0 > 0) {
-      kd0 = malloc(sizeof(int)*nkd0);
+  }
+  qsort(ch, nch, sizeof(int)*3, CompareCEPkIndex);
+  a = 0;
+  for (i = 1; i < nch; i++) {
+    if (CompareCEPkIndex(ch+3*a, ch+3*i) == 0) continue;
+    a++;
+    if (a < i) memcpy(ch+3*a, ch+3*i, sizeof(int)*3);
+  }
+  nch = a+1;
+
+  nqk = n_tegrid*n_egrid1;
+  for (u = 0; u < nu; u++) {
+    for (ie = 0; ie < n_egrid1; ie++) {
+      qkz[(iu[u]-ic0)*2*n_egrid1 + ie] = 0.0;
+    }
+    tyz[iu[u]-ic0] = -1;
+  }
+  rq = malloc(sizeof(double)*(nqk+n_tegrid));
+  y = rq + nqk;
+  for (a0 = 0; a0 < nch; a0 += nk) {
+    k = ch[3*a0];
+    for (nk = 1; a0+nk < nch; nk++) {
+      if (ch[3*(a0+nk)] != k) break;
+    }
+    cm = malloc(sizeof(double)*nu*nk);
+    for (i = 0; i < nu*nk; i++) cm[i] = 0.0;
+    for (u = 0; u < nu; u++) {
+      ang = cecache.az[iu[u]];
+      for (i = 0; i < cecache.nz[iu[u]]; i++) {
+	if (ang[i].k != k) continue;
+	t[0] = k;
+	t[1] = ang[i].k0;
+	t[2] = ang[i].k1;
+	p = bsearch(t, ch+3*a0, nk, sizeof(int)*3, CompareCEPkIndex);
+	a = (p - ch)/3 - a0;
+	cm[u + a*nu] += ang[i].coeff;
+      }
     }
-    if (nkd1 > 0) {
-      kd1 = malloc(sizeof(int)*nkd1);
-    }    
-    int is = 0, i0 = 0, i1 = 0;
-    for (i = 0; i < nb; i++) {
-      if (kb[i] == 4) ks[is++] = i;
-      else {
-	if (kb[i] & 1) kd0[i0++] = i;
-	if (kb[i] & 2) kd1[i1++] = i;
-      }
-    }
-    IDXARY *iks = NULL, *ikd0 = NULL, *ikd1 = NULL;
-    if (nks > 0) {
-      iks = malloc(sizeof(IDXARY));
-      InitIdxAry(iks, nks, ks);
-    }
-    if (nkd0 > 0) {
-      ikd0 = malloc(sizeof(IDXARY));
-      InitIdxAry(ikd0, nkd0, kd0);
-    }
-    if (nkd1 > 0) {
-      ikd1 = malloc(sizeof(IDXARY));
-      InitIdxAry(ikd1, nkd1, kd1);
-    }
-
-    CEPKK *pk = NULL;
-    int npk = nks + nkd0*nkd1;
-    pk = malloc(sizeof(CEPKK)*npk);
-    for (i = 0; i < npk; i++) {
-      pk[i].kmin = (short)5000;
-      pk[i].kmax = 0;
-    }
-    ORBITAL *orb0, *orb1;
-    int j0, j1, jmin, jmax, k, j, m;
-    for (i = 0; i < nks; i++) {
-      orb0 = GetOrbital(ks[i]);
-      j0 = GetJFromKappa(orb0->kappa);
-      pk[i].kmin = 0;
-      pk[i].kmax = Max(j0, pk[i].kmax);
-    }
-    for (i = 0; i < nkd0; i++) {
-      orb0 = GetOrbital(kd0[i]);
-      j0 = GetJFromKappa(orb0->kappa);
-      for (j = 0; j < nkd1; j++) {
-	orb1 = GetOrbital(kd1[j]);
-	j1 = GetJFromKappa(orb1->kappa);
-	jmin = abs(j0-j1)/2;
-	jmax = (j0+j1)/2;
-	k = nks + i0*nkd1+i1;
-	pk[k].kmin = Max(pk[k].kmin, jmin);
-	pk[k].kmax = Min(pk[k].kmax, jmax);
-      }
-    }
-    for (i = 0; i < npk; i++) {
-      pk[i].pk = malloc(sizeof(CEPK *)*(pk[i].kmax-pk[i].kmin+1));
-      m = 0;
-      for (k = pk[i].kmin; k <= pk[i].kmax; k++, m++) {
-	pk[i].pk[m] = NULL;
-      }
-    }
-    CEQKK *qk = NULL;
-    int nks2 = nks*(1+nks)/2;
-    int nkd01 = nkd0*nkd1;
-    int nksd = nks*nkd01;
-    int nkd2 = nkd01*(1+nkd01)/2;
-    int nqk = nks*(1+nks)/2 + nks*nkd01 + nkd2;
-    int p, q;
-    qk = malloc(sizeof(CEQKK)*nqk);
-    for (i = 0; i < nks; i++) {
-      for (j = 0; j <= i; j++) {
-	m = i*(i+1)/2 + j;
-	qk[m].kmin = pk[i].kmin;
-	qk[m].kmax = pk[i].kmax;
-	qk[m].kminp = pk[j].kmin;
-	qk[m].kmaxp = pk[j].kmax;
-      }
-      for (i0 = 0; i0 < nkd01; i0++) {
-	m = nks2+i*nkd01+i0;
-	qk[m].kmin = pk[i].kmin;
-	qk[m].kmax = pk[i].kmax;
-	qk[m].kminp = pk[i0].kmin;
-	qk[m].kmaxp = pk[i0].kmax;
-      }
-    }
-    for (i0 = 0; i < nkd01; i0++) {
-      for (i1 = 0; i1 <= i0; i1++) {
-	m = nks2+nks*nkd01 + i0*(i0+1)/2 + i1;
-	qk[m].kmin = pk[i0].kmin;
-	qk[m].kmax = pk[i0].kmax;
-	qk[m].kminp = pk[i1].kmin;
-	qk[m].kmaxp = pk[i1].kmax;
-      }
-    }
-
-    for (i = 0; i < nqk; i++) {
-      if (msub) {
-	p = qk[i].kmax-qk[i].kmin+1;
-	q = qk[i].kmaxp-qk[i].kminp+1;
-	qk[i].qk = malloc(sizeof(double *)*p*q);
-	m = 0;
-	for (k = qk[i].kmin; k <= qk[i].kmax; k++) {
-	  for (j = qk[i].kminp; j <= qk[i].kmaxp; j++, m++) {
-	    qk[i].qk[m] = NULL;
-	  }
+    /* only the tables of channel pairs mixed in some entry */
+    rqp = malloc(sizeof(double *)*nk*nk);
+    tyq = malloc(sizeof(int)*nk*nk);
+    for (a = 0; a < nk; a++) {
+      for (b = a; b < nk; b++) {
+	rqp[a*nk+b] = NULL;
+	for (u = 0; u < nu; u++) {
+	  if (fabs(cm[u+a*nu]*cm[u+b*nu]) >= EPS30) break;
 	}
-      } else {
-	qk[i].kmin = Max(qk[i].kmin, qk[i].kminp);
-	qk[i].kmax = Min(qk[i].kmax, qk[i].kmaxp);
-	qk[i].qk = malloc(sizeof(double *)*(qk[i].kmax-qk[i].kmin+1));
-	m = 0;
-	for (k = qk[i].kmin; k <= qk[i].kmax; k++, m++) {
-	  qk[i].qk[m] = NULL;
+	if (u == nu) continue;
+	rqp[a*nk+b] = CERadialQkTable(ch[3*(a0+a)+1], ch[3*(a0+a)+2],
+				      ch[3*(a0+b)+1], ch[3*(a0+b)+2], k, 0);
+	tyq[a*nk+b] = (int) rqp[a*nk+b][nqk];
+	for (u = 0; u < nu; u++) {
+	  if (fabs(cm[u+a*nu]*cm[u+b*nu]) < EPS30) continue;
+	  if (tyq[a*nk+b] > tyz[iu[u]-ic0]) tyz[iu[u]-ic0] = tyq[a*nk+b];
 	}
       }
     }
-
-    ResetWidMPI();
-#pragma omp parallel default(shared) private(ic, skip, iz, ie)
-    {
-      for (ic = 0; ic < cecache.nc; ic++) {
-	skip = SkipMPI();
-	if (skip) continue;
-	for (iz = 0; iz < cecache.nz[ic]; iz++) {
-	  for (ie = 0; ie < n_egrid; ie++) {
-	    CEPK *cepk;
-	    int type = CERadialPk(&cepk, ie,
-				  cecache.az[ic][iz].k0,
-				  cecache.az[ic][iz].k1,
-				  cecache.az[ic][iz].k, 1);
+    qm = malloc(sizeof(double)*nk*nk*nqk);
+    tm = malloc(sizeof(double)*nu*nk*nqk);
+    /* the te interpolation is on log_te for the types 0 and 1 */
+    for (cls = 0; cls < 2; cls++) {
+      haveq = 0;
+      for (a = 0; a < nk; a++) {
+	for (b = a; b < nk; b++) {
+	  if (rqp[a*nk+b] == NULL) ty = -9999;
+	  else if (n_tegrid == 1) ty = cls;
+	  else ty = (tyq[a*nk+b] == 0 || tyq[a*nk+b] == 1)?0:1;
+	  for (i = 0; i < nqk; i++) {
+	    c = (ty == cls)?rqp[a*nk+b][i]:0.0;
+	    qm[a + (b*nqk+i)*nk] = c;
+	    qm[b + (a*nqk+i)*nk] = c;
 	  }
+	  if (ty == cls) haveq = 1;
 	}
       }
+      if (!haveq) continue;
+      DGEMM(trans, trans, nu, nk*nqk, nk, 1.0, cm, nu, qm, nk, 0.0, tm, nu);
+      for (u = 0; u < nu; u++) {
+	for (i = 0; i < nqk; i++) {
+	  r = 0.0;
+	  for (b = 0; b < nk; b++) {
+	    r += cm[u+b*nu]*tm[u + (b*nqk+i)*nu];
+	  }
+	  rq[i] = r/(k + 1.0);
+	}
+	c = 0.0;
+	if (n_tegrid == 1) {
+	  for (ie = 0; ie < n_egrid1; ie++) {
+	    qkz[(iu[u]-ic0)*2*n_egrid1 + ie] += rq[ie];
+	  }
+	} else {
+	  if (cls == 0) {
+	    xte = log_te;
+	    x0 = log(te[u]);
+	  } else {
+	    xte = tegrid;
+	    x0 = te[u];
+	  }
+	  for (ie = 0; ie < n_egrid1; ie++) {
+	    for (ite = 0; ite < n_tegrid; ite++) {
+	      y[ite] = rq[ite*n_egrid1+ie];
+	    }
+	    UVIP3P(np, n_tegrid, xte, y, one, &x0, &c);
+	    qkz[(iu[u]-ic0)*2*n_egrid1 + ie] += c;
+	  }
+	}
+      }
+    }
+    free(cm);
+    free(qm);
+    free(tm);
+    free(rqp);
+    free(tyq);
+  }
+  /* without mbpt corrections both halves are the same */
+  for (u = 0; u < nu; u++) {
+    for (ie = 0; ie < n_egrid1; ie++) {
+      qkz[(iu[u]-ic0)*2*n_egrid1 + n_egrid1 + ie] =
+	qkz[(iu[u]-ic0)*2*n_egrid1 + ie];
     }
+  }
+  free(rq);
+  free(ch);
+  free(iu);
+  free(te);
+}
 
-    ResetWidMPI();
-#pragma omp parallel default(shared) private(ic, iz, jz, skip)
+void ProcessCECache(int msub, int iuta, TFILE *f) {
+  int ic, ic0, ic1, ie, skip, ilow, iup, nparams;
+  CE_RECORD *rs;
+
+  if (qk_mode == QK_FIT) 
+    nparams = NPARAMS;
+  else
+    nparams = 0;
+
+  if (!iuta) {
+    ResetWidMPI();    
+#pragma omp parallel default(shared) private(ic, ic1, ilow, iup, skip)
     {
+      /* distributed by the same blocks as below */
+      ic1 = 0;
       for (ic = 0; ic < cecache.nc; ic++) {
-	skip = SkipMPI();
-	if (skip) continue;
-	for (iz = 0; iz < cecache.nz[ic]; iz++) {
-	  for (jz = iz; jz < cecache.nz[ic]; jz++) {
-	    if (msub) {
-	      double *rqe = CERadialQkMSubTable(cecache.az[ic][iz].k0,
-						cecache.az[ic][iz].k1,
-						cecache.az[ic][jz].k0,
-						cecache.az[ic][jz].k1,
-						cecache.az[ic][iz].k,
-						cecache.az[ic][jz].k, 1);
-	    } else {
-	      if (cecache.az[ic][iz].k != cecache.az[ic][jz].k) continue;
-	      skip = SkipMPI();
-	      if (skip) continue;
-	      double *rqe = CERadialQkTable(cecache.az[ic][iz].k0,
-					    cecache.az[ic][iz].k1,
-					    cecache.az[ic][jz].k0,
-					    cecache.az[ic][jz].k1,
-					    cecache.az[ic][iz].k, 1);
-	    }
-	  }
+	ilow = cecache.low[ic];
+	iup = cecache.up[ic];
+	if (ic == ic1) {
+	  ic1 = CEBlockEnd(ic, msub, iuta);
+	  skip = SkipMPI();
 	}
+	if (skip) continue;
+	cecache.nz[ic] = AngularZMix(&cecache.az[ic], ilow, iup,
+				     -1, -1,
+				     &cecache.nmk[ic],
+				     &cecache.mbk[ic]);
       }
-    }    
-    */
+    }
+    PrepCEPk(msub);
   }
 
+  /*
+  ** the records are kept by the cache index and written in that order
+  ** after the parallel region, so the file does not depend on the
+  ** thread schedule and the threads do not contend for the file lock.
+  */
+  rs = (CE_RECORD *) malloc(sizeof(CE_RECORD)*Max(cecache.nc, 1));
+  for (ic = 0; ic < cecache.nc; ic++) rs[ic].nsub = 0;
   ResetWidMPI();
-#pragma omp parallel default(shared) private(ic, ilow, iup, skip, ie)
+#pragma omp parallel default(shared) private(ic, ic0, ic1, ilow, iup, skip, ie)
   {
-    int nsub, m, k, ip, iempty;
-    double bethe[3];
+    int nsub, m, k, ip, iempty, *tyz;
+    double bethe[3], *qkz;
     double params[MAXMSUB*NPARAMS];
     double qkc[MAXMSUB*MAXNUSR];
     double e;
@@ -2903,15 +3300,32 @@ void ProcessCECache(int msub, int iuta, TFILE *f) {
     }
     m = n_usr * nsub;
     r.strength = (float *) malloc(sizeof(float)*m);
+    m = Max(ce_batch, 1);
+    qkz = (double *) malloc(sizeof(double)*m*2*n_egrid1);
+    tyz = (int *) malloc(sizeof(int)*m);
+    ic0 = 0;
+    ic1 = 0;
     for (ic = 0; ic < cecache.nc; ic++) {
-      skip = SkipMPI();
+      if (ic == ic1) {
+	ic0 = ic;
+	ic1 = CEBlockEnd(ic, msub, iuta);
+	skip = SkipMPI();
+	if (!skip) {
+	  if (ic1 > ic0+1) CEQkZBatch(ic0, ic1, qkz, tyz);
+	  else tyz[0] = -9999;
+	}
+      }
       if (skip) continue;
       ilow = cecache.low[ic];
       iup = cecache.up[ic];
       if (iuta) {
 	k = CollisionStrengthUTA(qkc, params, &e, bethe, ilow, iup);
       } else {
-	k = CollisionStrength(qkc, params, &e, bethe, ilow, iup, msub);
+	m = ic - ic0;
+	k = CollisionStrengthZ(qkc, params, &e, bethe, ilow, iup, msub,
+			       cecache.nz[ic], cecache.az[ic],
+			       cecache.nmk[ic], cecache.mbk[ic],
+			       tyz[m] != -9999?qkz+m*2*n_egrid1:NULL, tyz[m]);
       }
       if (k < 0) continue;
       r.bethe = bethe[0];
@@ -2950,12 +3364,30 @@ void ProcessCECache(int msub, int iuta, TFILE *f) {
 	}
       }
       if (iempty == 0) {
-	WriteCERecord(f, &r);
+	rs[ic] = r;
+	if (msub || qk_mode == QK_FIT) {
+	  m = msub?r.nsub:(nparams*r.nsub);
+	  rs[ic].params = (float *) malloc(sizeof(float)*m);
+	  memcpy(rs[ic].params, r.params, sizeof(float)*m);
+	}
+	m = n_usr*r.nsub;
+	rs[ic].strength = (float *) malloc(sizeof(float)*m);
+	memcpy(rs[ic].strength, r.strength, sizeof(float)*m);
       }
     }
     if (msub || qk_mode == QK_FIT) free(r.params);
     free(r.strength);
+    free(qkz);
+    free(tyz);
   }
+  for (ic = 0; ic < cecache.nc; ic++) {
+    if (rs[ic].nsub <= 0) continue;
+    WriteCERecord(f, &rs[ic]);
+    if (msub || qk_mode == QK_FIT) free(rs[ic].params);
+    free(rs[ic].strength);
+  }
+  free(rs);
+  FreeCECache(1);
 }
 
 int SaveExcitation(int nlow, int *low, int nup, int *up, int msub, char *fn) {
@@ -2983,7 +3415,7 @@ int SaveExcitation(int nlow, int *low, int nup, int *up, int msub, char *fn) {
   double emin, emax, e, c;
   double e0, e1, te0, ei;
   double rmin, rmax, bethe[3];
-  int nc, ilow, iup;
+  int nc, ic, ilow, iup;
 
   iuta = IsUTA();
   if (iuta && msub) {
@@ -3030,12 +3462,9 @@ int SaveExcitation(int nlow, int *low, int nup, int *up, int msub, char *fn) {
     return 0;
   }
 
-  /*
-  if (!iuta) {
-    AllocCECache(msub);
-    PrepAngZStates(nlow, low, nup, up);
+  if (!iuta && pk_pipeline) {
+    AllocCECache(msub, m);
   }
-  */
   ei = 1E31;
   if (iuta) {
     for (j = 0; j < nup; j++) {
@@ -3174,16 +3603,22 @@ int SaveExcitation(int nlow, int *low, int nup, int *up, int msub, char *fn) {
       SetCEEGrid(n_egrid, emin, emax, ce_hdr.te0);
     }
     if (n_usr0 <= 0) {
-      SetUsrCEEGridDetail(n_egrid, egrid);
+      if (n_egrid > MAXNUSR) {
+	/* 
+	** the output grid is bounded by MAXNUSR, the strengths on
+	** the denser egrid are interpolated onto it.
+	*/
+	n_usr = SetEGrid(usr_egrid, log_usr, MAXNUSR,
+			 egrid[0], egrid[n_egrid-1], 0.0);
+	if (qk_mode == QK_EXACT) qk_mode = QK_INTERPOLATE;
+      } else {
+	SetUsrCEEGridDetail(n_egrid, egrid);
+      }
       usr_egrid_type = 1;
     } else if (!usr_set) {
       SetUsrCEEGrid(n_usr, emin, emax, ce_hdr.te0);
       usr_egrid_type = 1;
     }
-    if (n_egrid > MAXNE) {
-      printf("n_egrid exceeded MAXNE=%d\n", MAXNE);
-      return -1;
-    }
     n_egrid1 = n_egrid + 1;
     ie = n_egrid;
     if (eborn > 0.0) {
@@ -3196,13 +3631,17 @@ int SaveExcitation(int nlow, int *low, int nup, int *up, int msub, char *fn) {
       printf("n_egrid must > %d to use QK_FIT mode\n", NPARAMS);
       return -1;
     }
+    if (qk_mode == QK_FIT && n_egrid > MAXNUSR) {
+      printf("n_egrid must <= %d to use QK_FIT mode\n", MAXNUSR);
+      return -1;
+    }
     if (qk_mode == QK_INTERPOLATE) {
       for (i = 0; i < n_egrid; i++) {
 	log_egrid[i] = egrid[i];
 	if (egrid_type == 1) log_egrid[i] += ce_hdr.te0;
 	log_egrid[i] = log(log_egrid[i]);
       }
-      for (i = 0; i < n_egrid; i++) {
+      for (i = 0; i < n_usr; i++) {
 	log_usr[i] = usr_egrid[i];
 	if (usr_egrid_type == 1) log_usr[i] += ce_hdr.te0;
 	log_usr[i] = log(log_usr[i]);
@@ -3232,6 +3671,43 @@ int SaveExcitation(int nlow, int *low, int nup, int *up, int msub, char *fn) {
     ce_hdr.egrid = egrid;
     ce_hdr.usr_egrid = usr_egrid;
     InitFile(f, &fhdr, &ce_hdr);
+    if (pw_tol > 0 && !msub && !iuta) {
+      pw_klcut = (int *) malloc(sizeof(int)*3*n_egrid);
+      for (i = 0; i < 3*n_egrid; i++) pw_klcut[i] = 0;
+    }
+    if (!iuta && pk_pipeline) {
+      ic = 0;
+      for (i = 0; i < nlow; i++) {
+	lev1 = GetLevel(low[i]);
+	for (j = 0; j < nup; j++) {
+	  lev2 = GetLevel(up[j]);
+	  e = lev2->energy - lev1->energy;
+	  ilow = low[i];
+	  iup = up[j];
+	  if (i < nlow-nc || j < nup-nc) {
+	    if (e < 0) {
+	      ilow = up[j];
+	      iup = low[i];
+	      e = -e;
+	    }
+	  }
+	  if (e < e0 || e >= e1) continue;
+	  cecache.low[ic] = ilow;
+	  cecache.up[ic] = iup;
+	  ic++;
+	  if (ic == cecache.m) {
+	    cecache.nc = ic;
+	    ic = 0;
+	    ProcessCECache(msub, iuta, f);
+	  }
+	}
+      }
+      if (ic > 0) {
+	cecache.nc = ic;
+	ProcessCECache(msub, iuta, f);
+      }
+    } else {
+    PrepCEOrbitals();
     ResetWidMPI();
 #pragma omp parallel default(shared) private(i, j, lev1, lev2, e, ilow, iup, k, qkc, params, bethe, r, m, ip, nsub, ie, iempty)
     {
@@ -3312,30 +3788,25 @@ int SaveExcitation(int nlow, int *low, int nup, int *up, int msub, char *fn) {
     if (msub || qk_mode == QK_FIT) free(r.params);
     free(r.strength);
     }
-  /*
-    cecache.low[ic] = ilow;
-    cecache.up[ic] = iup;
-    ic++;
-    if (ic == maxcecache) {
-    cecache.nc = ic;
-    ic = 0;
-    ProcessCECache(msub, iuta, f);
-    }
-    }
     }
-    if (ic > 0) {
-      cecache.nc = ic;
-      ProcessCECache(msub, iuta, f);
-    }
-  */
     DeinitFile(f, &fhdr);
+    if (pw_klcut) {
+      /* the partial wave cutoffs reached in this block */
+      for (ie = 0; ie < n_egrid; ie++) {
+	MPrintf(0, "CE kl cutoff: %12.5E %12.5E %4d %6d %6d\n",
+		ce_hdr.te0*HARTREE_EV, egrid[ie]*HARTREE_EV,
+		pw_klcut[3*ie], pw_klcut[3*ie+1], pw_klcut[3*ie+2]);
+      }
+      free(pw_klcut);
+      pw_klcut = NULL;
+    }
     e0 = e1;
     FreeExcitationQk();
     ReinitRadial(2);
   }
   
   ReinitExcitation(1);
-  //FreeCECache(0);
+  FreeCECache(0);
   ArrayFreeLock(&subte, NULL);
   if (alev) free(alev);
   CloseFile(f, &fhdr);
@@ -3377,6 +3848,9 @@ int SaveExcitation(int nlow, int *low, int nup, int *up, int msub, char *fn) {
 	  ((double)radt.radial_1e)/CLOCKS_PER_SEC,
 	  ((double)radt.radial_slater)/CLOCKS_PER_SEC,
 	  ((double)radt.radial_2e)/CLOCKS_PER_SEC);
+  fprintf(perform_log, "Yk: %6.1E, RPowTable: %ld, RPowCall: %ld\n",
+	  ((double)radt.radial_yk)/CLOCKS_PER_SEC,
+	  radt.nrpow_table, radt.nrpow_pow);
   fprintf(perform_log, "RadPk: %6.1E, SetKappa: %6.1E, RadQk: %6.1E\n",
 	  ((double)timing.rad_pk)/CLOCKS_PER_SEC, 
 	  ((double)timing.set_kappa)/CLOCKS_PER_SEC, 
@@ -3406,7 +3880,7 @@ int SaveExcitationEB(int nlow0, int *low0, int nup0, int *up0, char *fn) {
   double rmin, rmax, bethe[3];
   int nc, ilow, iup;
   TFILE *f;
-  double qkc[MAXNE+1];
+  double *qkc;
  
   if (GetLowUpEB(&nlow, &low, &nup, &up, nlow0, low0, nup0, up0) == -1)
     return 0;
@@ -3550,10 +4024,6 @@ int SaveExcitationEB(int nlow0, int *low0, int nup0, int *up0, char *fn) {
     if (!e_set) {
       SetCEEGrid(n_egrid, emin, emax, ce_hdr.te0);
     }
-    if (n_egrid > MAXNE) {
-      printf("n_egrid exceeded MAXNE=%d\n", MAXNE);
-      return -1;
-    }
     n_egrid1 = n_egrid + 1;
     ie = n_egrid;
     if (eborn > 0.0) {
@@ -3582,6 +4052,7 @@ int SaveExcitationEB(int nlow0, int *low0, int nup0, int *up0, char *fn) {
 #pragma omp parallel default(shared) private(i, j, r, lev1, lev2, e, ilow, iup, k, iempty, ie, qkc, bethe)
     {
     r.strength = (float *) malloc(sizeof(float)*m);    
+    qkc = (double *) malloc(sizeof(double)*n_egrid1);
     for (i = 0; i < nlow; i++) {
       lev1 = GetEBLevel(low[i]);
       for (j = 0; j < nup; j++) {
@@ -3619,6 +4090,7 @@ int SaveExcitationEB(int nlow0, int *low0, int nup0, int *up0, char *fn) {
       }
     }
     free(r.strength);
+    free(qkc);
     }
     DeinitFile(f, &fhdr);
     e0 = e1;
@@ -3746,7 +4218,7 @@ int SaveExcitationEBD(int nlow0, int *low0, int nup0, int *up0, char *fn) {
   te0 = emax;
   
   m = n_thetagrid*n_phigrid;
-  qkc = (double *) malloc(sizeof(double)*(MAXNE+2)*m);
+  qkc = NULL;
   bethe = (double *) malloc(sizeof(double)*m);
   born = (double *) malloc(sizeof(double)*(m+1));
   e0 = emin*0.999;
@@ -3809,11 +4281,9 @@ int SaveExcitationEBD(int nlow0, int *low0, int nup0, int *up0, char *fn) {
     if (!e_set) {
       SetCEEGrid(n_egrid, emin, emax, ce_hdr.te0);
     }
-    if (n_egrid > MAXNE) {
-      printf("n_egrid exceeded MAXNE=%d\n", MAXNE);
-      return -1;
-    }
     n_egrid1 = n_egrid + 2;
+    free(qkc);
+    qkc = (double *) malloc(sizeof(double)*n_egrid1*n_thetagrid*n_phigrid);
     ie = n_egrid+1;
     if (eborn > 0.0) {
       egrid[ie] = Max(te0,ei)*eborn;
@@ -3939,6 +4409,8 @@ int InitExcitation(void) {
   n_egrid = 0;
   n_tegrid = 0;
   n_usr = 0;
+  AllocCEGrid(&egrid, &log_egrid, &m_egrid, MAXNE+2);
+  AllocCEGrid(&tegrid, &log_te, &m_tegrid, MAXNTE);
   egrid[0] = -1.0;
   SetCEEGridLimits(0.05, 8.0, 0);
   usr_egrid[0] = -1.0;
@@ -3979,4 +4451,16 @@ void SetOptionExcitation(char *s, char *sp, int ip, double dp) {
     pw_scratch.min_kl = ip;
     return;
   }
+  if (strcmp("excitation:pk_pipeline", s) == 0) {
+    pk_pipeline = ip;
+    return;
+  }
+  if (strcmp("excitation:batch", s) == 0) {
+    ce_batch = ip;
+    return;
+  }
+  if (strcmp("excitation:pw_tol", s) == 0) {
+    pw_tol = dp;
+    return;
+  }
 }
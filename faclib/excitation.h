@@ -32,8 +32,9 @@ typedef struct _CEPW_SCRATCH_ {
   int nkl0;
   int nkl;
   int ns;
-  double kl[MAXNKL+1];
-  double log_kl[MAXNKL];
+  int mkl;
+  double *kl;
+  double *log_kl;
 } CEPW_SCRATCH;
 
 typedef struct _CEPK_ {
@@ -81,7 +82,7 @@ typedef struct _EXCIT_TIMING_ {
 
 CEPW_SCRATCH *GetCEPWScratch(void);
 void SetMaxCECache(int n);
-void AllocCECache(int msub);
+void AllocCECache(int msub, int n);
 void FreeCECache(int m);
 void FreeCEQKK(CEQKK *qk, int m);
 void FreeCEPKK(CEPKK *pk);
@@ -113,6 +114,7 @@ int SetUsrCEEGridDetail(int n, double *x);
 int SetUsrCEEGrid(int n, double emin, double emax, double eth);
 
 int CERadialPk(CEPK **pk, int ie, int k0, int k1, int k, int trylock);
+double TopUpQk(double b, double c, double k0, double a, double te, double e1);
 int CERadialQkBorn(int k0, int k1, int k2, int k3, int k, 
 		   double te, double e1, double *qk, int m);
 int CERadialQkBornMSub(int k0, int k1, int k2, int k3, int k, int kp,
@@ -73,6 +73,15 @@
 
 #include "mpiutil.h"
 
+/* loops over the radial grid are also compiled for the wider vector
+   units, the version matching the cpu is chosen at load time. */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+  defined(__linux__) && !defined(NO_SIMD_CLONES)
+#define SIMD_CLONES __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define SIMD_CLONES
+#endif
+
 #define USEBF 1
 #ifdef USEBF
 #define TFILE BFILE
@@ -24,13 +24,17 @@ static char *rcsid="$Id$";
 USE (rcsid);
 #endif
 
+/*
+** the partial wave grids hold at most mkl points. kl needs one more
+** element for the maxkl+1 appended by SetPWGrid.
+*/
 int AddPW(int *nkl0, double *kl, double *logkl, 
-	  int maxkl, int n, int step) {
+	  int maxkl, int n, int step, int mkl) {
   int i;
   for (i = *nkl0; i < n+(*nkl0); i++) {
-    if (i >= MAXNKL) {
+    if (i >= mkl) {
       printf("Maximum partial wave grid points reached: "); 
-      printf("%d > %d in constructing grid\n",  i, MAXNKL);
+      printf("%d > %d in constructing grid\n",  i, mkl);
       exit(1);
     }
     kl[i] = kl[i-1] + step;
@@ -42,26 +46,26 @@ int AddPW(int *nkl0, double *kl, double *logkl,
 }
 
 int SetPWGrid(int *nkl0, double *kl, double *logkl, 
-	      int maxkl, int *ns, int *n, int *step) {
+	      int maxkl, int *ns, int *n, int *step, int mkl) {
   int i, m, k, j;
 
   if ((*ns) > 0) {
     for (i = 0; i < (*ns); i++) {
-      AddPW(nkl0, kl, logkl, maxkl, n[i], step[i]);
+      AddPW(nkl0, kl, logkl, maxkl, n[i], step[i], mkl);
     }
     k = step[(*ns)-1]*2;
     j = 2;
   } else {
     (*ns) = -(*ns);
     if ((*ns) == 0) (*ns) = 8;
-    AddPW(nkl0, kl, logkl, maxkl, (*ns), 1);
+    AddPW(nkl0, kl, logkl, maxkl, (*ns), 1, mkl);
     k = 2;
     j = 2;
   }   
 
   m = kl[(*nkl0)-1];
   while (m+k <= maxkl) {
-    AddPW(nkl0, kl, logkl, maxkl, j, k);
+    AddPW(nkl0, kl, logkl, maxkl, j, k, mkl);
     m = kl[(*nkl0)-1];
     if (k < 8) k *= 2;
     else k += 4;
@@ -73,11 +77,6 @@ int SetPWGrid(int *nkl0, double *kl, double *logkl,
 int SetTEGridDetail(double *te, double *logte, int n, double *x) {
   int i;
   
-  if (n > MAXNTE) {
-    printf("Max # of grid points reached \n");
-    return -1;
-  }
-
   for (i = 0; i < n; i++) {
     te[i] = x[i];
     logte[i] = log(te[i]);
@@ -99,11 +98,6 @@ int SetTEGrid(double *te, double *logte, int n, double emin, double emax) {
     return n;
   }
 
-  if (n > MAXNTE) {
-    printf("Max # of grid points reached \n");
-    return -1;
-  }
-
   if (n == 1) {
     te[0] = emin;
     if (logte) logte[0] = log(emin);
@@ -22,9 +22,9 @@
 #include "global.h"
 
 int AddPW(int *nkl0, double *kl, double *logkl, 
-	  int maxkl, int n, int step);
+	  int maxkl, int n, int step, int mkl);
 int SetPWGrid(int *nkl0, double *kl, double *logkl, 
-	      int maxkl, int *ns, int *n, int *step);
+	      int maxkl, int *ns, int *n, int *step, int mkl);
 int SetTEGridDetail(double *te, double *logte, int n, double *x);
 int SetTEGrid(double *te, double *logte, int n, double emin, double emax);
 int SetEGridDetail(double *e, double *log_e, int n, double *xg);
@@ -19,6 +19,7 @@
 #include "interpolation.h"
 #include "cf77.h"
 #include "nucleus.h"
+#include <float.h>
 
 static char *rcsid="$Id$";
 #if __GNUC__ == 2
@@ -451,8 +452,106 @@ double Simpson(double *x, int i0, int i1) {
   return b;
 }
 
-/* original integration by newton-cotes formula */
+/* sum of x[i] for i = i0, i0+2, ..., below i1 */
+static SIMD_CLONES double StrideSum2(double *x, int i0, int i1) {
+  int i;
+  double a;
+
+  a = 0.0;
+  for (i = i0; i < i1; i += 2) {
+    a += x[i];
+  }
+  return a;
+}
+
+/* increments of the cumulative simpson rule,
+   d[i-s] = c0*(x[i-2]+x[i]) + c1*x[i-1], for i0 <= i <= i1 */
+static SIMD_CLONES void SimpsonSteps(double *d, int s, double *x,
+				     int i0, int i1, double c0, double c1) {
+  int i;
+
+  for (i = i0; i <= i1; i++) {
+    d[i-s] = c0*(x[i-2]+x[i]) + c1*x[i-1];
+  }
+}
+
+/* integration by newton-cotes formula. in the cumulative mode, m < 0,
+   the increments are computed at once, followed by the prefix sum
+   over every other point. */
 int NewtonCotes(double *r, double *x, int i0, int i1, int m, int id) {
+  int i, k;
+  double yp;
+
+  if (id >= 0) {
+    if (m >= 0) {
+      r[i1] = x[i0];
+      r[i1] += 4.0*StrideSum2(x, i0+1, i1);
+      k = i1-1;
+      r[i1] += 2.0*StrideSum2(x, i0+2, k);
+      if (IsEven(i1-i0)) {
+	r[i1] += x[i1];
+	r[i1] /= 3.0;
+      } else {
+	r[i1] += x[k];
+	r[i1] /= 3.0;
+	r[i1] += 0.5*(x[k] + x[i1]);
+      }
+      r[i1] += r[i0];
+    } else {
+      i = i0+1;
+      if (x[i0] > 0 && x[i] > 0) {
+	yp = exp(0.5*(log(x[i0])+log(x[i])));
+      } else if (x[i0] < 0 && x[i] < 0) {
+	yp = -exp(0.5*(log(-x[i0])+log(-x[i])));
+      } else {
+	yp = 0.5*(x[i0]+x[i]);
+      }
+      r[i0+1] = r[i0] + 0.5*(_CNC[2][0]*(x[i0]+x[i0+1]) + _CNC[2][1]*yp);
+      SimpsonSteps(r, 0, x, i0+2, i1, _CNC[2][0], _CNC[2][1]);
+      for (i = i0+2; i <= i1; i++) {
+	r[i] += r[i-2];
+      }
+    }
+  } else {
+    if (m >= 0) {
+      r[i1] = x[i1];
+      k = i0+1;
+      if (IsEven(i1-i0)) {
+	r[i1] += 4.0*StrideSum2(x, k, i1);
+	r[i1] += 2.0*StrideSum2(x, i0+2, i1-1);
+	r[i1] += x[i0];
+	r[i1] /= 3.0;
+      } else {
+	r[i1] += 4.0*StrideSum2(x, i0+2, i1);
+	r[i1] += 2.0*StrideSum2(x, i0+3, i1-1);
+	r[i1] += x[k];
+	r[i1] /= 3.0;
+	r[i1] += 0.5*(x[k] + x[i0]);
+      }
+      r[i1] += r[i0];
+    } else {
+      i = i1-1;
+      if (x[i1] > 0 && x[i] > 0) {
+	yp = exp(0.5*(log(x[i1])+log(x[i])));
+      } else if (x[i1] < 0 && x[i] < 0) {
+	yp = -exp(0.5*(log(-x[i1])+log(-x[i])));
+      } else {
+	yp = 0.5*(x[i1]+x[i]);
+      }
+      r[i1-1] = r[i1] + 0.5*(_CNC[2][0]*(x[i1]+x[i1-1]) + _CNC[2][1]*yp);
+      SimpsonSteps(r, 2, x, i0+2, i1, _CNC[2][0], _CNC[2][1]);
+      for (i = i1-2; i >= i0; i--) {
+	r[i] += r[i+2];
+      }
+    }
+  }
+
+  return 0;
+}
+
+/* original integration by newton-cotes formula, kept as the reference
+   of the vectorized NewtonCotes. */
+int NewtonCotes0(double *r, double *x, int i0, int i1, int m, int id) {
   int i, k;
   double a, yp;
 
@@ -629,6 +728,438 @@ int NewtonCotesIP(double *r, double *x, int i0, int i1, int m, int id) {
   return 0;
 }
 
+/*
+** adaptive integration with the 21-point gauss-kronrod rule and the
+** epsilon algorithm, a c version of the quadpack routines dqags,
+** dqagse, dqk21, dqpsrt and dqelg. unlike the fortran dqags, the
+** integrand takes a context pointer, so that it is reentrant.
+** the arrays are indexed from 1 as in the fortran code.
+*/
+static const double _qk21_wg[6] = {0.0,
+  0.066671344308688137593568809893332,
+  0.149451349150580593145776339657697,
+  0.219086362515982043995534934228163,
+  0.269266719309996355091226921569469,
+  0.295524224714752870173892994651338};
+static const double _qk21_xgk[12] = {0.0,
+  0.995657163025808080735527280689003,
+  0.973906528517171720077964012084452,
+  0.930157491355708226001207180059508,
+  0.865063366688984510732096688423493,
+  0.780817726586416897063717578345042,
+  0.679409568299024406234327365114874,
+  0.562757134668604683339000099272694,
+  0.433395394129247190799265943165784,
+  0.294392862701460198131126603103866,
+  0.148874338981631210884826001129720,
+  0.000000000000000000000000000000000};
+static const double _qk21_wgk[12] = {0.0,
+  0.011694638867371874278064396062192,
+  0.032558162307964727478818972459390,
+  0.054755896574351996031381300244580,
+  0.075039674810919952767043140916190,
+  0.093125454583697605535065465083366,
+  0.109387158802297641899210590325805,
+  0.123491976262065851077958109831074,
+  0.134709217311473325928054001771707,
+  0.142775938577060080797094273138717,
+  0.147739104901338491374841515972068,
+  0.149445554002916905664936468389821};
+
+static void QK21(double (*f)(double, void *), void *p, double a, double b,
+		 double *result, double *abserr,
+		 double *resabs, double *resasc) {
+  double absc, centr, dhlgth, fc, fsum, fval1, fval2, hlgth;
+  double resg, resk, reskh, fv1[11], fv2[11];
+  double epmach = DBL_EPSILON, uflow = DBL_MIN;
+  int j, jtw, jtwm1;
+
+  centr = 0.5*(a+b);
+  hlgth = 0.5*(b-a);
+  dhlgth = fabs(hlgth);
+  resg = 0.0;
+  fc = f(centr, p);
+  resk = _qk21_wgk[11]*fc;
+  *resabs = fabs(resk);
+  for (j = 1; j <= 5; j++) {
+    jtw = 2*j;
+    absc = hlgth*_qk21_xgk[jtw];
+    fval1 = f(centr-absc, p);
+    fval2 = f(centr+absc, p);
+    fv1[jtw] = fval1;
+    fv2[jtw] = fval2;
+    fsum = fval1+fval2;
+    resg = resg+_qk21_wg[j]*fsum;
+    resk = resk+_qk21_wgk[jtw]*fsum;
+    *resabs = *resabs+_qk21_wgk[jtw]*(fabs(fval1)+fabs(fval2));
+  }
+  for (j = 1; j <= 5; j++) {
+    jtwm1 = 2*j-1;
+    absc = hlgth*_qk21_xgk[jtwm1];
+    fval1 = f(centr-absc, p);
+    fval2 = f(centr+absc, p);
+    fv1[jtwm1] = fval1;
+    fv2[jtwm1] = fval2;
+    fsum = fval1+fval2;
+    resk = resk+_qk21_wgk[jtwm1]*fsum;
+    *resabs = *resabs+_qk21_wgk[jtwm1]*(fabs(fval1)+fabs(fval2));
+  }
+  reskh = resk*0.5;
+  *resasc = _qk21_wgk[11]*fabs(fc-reskh);
+  for (j = 1; j <= 10; j++) {
+    *resasc = *resasc+_qk21_wgk[j]*(fabs(fv1[j]-reskh)+fabs(fv2[j]-reskh));
+  }
+  *result = resk*hlgth;
+  *resabs = *resabs*dhlgth;
+  *resasc = *resasc*dhlgth;
+  *abserr = fabs((resk-resg)*hlgth);
+  if (*resasc != 0.0 && *abserr != 0.0) {
+    *abserr = *resasc*Min(1.0, pow(200.0*(*abserr)/(*resasc), 1.5));
+  }
+  if (*resabs > uflow/(50.0*epmach)) {
+    *abserr = Max((epmach*50.0)*(*resabs), *abserr);
+  }
+}
+
+/* maintain the descending ordering of the error estimates */
+static void QPSRT(int limit, int last, int *maxerr, double *ermax,
+		  double *elist, int *iord, int *nrmax) {
+  double errmax, errmin;
+  int i, ido, isucc, j, jbnd, jupbn, k;
+
+  if (last <= 2) {
+    iord[1] = 1;
+    iord[2] = 2;
+    goto done;
+  }
+  errmax = elist[*maxerr];
+  if (*nrmax != 1) {
+    ido = *nrmax-1;
+    for (i = 1; i <= ido; i++) {
+      isucc = iord[*nrmax-1];
+      if (errmax <= elist[isucc]) break;
+      iord[*nrmax] = isucc;
+      (*nrmax)--;
+    }
+  }
+  jupbn = last;
+  if (last > (limit/2+2)) jupbn = limit+3-last;
+  errmin = elist[last];
+  jbnd = jupbn-1;
+  for (i = *nrmax+1; i <= jbnd; i++) {
+    isucc = iord[i];
+    if (errmax >= elist[isucc]) break;
+    iord[i-1] = isucc;
+  }
+  if (i > jbnd) {
+    iord[jbnd] = *maxerr;
+    iord[jupbn] = last;
+    goto done;
+  }
+  iord[i-1] = *maxerr;
+  k = jbnd;
+  for (j = i; j <= jbnd; j++) {
+    isucc = iord[k];
+    if (errmin < elist[isucc]) break;
+    iord[k+1] = isucc;
+    k--;
+  }
+  if (j > jbnd) iord[i] = last;
+  else iord[k+1] = last;
+  
+ done:
+  *maxerr = iord[*nrmax];
+  *ermax = elist[*maxerr];
+}
+
+/* the epsilon algorithm, epstab holds up to 52 elements */
+static void QELG(int *n, double *epstab, double *result, double *abserr,
+		 double *res3la, int *nres) {
+  double delta1, delta2, delta3, epsinf, error, err1, err2, err3;
+  double e0, e1, e1abs, e2, e3, res, ss, tol1, tol2, tol3;
+  double epmach = DBL_EPSILON, oflow = DBL_MAX;
+  int i, ib, ib2, ie, indx, k1, k2, k3, limexp, newelm, num;
+
+  (*nres)++;
+  *abserr = oflow;
+  *result = epstab[*n];
+  if (*n < 3) goto done;
+  limexp = 50;
+  epstab[*n+2] = epstab[*n];
+  newelm = (*n-1)/2;
+  epstab[*n] = oflow;
+  num = *n;
+  k1 = *n;
+  for (i = 1; i <= newelm; i++) {
+    k2 = k1-1;
+    k3 = k1-2;
+    res = epstab[k1+2];
+    e0 = epstab[k3];
+    e1 = epstab[k2];
+    e2 = res;
+    e1abs = fabs(e1);
+    delta2 = e2-e1;
+    err2 = fabs(delta2);
+    tol2 = Max(fabs(e2), e1abs)*epmach;
+    delta3 = e1-e0;
+    err3 = fabs(delta3);
+    tol3 = Max(e1abs, fabs(e0))*epmach;
+    if (err2 <= tol2 && err3 <= tol3) {
+      *result = res;
+      *abserr = err2+err3;
+      goto done;
+    }
+    e3 = epstab[k1];
+    epstab[k1] = e1;
+    delta1 = e1-e3;
+    err1 = fabs(delta1);
+    tol1 = Max(e1abs, fabs(e3))*epmach;
+    if (err1 <= tol1 || err2 <= tol2 || err3 <= tol3) {
+      *n = i+i-1;
+      break;
+    }
+    ss = 1.0/delta1+1.0/delta2-1.0/delta3;
+    epsinf = fabs(ss*e1);
+    if (epsinf <= 1e-4) {
+      *n = i+i-1;
+      break;
+    }
+    res = e1+1.0/ss;
+    epstab[k1] = res;
+    k1 = k1-2;
+    error = err2+fabs(res-e2)+err3;
+    if (error > *abserr) continue;
+    *abserr = error;
+    *result = res;
+  }
+  if (*n == limexp) *n = 2*(limexp/2)-1;
+  ib = 1;
+  if ((num/2)*2 == num) ib = 2;
+  ie = newelm+1;
+  for (i = 1; i <= ie; i++) {
+    ib2 = ib+2;
+    epstab[ib] = epstab[ib2];
+    ib = ib2;
+  }
+  if (num != *n) {
+    indx = num-*n+1;
+    for (i = 1; i <= *n; i++) {
+      epstab[i] = epstab[indx];
+      indx++;
+    }
+  }
+  if (*nres < 4) {
+    res3la[*nres] = *result;
+    *abserr = oflow;
+  } else {
+    *abserr = fabs(*result-res3la[3])+fabs(*result-res3la[2])
+      +fabs(*result-res3la[1]);
+    res3la[1] = res3la[2];
+    res3la[2] = res3la[3];
+    res3la[3] = *result;
+  }
+
+ done:
+  *abserr = Max(*abserr, 5.0*epmach*fabs(*result));
+}
+
+/*
+** integrate f(x, p) from a to b to the tolerance max(epsabs,
+** epsrel*|result|). limit is the maximum number of subintervals,
+** iwork must hold limit+1 integers, and work 4*(limit+1) doubles.
+** returns the error code ier of dqags.
+*/
+int QuadAGS(double (*f)(double, void *), void *p, double a, double b,
+	    double epsabs, double epsrel, double *result, double *abserr,
+	    int *neval, int limit, int *iwork, double *work) {
+  double *alist, *blist, *rlist, *elist;
+  double rlist2[53], res3la[4];
+  double area, area1, area12, area2, a1, a2, b1, b2, abseps, correc;
+  double defabs, defab1, defab2, dres, erlarg, erlast, errbnd, errmax;
+  double error1, error2, erro12, errsum, ertest, resabs, reseps, small;
+  double epmach = DBL_EPSILON, uflow = DBL_MIN, oflow = DBL_MAX;
+  int *iord, ier, ierro, iroff1, iroff2, iroff3, jupbnd, k, ksgn;
+  int ktmin, last, maxerr, nres, nrmax, numrl2, extrap, noext, next;
+
+  iord = iwork;
+  alist = work;
+  blist = alist + limit+1;
+  rlist = blist + limit+1;
+  elist = rlist + limit+1;
+  ier = 0;
+  *neval = 0;
+  *result = 0.0;
+  *abserr = 0.0;
+  if (limit < 1) return 6;
+  alist[1] = a;
+  blist[1] = b;
+  rlist[1] = 0.0;
+  elist[1] = 0.0;
+  if (epsabs <= 0.0 && epsrel < Max(50.0*epmach, 0.5e-28)) return 6;
+  correc = 0.0;
+  erlarg = 0.0;
+  ertest = 0.0;
+  small = 0.0;
+  ierro = 0;
+  QK21(f, p, a, b, result, abserr, &defabs, &resabs);
+  dres = fabs(*result);
+  errbnd = Max(epsabs, epsrel*dres);
+  last = 1;
+  rlist[1] = *result;
+  elist[1] = *abserr;
+  iord[1] = 1;
+  if (*abserr <= 100.0*epmach*defabs && *abserr > errbnd) ier = 2;
+  if (limit == 1) ier = 1;
+  if (ier != 0 || (*abserr <= errbnd && *abserr != resabs) ||
+      *abserr == 0.0) goto neval;
+  rlist2[1] = *result;
+  errmax = *abserr;
+  maxerr = 1;
+  area = *result;
+  errsum = *abserr;
+  *abserr = oflow;
+  nrmax = 1;
+  nres = 0;
+  numrl2 = 2;
+  ktmin = 0;
+  extrap = 0;
+  noext = 0;
+  iroff1 = 0;
+  iroff2 = 0;
+  iroff3 = 0;
+  ksgn = -1;
+  if (dres >= (1.0-50.0*epmach)*defabs) ksgn = 1;
+  for (last = 2; last <= limit; last++) {
+    a1 = alist[maxerr];
+    b1 = 0.5*(alist[maxerr]+blist[maxerr]);
+    a2 = b1;
+    b2 = blist[maxerr];
+    erlast = errmax;
+    QK21(f, p, a1, b1, &area1, &error1, &resabs, &defab1);
+    QK21(f, p, a2, b2, &area2, &error2, &resabs, &defab2);
+    area12 = area1+area2;
+    erro12 = error1+error2;
+    errsum = errsum+erro12-errmax;
+    area = area+area12-rlist[maxerr];
+    if (defab1 != error1 && defab2 != error2) {
+      if (fabs(rlist[maxerr]-area12) <= 1e-5*fabs(area12) &&
+	  erro12 >= 0.99*errmax) {
+	if (extrap) iroff2++;
+	else iroff1++;
+      }
+      if (last > 10 && erro12 > errmax) iroff3++;
+    }
+    rlist[maxerr] = area1;
+    rlist[last] = area2;
+    errbnd = Max(epsabs, epsrel*fabs(area));
+    if (iroff1+iroff2 >= 10 || iroff3 >= 20) ier = 2;
+    if (iroff2 >= 5) ierro = 3;
+    if (last == limit) ier = 1;
+    if (Max(fabs(a1), fabs(b2)) <= (1.0+100.0*epmach)*(fabs(a2)+1e3*uflow)) {
+      ier = 4;
+    }
+    if (error2 > error1) {
+      alist[maxerr] = a2;
+      alist[last] = a1;
+      blist[last] = b1;
+      rlist[maxerr] = area2;
+      rlist[last] = area1;
+      elist[maxerr] = error2;
+      elist[last] = error1;
+    } else {
+      alist[last] = a2;
+      blist[maxerr] = b1;
+      blist[last] = b2;
+      elist[maxerr] = error1;
+      elist[last] = error2;
+    }
+    QPSRT(limit, last, &maxerr, &errmax, elist, iord, &nrmax);
+    if (errsum <= errbnd) goto sum;
+    if (ier != 0) break;
+    if (last == 2) {
+      small = fabs(b-a)*0.375;
+      erlarg = errsum;
+      ertest = errbnd;
+      rlist2[2] = area;
+      continue;
+    }
+    if (noext) continue;
+    erlarg = erlarg-erlast;
+    if (fabs(b1-a1) > small) erlarg = erlarg+erro12;
+    if (!extrap) {
+      if (fabs(blist[maxerr]-alist[maxerr]) > small) continue;
+      extrap = 1;
+      nrmax = 2;
+    }
+    if (ierro != 3 && erlarg > ertest) {
+      next = 0;
+      jupbnd = last;
+      if (last > (2+limit/2)) jupbnd = limit+3-last;
+      for (k = nrmax; k <= jupbnd; k++) {
+	maxerr = iord[nrmax];
+	errmax = elist[maxerr];
+	if (fabs(blist[maxerr]-alist[maxerr]) > small) {
+	  next = 1;
+	  break;
+	}
+	nrmax++;
+      }
+      if (next) continue;
+    }
+    numrl2++;
+    rlist2[numrl2] = area;
+    QELG(&numrl2, rlist2, &reseps, &abseps, res3la, &nres);
+    ktmin++;
+    if (ktmin > 5 && *abserr < 1e-3*errsum) ier = 5;
+    if (abseps < *abserr) {
+      ktmin = 0;
+      *abserr = abseps;
+      *result = reseps;
+      correc = erlarg;
+      ertest = Max(epsabs, epsrel*fabs(reseps));
+      if (*abserr <= ertest) break;
+    }
+    if (numrl2 == 1) noext = 1;
+    if (ier == 5) break;
+    maxerr = iord[1];
+    errmax = elist[maxerr];
+    nrmax = 1;
+    extrap = 0;
+    small = small*0.5;
+    erlarg = errsum;
+  }
+
+  if (*abserr == oflow) goto sum;
+  if (ier+ierro != 0) {
+    if (ierro == 3) *abserr = *abserr+correc;
+    if (ier == 0) ier = 3;
+    if (*result != 0.0 && area != 0.0) {
+      if (*abserr/fabs(*result) > errsum/fabs(area)) goto sum;
+    } else {
+      if (*abserr > errsum) goto sum;
+      if (area == 0.0) goto err;
+    }
+  }
+  if (ksgn == -1 && Max(fabs(*result), fabs(area)) <= defabs*0.01) {
+    goto err;
+  }
+  if (0.01 > (*result/area) || (*result/area) > 100.0 ||
+      errsum > fabs(area)) ier = 6;
+  goto err;
+
+ sum:
+  *result = 0.0;
+  for (k = 1; k <= last; k++) {
+    *result = *result+rlist[k];
+  }
+  *abserr = errsum;
+ err:
+  if (ier > 2) ier--;
+ neval:
+  *neval = 42*last-21;
+  return ier;
+}
+
 void PrepCEFCrossHeader(CEF_HEADER *h, double *data) {
   double *eusr, *x, bte, bms;
   int m, m1, j;
@@ -922,7 +1453,7 @@ int CEMFCross(char *ifn, char *ofn, int i0, int i1,
   CEMF_HEADER mh;
   CEMF_RECORD mr;
   int i, t, m, ith, iph;
-  double data[2+(1+MAXNE)*3], e, cs, a;
+  double *data, e, cs, a;
   double eth, a1, cs1, k2, rp, e1, e0, b0, b1;
   double bte, bms, be;
   EN_SRECORD *mem_en_table;
@@ -955,6 +1486,7 @@ int CEMFCross(char *ifn, char *ofn, int i0, int i1,
   while (1) {
     n = ReadCEMFHeader(f1, &mh, swp);
     if (n == 0) break;
+    data = (double *) malloc(sizeof(double)*(2+(1+mh.n_egrid)*3));
     CEMF2CEFHeader(&mh, &h);
     for (i = 0; i < mh.ntransitions; i++) {
       n = ReadCEMFRecord(f1, &mr, swp, &mh);
@@ -1030,6 +1562,7 @@ int CEMFCross(char *ifn, char *ofn, int i0, int i1,
 	  free(mr.born);
 	  free(mh.tegrid);
 	  free(mh.egrid);
+	  free(data);
 	  free(mh.thetagrid);
 	  free(mh.phigrid);
 	  goto DONE;
@@ -1041,6 +1574,7 @@ int CEMFCross(char *ifn, char *ofn, int i0, int i1,
     }
     free(mh.tegrid);
     free(mh.egrid);
+    free(data);
     free(mh.thetagrid);
     free(mh.phigrid);
   }
@@ -1067,7 +1601,7 @@ int CEFCross(char *ifn, char *ofn, int i0, int i1,
   CEF_HEADER h;
   CEF_RECORD r;
   int i, t, m;
-  double data[2+(1+MAXNE)*3], e, cs, a;
+  double *data, e, cs, a;
   double eth, a1, cs1, k2, rp, e1, e0, b0, b1;
   double bte, bms, be;
   EN_SRECORD *mem_en_table;
@@ -1107,6 +1641,7 @@ int CEFCross(char *ifn, char *ofn, int i0, int i1,
   while (1) {
     n = ReadCEFHeader(f1, &h, swp);
     if (n == 0) break;
+    data = (double *) malloc(sizeof(double)*(2+(1+h.n_egrid)*3));
     for (i = 0; i < h.ntransitions; i++) {
       n = ReadCEFRecord(f1, &r, swp, &h);
       if ((r.lower == i0 || i0 < 0) && (r.upper == i1 || i1 < 0)) {
@@ -1173,6 +1708,7 @@ int CEFCross(char *ifn, char *ofn, int i0, int i1,
 	  free(r.strength);
 	  free(h.tegrid);
 	  free(h.egrid);
+	  free(data);
 	  goto DONE;
 	}
       }
@@ -1180,6 +1716,7 @@ int CEFCross(char *ifn, char *ofn, int i0, int i1,
     }
     free(h.tegrid);
     free(h.egrid);
+    free(data);
   }
 
  DONE:
@@ -1350,7 +1887,7 @@ int CEMFMaxwell(char *ifn, char *ofn, int i0, int i1,
   CEMF_HEADER mh;
   CEMF_RECORD mr;
   int i, t, m, p, ith, iph;
-  double data[2+(1+MAXNE)*4], e, cs, a, c;
+  double *data, e, cs, a, c;
   double *xg = gauss_xw[0];
   double *wg = gauss_xw[1];
   EN_SRECORD *mem_en_table;
@@ -1383,6 +1920,7 @@ int CEMFMaxwell(char *ifn, char *ofn, int i0, int i1,
   while (1) {
     n = ReadCEMFHeader(f1, &mh, swp);
     if (n == 0) break;
+    data = (double *) malloc(sizeof(double)*(2+(1+mh.n_egrid)*4));
     CEMF2CEFHeader(&mh, &h);
     for (i = 0; i < mh.ntransitions; i++) {
       n = ReadCEMFRecord(f1, &mr, swp, &mh);
@@ -1422,6 +1960,7 @@ int CEMFMaxwell(char *ifn, char *ofn, int i0, int i1,
 	  free(mr.born);
 	  free(mh.tegrid);
 	  free(mh.egrid);
+	  free(data);
 	  free(mh.thetagrid);
 	  free(mh.phigrid);
 	  goto DONE;
@@ -1433,6 +1972,7 @@ int CEMFMaxwell(char *ifn, char *ofn, int i0, int i1,
     }
     free(mh.tegrid);
     free(mh.egrid);
+    free(data);
     free(mh.thetagrid);
     free(mh.phigrid);
   }
@@ -1460,7 +2000,7 @@ int CEFMaxwell(char *ifn, char *ofn, int i0, int i1,
   CEF_HEADER h;
   CEF_RECORD r;
   int i, t, m, p;
-  double data[2+(1+MAXNE)*4], e, cs, a, c;
+  double *data, e, cs, a, c;
   double *xg = gauss_xw[0];
   double *wg = gauss_xw[1];
   EN_SRECORD *mem_en_table;
@@ -1501,6 +2041,7 @@ int CEFMaxwell(char *ifn, char *ofn, int i0, int i1,
   while (1) {
     n = ReadCEFHeader(f1, &h, swp);
     if (n == 0) break;
+    data = (double *) malloc(sizeof(double)*(2+(1+h.n_egrid)*4));
     for (i = 0; i < h.ntransitions; i++) {
       n = ReadCEFRecord(f1, &r, swp, &h);
       if ((r.lower == i0 || i0 < 0) && (r.upper == i1 || i1 < 0)) {
@@ -1530,6 +2071,7 @@ int CEFMaxwell(char *ifn, char *ofn, int i0, int i1,
 	  free(r.strength);
 	  free(h.tegrid);
 	  free(h.egrid);
+	  free(data);
 	  goto DONE;
 	}
       }
@@ -1537,6 +2079,7 @@ int CEFMaxwell(char *ifn, char *ofn, int i0, int i1,
     }
     free(h.tegrid);
     free(h.egrid);
+    free(data);
   }
 
  DONE:
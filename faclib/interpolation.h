@@ -59,7 +59,11 @@ int NLSQFit(int np, double *p, double tol, int *ipvt,
 	    void *extra);
 double Simpson(double *y, int ia, int ib);
 int NewtonCotes(double *r, double *x, int i0, int i1, int m, int id);
+int NewtonCotes0(double *r, double *x, int i0, int i1, int m, int id);
 int NewtonCotesIP(double *r, double *x, int i0, int i1, int m, int id);
+int QuadAGS(double (*f)(double, void *), void *p, double a, double b,
+	    double epsabs, double epsrel, double *result, double *abserr,
+	    int *neval, int limit, int *iwork, double *work);
 double RRCrossHn(double z, double e, int n);
 void PrepCECrossHeader(CE_HEADER *h, double *data);
 void PrepCECrossRecord(int k, CE_RECORD *r, CE_HEADER *h,
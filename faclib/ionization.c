@@ -136,11 +136,19 @@ void FreeIonizationQkData(void *p) {
 }
 
 int SetIEGrid(int n, double emin, double emax) {
+  if (n > MAXNTE) {
+    printf("Max # of grid points reached \n");
+    return -1;
+  }
   n_tegrid = SetTEGrid(tegrid, log_te, n, emin, emax);
   return n_tegrid;
 }
 
 int SetIEGridDetail(int n, double *x) {
+  if (n > MAXNTE) {
+    printf("Max # of grid points reached \n");
+    return -1;
+  }
   n_tegrid = SetTEGridDetail(tegrid, log_te, n, x);
   return n_tegrid;
 }
@@ -254,7 +262,7 @@ int SetCIPWGrid(int ns, int *n, int *step) {
 			     pw_scratch.kl,
 			     pw_scratch.log_kl,
 			     pw_scratch.max_kl,
-			     &ns, n, step);
+			     &ns, n, step, MAXNKL);
   pw_scratch.ns = ns;
   return 0;
 }
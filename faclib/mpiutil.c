@@ -333,6 +333,456 @@ double WallTime() {
 #endif
 }
 
+/*
+** the frames of a compressed file are the bytes of the plain file,
+** shuffled by 4 bytes, which gathers the exponents of the floats and
+** ints of the records, and then coded in the lz4 block format. a
+** frame that does not shrink is stored as is. the file is
+**   magic, version, frame size, number of frames, plain size,
+**   frames of (plain length, coded length, data),
+**   offsets of the frames, offset of that index.
+*/
+static const unsigned char _zmagic[4] = {0x89, 'F', 'Z', 0x1a};
+#define ZVERSION 1
+#define LZ_HLOG 14
+#define LZ_MFLIMIT 12
+#define LZ_LASTLITERALS 5
+
+static void ZShuffle(unsigned char *dst, unsigned char *src, int n) {
+  int i, j, nq;
+
+  nq = n/4;
+  for (j = 0; j < 4; j++) {
+    for (i = 0; i < nq; i++) {
+      dst[j*nq+i] = src[4*i+j];
+    }
+  }
+  for (i = 4*nq; i < n; i++) dst[i] = src[i];
+}
+
+static void ZUnshuffle(unsigned char *dst, unsigned char *src, int n) {
+  int i, j, nq;
+
+  nq = n/4;
+  for (j = 0; j < 4; j++) {
+    for (i = 0; i < nq; i++) {
+      dst[4*i+j] = src[j*nq+i];
+    }
+  }
+  for (i = 4*nq; i < n; i++) dst[i] = src[i];
+}
+
+static int ZPutLength(unsigned char *dst, int op, int n) {
+  while (n >= 255) {
+    dst[op++] = 255;
+    n -= 255;
+  }
+  dst[op++] = n;
+  return op;
+}
+
+/*
+** lz4 block coding of src[n] into dst[m]. returns the coded length,
+** or 0 if it does not fit.
+*/
+static int LZCompress(unsigned char *src, int n,
+		      unsigned char *dst, int m) {
+  int ht[1<<LZ_HLOG];
+  int i, ip, op, ref, anchor, lit, ml, tk;
+  unsigned int seq, h;
+
+  ip = 0;
+  op = 0;
+  anchor = 0;
+  if (n > LZ_MFLIMIT) {
+    for (i = 0; i < (1<<LZ_HLOG); i++) ht[i] = -1;
+    while (ip < n - LZ_MFLIMIT) {
+      memcpy(&seq, src+ip, 4);
+      h = (seq*2654435761U) >> (32-LZ_HLOG);
+      ref = ht[h];
+      ht[h] = ip;
+      if (ref < 0 || ip-ref > 65535 || memcmp(src+ref, src+ip, 4)) {
+	ip++;
+	continue;
+      }
+      ml = 4;
+      while (ip+ml < n-LZ_LASTLITERALS && src[ref+ml] == src[ip+ml]) ml++;
+      lit = ip - anchor;
+      if (op + 1 + lit/255 + 1 + lit + 2 + (ml-4)/255 + 1 > m) return 0;
+      tk = op++;
+      dst[tk] = (lit < 15?lit:15) << 4;
+      if (lit >= 15) op = ZPutLength(dst, op, lit-15);
+      memcpy(dst+op, src+anchor, lit);
+      op += lit;
+      dst[op++] = (ip-ref) & 0xFF;
+      dst[op++] = (ip-ref) >> 8;
+      if (ml-4 >= 15) {
+	dst[tk] |= 15;
+	op = ZPutLength(dst, op, ml-4-15);
+      } else {
+	dst[tk] |= ml-4;
+      }
+      ip += ml;
+      anchor = ip;
+    }
+  }
+  lit = n - anchor;
+  if (op + 1 + lit/255 + 1 + lit > m) return 0;
+  tk = op++;
+  dst[tk] = (lit < 15?lit:15) << 4;
+  if (lit >= 15) op = ZPutLength(dst, op, lit-15);
+  memcpy(dst+op, src+anchor, lit);
+  op += lit;
+  return op;
+}
+
+/*
+** decode the lz4 block src[n] into dst[m]. returns the decoded
+** length, or -1 for corrupt data.
+*/
+static int LZDecompress(unsigned char *src, int n,
+			unsigned char *dst, int m) {
+  int ip, op, lit, ml, off, t, i;
+
+  ip = 0;
+  op = 0;
+  while (ip < n) {
+    t = src[ip++];
+    lit = t >> 4;
+    if (lit == 15) {
+      do {
+	if (ip >= n) return -1;
+	i = src[ip++];
+	lit += i;
+      } while (i == 255);
+    }
+    if (ip+lit > n || op+lit > m) return -1;
+    memcpy(dst+op, src+ip, lit);
+    ip += lit;
+    op += lit;
+    if (ip == n) break;
+    if (ip+2 > n) return -1;
+    off = src[ip] | (src[ip+1] << 8);
+    ip += 2;
+    if (off == 0 || off > op) return -1;
+    ml = t & 15;
+    if (ml == 15) {
+      do {
+	if (ip >= n) return -1;
+	i = src[ip++];
+	ml += i;
+      } while (i == 255);
+    }
+    ml += 4;
+    if (op+ml > m) return -1;
+    for (i = 0; i < ml; i++, op++) {
+      dst[op] = dst[op-off];
+    }
+  }
+  return op;
+}
+
+static void ZSwap(void *p, int n) {
+  unsigned char *c, t;
+  int i;
+
+  c = (unsigned char *) p;
+  for (i = 0; i < n/2; i++) {
+    t = c[i];
+    c[i] = c[n-1-i];
+    c[n-1-i] = t;
+  }
+}
+
+/*
+** check for a compressed file opened for reading, and read its index.
+*/
+static void BZOpen(BFILE *bf) {
+  unsigned char mg[4];
+  int v, i;
+  long long p;
+  BZFILE *z;
+
+  bf->z = NULL;
+  if (fread(mg, 1, 4, bf->f) != 4 || memcmp(mg, _zmagic, 4)) {
+    rewind(bf->f);
+    return;
+  }
+  z = malloc(sizeof(BZFILE));
+  z->swp = 0;
+  if (fread(&v, sizeof(int), 1, bf->f) != 1) goto ERROR;
+  if (v != ZVERSION) {
+    ZSwap(&v, sizeof(int));
+    if (v != ZVERSION) goto ERROR;
+    z->swp = 1;
+  }
+  if (fread(&z->fs, sizeof(int), 1, bf->f) != 1) goto ERROR;
+  if (fread(&z->nf, sizeof(int), 1, bf->f) != 1) goto ERROR;
+  if (fread(&z->size, sizeof(long long), 1, bf->f) != 1) goto ERROR;
+  if (fseek(bf->f, -((long) sizeof(long long)), SEEK_END)) goto ERROR;
+  if (fread(&p, sizeof(long long), 1, bf->f) != 1) goto ERROR;
+  if (z->swp) {
+    ZSwap(&z->fs, sizeof(int));
+    ZSwap(&z->nf, sizeof(int));
+    ZSwap(&z->size, sizeof(long long));
+    ZSwap(&p, sizeof(long long));
+  }
+  if (fseek(bf->f, p, SEEK_SET)) goto ERROR;
+  z->pos = malloc(sizeof(long long)*(z->nf+1));
+  if (fread(z->pos, sizeof(long long), z->nf, bf->f) != z->nf) {
+    free(z->pos);
+    goto ERROR;
+  }
+  if (z->swp) {
+    for (i = 0; i < z->nf; i++) ZSwap(&z->pos[i], sizeof(long long));
+  }
+  z->u = malloc(z->fs);
+  z->t = malloc(z->fs);
+  z->c = malloc(z->fs);
+  z->iframe = -1;
+  z->ulen = 0;
+  z->p = 0;
+  bf->z = z;
+  return;
+
+ ERROR:
+  printf("corrupt compressed file: %s\n", bf->fn?bf->fn:"");
+  free(z);
+  rewind(bf->f);
+}
+
+static void BZClose(BFILE *bf) {
+  if (bf->z == NULL) return;
+  free(bf->z->pos);
+  free(bf->z->u);
+  free(bf->z->t);
+  free(bf->z->c);
+  free(bf->z);
+  bf->z = NULL;
+}
+
+/*
+** decode frame i into z->u. returns 0, or -1 on error.
+*/
+static int BZLoad(BFILE *bf, int i) {
+  BZFILE *z;
+  int n[2];
+
+  z = bf->z;
+  if (i == z->iframe) return 0;
+  if (i < 0 || i >= z->nf) return -1;
+  if (fseek(bf->f, z->pos[i], SEEK_SET)) return -1;
+  if (fread(n, sizeof(int), 2, bf->f) != 2) return -1;
+  if (z->swp) {
+    ZSwap(&n[0], sizeof(int));
+    ZSwap(&n[1], sizeof(int));
+  }
+  if (n[0] > z->fs || n[1] > z->fs) return -1;
+  if (n[1] == n[0]) {
+    if (fread(z->u, 1, n[0], bf->f) != n[0]) return -1;
+  } else {
+    if (fread(z->c, 1, n[1], bf->f) != n[1]) return -1;
+    if (LZDecompress(z->c, n[1], z->t, z->fs) != n[0]) {
+      printf("corrupt frame %d in %s\n", i, bf->fn?bf->fn:"");
+      return -1;
+    }
+    ZUnshuffle(z->u, z->t, n[0]);
+  }
+  z->iframe = i;
+  z->ulen = n[0];
+  return 0;
+}
+
+static size_t BZRead(void *ptr, size_t n, BFILE *bf) {
+  BZFILE *z;
+  size_t m, k;
+  int i, q;
+
+  z = bf->z;
+  m = 0;
+  while (m < n && z->p < z->size) {
+    i = z->p/z->fs;
+    if (BZLoad(bf, i)) break;
+    q = z->p - ((long long) i)*z->fs;
+    k = z->ulen - q;
+    if (k > n-m) k = n-m;
+    memcpy(((char *) ptr)+m, z->u+q, k);
+    m += k;
+    z->p += k;
+  }
+  return m;
+}
+
+static char *BZGetLine(char *s, int size, BFILE *bf) {
+  int i;
+
+  for (i = 0; i < size-1; i++) {
+    if (BZRead(s+i, 1, bf) != 1) break;
+    if (s[i] == '\n') {
+      i++;
+      break;
+    }
+  }
+  if (i == 0) return NULL;
+  s[i] = '\0';
+  return s;
+}
+
+static FILE *BFileOpenRaw(BFILE *bf, char *fn, char *md) {
+  if (strchr(md, '+') || md[0] == 'a') BFileDecompress(fn);
+  bf->f = fopen(fn, md);
+  if (bf->f != NULL && md[0] == 'r' && strchr(md, '+') == NULL) {
+    BZOpen(bf);
+  }
+  return bf->f;
+}
+
+/*
+** compress the file fn in frames of fs bytes, the frames of a group
+** are coded in parallel and written in order. an already compressed
+** file is left as is.
+*/
+int BFileCompress(char *fn, int fs) {
+  FILE *f, *g;
+  unsigned char mg[4], *in, *out;
+  char *tfn;
+  int i, k, v, nf, ng, nr, cs, *ulen, *clen;
+  long long size, p, *pos;
+  size_t mpos;
+
+  f = fopen(fn, "rb");
+  if (f == NULL) return -1;
+  if (fread(mg, 1, 4, f) == 4 && memcmp(mg, _zmagic, 4) == 0) {
+    fclose(f);
+    return 0;
+  }
+  rewind(f);
+  tfn = malloc(strlen(fn)+3);
+  sprintf(tfn, "%s.z", fn);
+  g = fopen(tfn, "wb");
+  if (g == NULL) {
+    fclose(f);
+    free(tfn);
+    return -1;
+  }
+  nr = 1;
+#if USE_MPI == 2
+  MPIRank(&nr);
+#endif
+  ng = 4*nr;
+  cs = fs + fs/255 + 16;
+  in = malloc(((size_t) fs)*ng);
+  out = malloc(((size_t) cs)*ng);
+  ulen = malloc(sizeof(int)*ng*2);
+  clen = ulen + ng;
+  mpos = 1024;
+  pos = malloc(sizeof(long long)*mpos);
+  fwrite(_zmagic, 1, 4, g);
+  v = ZVERSION;
+  nf = 0;
+  size = 0;
+  fwrite(&v, sizeof(int), 1, g);
+  fwrite(&fs, sizeof(int), 1, g);
+  fwrite(&nf, sizeof(int), 1, g);
+  fwrite(&size, sizeof(long long), 1, g);
+  p = 4 + 3*sizeof(int) + sizeof(long long);
+  while (1) {
+    for (k = 0; k < ng; k++) {
+      ulen[k] = fread(in+((size_t) fs)*k, 1, fs, f);
+      if (ulen[k] < fs) {
+	if (ulen[k] > 0) k++;
+	break;
+      }
+    }
+    if (k == 0) break;
+#pragma omp parallel for schedule(dynamic) private(i)
+    for (i = 0; i < k; i++) {
+      unsigned char *t = malloc(ulen[i]);
+      ZShuffle(t, in+((size_t) fs)*i, ulen[i]);
+      clen[i] = LZCompress(t, ulen[i], out+((size_t) cs)*i, ulen[i]-1);
+      free(t);
+    }
+    for (i = 0; i < k; i++) {
+      if (nf == mpos) {
+	mpos *= 2;
+	pos = realloc(pos, sizeof(long long)*mpos);
+      }
+      pos[nf++] = p;
+      size += ulen[i];
+      if (clen[i] <= 0) clen[i] = ulen[i];
+      fwrite(&ulen[i], sizeof(int), 1, g);
+      fwrite(&clen[i], sizeof(int), 1, g);
+      if (clen[i] == ulen[i]) {
+	fwrite(in+((size_t) fs)*i, 1, ulen[i], g);
+      } else {
+	fwrite(out+((size_t) cs)*i, 1, clen[i], g);
+      }
+      p += 2*sizeof(int) + clen[i];
+    }
+    if (ulen[k-1] < fs) break;
+  }
+  fwrite(pos, sizeof(long long), nf, g);
+  fwrite(&p, sizeof(long long), 1, g);
+  fseek(g, 4 + 2*sizeof(int), SEEK_SET);
+  fwrite(&nf, sizeof(int), 1, g);
+  fwrite(&size, sizeof(long long), 1, g);
+  fclose(f);
+  i = fclose(g);
+  if (i == 0) i = rename(tfn, fn);
+  if (i != 0) {
+    printf("cannot compress file %s\n", fn);
+    remove(tfn);
+  }
+  free(tfn);
+  free(in);
+  free(out);
+  free(ulen);
+  free(pos);
+  return i;
+}
+
+/*
+** restore the plain file from a compressed fn, before it is opened for
+** update.
+*/
+int BFileDecompress(char *fn) {
+  BFILE *bf;
+  FILE *g;
+  char *tfn, *b;
+  size_t n;
+  int r;
+
+  bf = BFileOpen(fn, "rb", 0);
+  if (bf == NULL) return -1;
+  if (bf->z == NULL) {
+    BFileClose(bf);
+    return 0;
+  }
+  tfn = malloc(strlen(fn)+3);
+  sprintf(tfn, "%s.u", fn);
+  g = fopen(tfn, "wb");
+  if (g == NULL) {
+    BFileClose(bf);
+    free(tfn);
+    return -1;
+  }
+  b = malloc(bf->z->fs);
+  while ((n = BZRead(b, bf->z->fs, bf)) > 0) {
+    fwrite(b, 1, n, g);
+  }
+  r = (bf->z->p == bf->z->size)?0:-1;
+  free(b);
+  BFileClose(bf);
+  if (fclose(g)) r = -1;
+  if (r == 0) r = rename(tfn, fn);
+  if (r != 0) {
+    printf("cannot decompress file %s\n", fn);
+    remove(tfn);
+  }
+  free(tfn);
+  return r;
+}
+
 BFILE *BFileOpen(char *fn, char *md, int nb) {  
   BFILE *bf;  
   bf = malloc(sizeof(BFILE));  
@@ -341,23 +791,22 @@ BFILE *BFileOpen(char *fn, char *md, int nb) {
   bf->n = 0;
   bf->eof = 0;
   bf->nbuf = nb>=0?nb:RBUFL;
+  bf->fn = NULL;
+  bf->z = NULL;
   if (bf->nbuf == 0) {
     bf->nr = 1;
     bf->mr = 0;
     bf->buf = NULL;
-    bf->f = fopen(fn, md);
-    if (bf->f == NULL) {
+    if (BFileOpenRaw(bf, fn, md) == NULL) {
       free(bf);
       return NULL;
     }
-    bf->fn = NULL;
     return bf;
   }
 #if USE_MPI == 1
   bf->mr = MPIRank(&bf->nr);
   if (bf->mr == 0) {
-    bf->f = fopen(fn, md);
-    if (bf->f == NULL) bf->p = -1;
+    if (BFileOpenRaw(bf, fn, md) == NULL) bf->p = -1;
   } else {
     bf->f = NULL;
   }
@@ -375,8 +824,7 @@ BFILE *BFileOpen(char *fn, char *md, int nb) {
   }
 #elif USE_MPI == 2
   bf->mr = MPIRank(&bf->nr);
-  bf->f = fopen(fn, md);
-  if (bf->f == NULL) {
+  if (BFileOpenRaw(bf, fn, md) == NULL) {
     free(bf);
     //printf("cannot open file: %s\n", fn);
     return NULL;
@@ -400,8 +848,8 @@ BFILE *BFileOpen(char *fn, char *md, int nb) {
   } else {
     bf->buf = NULL;
   }
-  bf->f = fopen(fn, md);
-  if (bf->f == NULL) {
+  if (BFileOpenRaw(bf, fn, md) == NULL) {
+    free(bf->buf);
     free(bf);
     return NULL;
   }
@@ -446,6 +894,7 @@ int BFileClose(BFILE *bf) {
   r = fclose(bf->f);
 #endif
   
+  BZClose(bf);
   free(bf->fn);
   free(bf);
 
@@ -455,6 +904,7 @@ int BFileClose(BFILE *bf) {
 size_t BFileRead(void *ptr, size_t size, size_t nmemb, BFILE *bf) {
 #if USE_MPI == 1
   if (bf->nr <= 1) {
+    if (bf->z) return BZRead(ptr, size*nmemb, bf)/size;
     return fread(ptr, size, nmemb, bf->f);
   }
   if (size > bf->nbuf) {
@@ -491,7 +941,8 @@ size_t BFileRead(void *ptr, size_t size, size_t nmemb, BFILE *bf) {
     bf->n = nb;
     if (bf->mr == 0) {
       nn = bf->nbuf - bf->n;
-      nr = fread(bf->buf+bf->n, 1, nn, bf->f);
+      if (bf->z) nr = BZRead(bf->buf+bf->n, nn, bf);
+      else nr = fread(bf->buf+bf->n, 1, nn, bf->f);
       if (nr < nn) {
 	bf->eof = 1;
       }
@@ -507,6 +958,7 @@ size_t BFileRead(void *ptr, size_t size, size_t nmemb, BFILE *bf) {
   }
   return nread;
 #else
+  if (bf->z) return BZRead(ptr, size*nmemb, bf)/size;
   return fread(ptr, size, nmemb, bf->f);
 #endif
 }
@@ -514,6 +966,7 @@ size_t BFileRead(void *ptr, size_t size, size_t nmemb, BFILE *bf) {
 char *BFileGetLine(char *s, int size1, BFILE *bf) {
 #if USE_MPI == 1
   if (bf->nr <= 1) {
+    if (bf->z) return BZGetLine(s, size1, bf);
     return fgets(s, size1, bf->f);
   }
   int n;
@@ -542,11 +995,13 @@ char *BFileGetLine(char *s, int size1, BFILE *bf) {
   s[i] = '\0';
   return s;
 #else
+  if (bf->z) return BZGetLine(s, size1, bf);
   return fgets(s, size1, bf->f);
 #endif
 }
 
 void BFileRewind(BFILE *bf) {
+  if (bf->z) bf->z->p = 0;
 #if USE_MPI == 1
   if (bf->nr <= 1) {
     rewind(bf->f);
@@ -633,11 +1088,19 @@ int BFileCheckBuf(BFILE *bf, int m) {
 
 int BFileSeek(BFILE *bf, long offset, int w) {
   BFileFlush(bf);
+  if (bf->z) {
+    if (w == SEEK_CUR) offset += bf->z->p;
+    else if (w == SEEK_END) offset += bf->z->size;
+    if (offset < 0) return -1;
+    bf->z->p = offset;
+    return 0;
+  }
   return fseek(bf->f, offset, w);
 }
 
 long BFileTell(BFILE *bf) {
   BFileFlush(bf);
+  if (bf->z) return bf->z->p;
   return ftell(bf->f);
 }
 
@@ -33,6 +33,11 @@
 
 #define BUFLN 1024
 
+/* uncompressed size of the frames of a compressed file */
+#ifndef ZFRAME
+#define ZFRAME 1048576
+#endif
+
 typedef struct _RANDIDX_ {
   int i;
   double r;
@@ -49,6 +54,19 @@ typedef struct _MPID_ {
   long long wid;
 } MPID;
 
+/*
+** a file compressed in frames by BFileCompress, read through BFILE.
+** the frames are decoded one at a time, p is the position in the
+** uncompressed data.
+*/
+typedef struct _BZFILE_ {
+  int fs, nf, swp;
+  int iframe, ulen;
+  long long size, p;
+  long long *pos;
+  unsigned char *u, *t, *c;
+} BZFILE;
+
 typedef struct _BFILE_ {
   char *fn;
   FILE *f;
@@ -56,6 +74,7 @@ typedef struct _BFILE_ {
   int *w, p, n, nbuf;
   int nr, mr, eof;
   LOCK lock;
+  BZFILE *z;
 } BFILE;
 
 int SkipWMPI(int w);
@@ -90,6 +109,8 @@ int BFileSeek(BFILE *bf, long offset, int whence);
 long BFileTell(BFILE *bf);
 int BFileFlush(BFILE *bf);
 int BFileCheckBuf(BFILE *bf, int m);
+int BFileCompress(char *fn, int fs);
+int BFileDecompress(char *fn);
 void InitializeMPI(int n, int m);
 void FinalizeMPI(void);
 RANDIDX *RandList(int n);
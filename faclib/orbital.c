@@ -466,6 +466,7 @@ void InitOrbitalData(void *p, int n) {
     d[i].horb = NULL;
     d[i].rorb = NULL;
     d[i].isol = 0;
+    d[i].iwf = -1;
   }
 }
 
@@ -69,12 +69,27 @@ typedef struct _ORBITAL_ {
   double *phase;
   double *wfun;
   double bqp0, bqp1, pdx;
-  int ilast, idx, isol;
+  int ilast, idx, isol, iwf;
   double rfn, dn;
   struct _ORBITAL_ *horb;
   struct _ORBITAL_ *rorb;
 } ORBITAL;
 
+/* the wavefunctions of the bound orbitals are kept in blocks of
+   bsize doubles, 64-byte aligned, allocated in chunks that never move.
+   iwf of an orbital is its block index, -1 if not in the arena. */
+#define ORB_ARENA_ALIGN   64
+#define ORB_ARENA_CHUNK   64
+#define ORB_ARENA_NCHUNKS 4096
+typedef struct _ORBITAL_ARENA_ {
+  int bsize;
+  int nblocks, nfree, mfree;
+  int *free;
+  double *chunk[ORB_ARENA_NCHUNKS];
+  void *base[ORB_ARENA_NCHUNKS];
+  LOCK *lock;
+} ORBITAL_ARENA;
+
 void InitOrbitalData(void *p, int n);
 double *GetVEffective(void);
 double RadialDiracCoulomb(int npts, double *p, double *q, double *r,
@@ -21,6 +21,10 @@
 #include "cf77.h"
 #include "structure.h"
 #include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 static char *rcsid="$Id$";
 #if __GNUC__ == 2
@@ -30,9 +34,14 @@ USE (rcsid);
 
 typedef struct _FLTARY_ {
   short npts;
+  short nq;
+  int nb;
   float *yk;
 } FLTARY;
 
+/* number of points in a block of the compressed Yk */
+#define YKQBLOCK 32
+
 #define NHXN 30
 #define NXS 15
 #define NXS2 (2*NXS+1)
@@ -83,6 +92,7 @@ static POTENTIAL *rpotential = NULL;
 #define Small(orb) ((orb)->wfun + potential->maxrp)
 
 static ARRAY *orbitals;
+static ORBITAL_ARENA _orb_arena;
 static int n_orbitals;
 static int n_continua;
 static int _orbitals_block = ORBITALS_BLOCK;
@@ -175,7 +185,45 @@ static ORBMAP *_orbmap = NULL;
 
 static AVERAGE_CONFIG average_config = {0, 0, NULL, NULL, NULL, 0, NULL, NULL};
 
+/* slater_array, yk_array and residual_array are keyed by the orbital
+   indexes and the rank packed into one 64-bit word. slater keys with
+   an orbital index beyond SKEY_OBITS go to the 5-d slater_array5. */
+#if USE_NMULTI != 1 && USE_NMULTI != 3
+#error "packed radial cache keys need a hashed MULTI implementation"
+#endif
+#define SKEY_OBITS 14
+#define SKEY_KBITS 8
+#define YKEY_OBITS 28
+
+static inline unsigned long long ResidualKey(int k0, int k1) {
+  return (((unsigned long long) (unsigned int) k0) << 32) |
+    (unsigned long long) (unsigned int) k1;
+}
+
+/* pack the sorted slater index, returns -1 if it does not fit. */
+static inline int SlaterKey(int *index, unsigned long long *key) {
+  int i;
+
+  if (index[4] < 0 || index[4] >= (1<<SKEY_KBITS)) return -1;
+  *key = index[4];
+  for (i = 0; i < 4; i++) {
+    if (index[i] < 0 || index[i] >= (1<<SKEY_OBITS)) return -1;
+    *key = (*key << SKEY_OBITS) | index[i];
+  }
+  return 0;
+}
+
+static inline int YkKey(int k1, int k2, int k, unsigned long long *key) {
+  if (k1 < 0 || k1 >= (1<<YKEY_OBITS) ||
+      k2 < 0 || k2 >= (1<<YKEY_OBITS) ||
+      k < 0 || k >= (1<<(64-2*YKEY_OBITS))) return -1;
+  *key = (((unsigned long long) k) << (2*YKEY_OBITS)) |
+    (((unsigned long long) k1) << YKEY_OBITS) | k2;
+  return 0;
+}
+
 static MULTI *slater_array;
+static MULTI *slater_array5;
 static MULTI *xbreit_array[5];
 static MULTI *wbreit_array;
 static MULTI *breit_array;
@@ -186,6 +234,7 @@ static MULTI *multipole_array;
 static MULTI *moments_array;
 static MULTI *gos_array;
 static MULTI *yk_array;
+static double _yk_qtol = 0.0;
 
 #define MAXNAW 128
 static int n_awgrid = 0;
@@ -201,16 +250,335 @@ static double _sturm_eref = 0;
 static int _sturm_nref = 0;
 static int _sturm_kref = -1;
 
+#define MAXRPOW 64
+#define MAXRPOWLN 600.0
+static int _rpow_n = 0;
+static double _rpow_maxlnr = 0.0;
+static double *_rpow_lnr = NULL;
+static double *_rpow[MAXRPOW];
+
 static double PhaseRDependent(double x, double eta, double b);
+static void FreeOrbitalWfun(ORBITAL *orb);
+void FreeOrbitalData(void *p);
 
 #ifdef PERFORM_STATISTICS
-static RAD_TIMING rad_timing = {0, 0, 0, 0};
+static RAD_TIMING rad_timing = {0, 0, 0, 0, 0, 0, 0};
 int GetRadTiming(RAD_TIMING *t) {
   memcpy(t, &rad_timing, sizeof(RAD_TIMING));
   return 0;
 }
 #endif
 
+/*
+** persistent database of the radial integrals between bound orbitals.
+** a database file holds the integrals of one potential, and is named
+** after the hash of the potential and the qed settings, so that a
+** changed potential never picks up stale values. the records are
+** kept sorted and the file is memory-mapped on the first lookup.
+** integrals computed in the run are collected and merged into the
+** file by FlushRadialDB, called in ReinitRadial and at exit.
+*/
+#define RDB_MAGIC "FACRDB1"
+#define RDB_VERSION 1
+#define RDB_SLATER 1
+#define RDB_BREIT 2
+#define RDB_MULTIPOLE 3
+#define RDB_QED1E 4
+
+typedef struct _RDBREC_ {
+  int type, k, m, g;
+  double x;
+  short n[4], kappa[4];
+  double r;
+} RDBREC;
+
+typedef struct _RDBHDR_ {
+  char magic[8];
+  int version, size;
+  unsigned long long hash;
+  long nrec;
+} RDBHDR;
+
+/* the part of RDBREC compared in the lookup */
+#define RDB_KEYSIZE (sizeof(RDBREC)-sizeof(double))
+
+static struct {
+  char prefix[1024];
+  char fn[1100];
+  int loaded;
+  unsigned long long hash;
+  void *map;
+  size_t msize;
+  RDBREC *rec;
+  long nrec;
+  ARRAY *pend;
+  long nhit, nmiss;
+} _rdb = {"", "", 0, 0, NULL, 0, NULL, 0, NULL, 0, 0};
+
+unsigned long long HashBytes(unsigned long long h,
+			     const void *p, size_t n) {
+  const unsigned char *c = (const unsigned char *) p;
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    h ^= c[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+unsigned long long PotentialHash(void) {
+  unsigned long long h;
+  int n;
+
+  h = 0xcbf29ce484222325ULL;
+  n = potential->maxrp;
+  h = HashBytes(h, &n, sizeof(int));
+  h = HashBytes(h, potential->rad, sizeof(double)*n);
+  h = HashBytes(h, potential->Z, sizeof(double)*n);
+  h = HashBytes(h, potential->Vc, sizeof(double)*n);
+  h = HashBytes(h, potential->U, sizeof(double)*n);
+  h = HashBytes(h, potential->ZVP, sizeof(double)*n);
+  h = HashBytes(h, &potential->N, sizeof(double));
+  h = HashBytes(h, &potential->lambda, sizeof(double));
+  h = HashBytes(h, &potential->a, sizeof(double));
+  h = HashBytes(h, &potential->ib, sizeof(int));
+  h = HashBytes(h, &potential->nb, sizeof(int));
+  h = HashBytes(h, &potential->ib1, sizeof(int));
+  h = HashBytes(h, &potential->bqp, sizeof(double));
+  h = HashBytes(h, &potential->rb, sizeof(double));
+  h = HashBytes(h, &potential->sturm_idx, sizeof(double));
+  h = HashBytes(h, &potential->mse, sizeof(int));
+  h = HashBytes(h, &potential->pse, sizeof(int));
+  h = HashBytes(h, &potential->mvp, sizeof(int));
+  h = HashBytes(h, &potential->pvp, sizeof(int));
+  h = HashBytes(h, &qed, sizeof(qed));
+  return h;
+}
+
+static int RDBCmp(const void *p1, const void *p2) {
+  return memcmp(p1, p2, RDB_KEYSIZE);
+}
+
+static void UnloadRadialDB(void) {
+  if (_rdb.map != NULL) {
+    munmap(_rdb.map, _rdb.msize);
+    _rdb.map = NULL;
+  }
+  _rdb.msize = 0;
+  _rdb.rec = NULL;
+  _rdb.nrec = 0;
+  _rdb.loaded = 0;
+}
+
+/* map the database of the current potential, if it exists */
+static void LoadRadialDB(void) {
+  int fd;
+  struct stat st;
+  RDBHDR *hdr;
+
+  UnloadRadialDB();
+  _rdb.hash = PotentialHash();
+  sprintf(_rdb.fn, "%s.%016llx", _rdb.prefix, _rdb.hash);
+  _rdb.loaded = 1;
+  fd = open(_rdb.fn, O_RDONLY);
+  if (fd < 0) return;
+  if (fstat(fd, &st) == 0 && st.st_size >= sizeof(RDBHDR)) {
+    _rdb.map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (_rdb.map == MAP_FAILED) {
+      _rdb.map = NULL;
+    } else {
+      _rdb.msize = st.st_size;
+    }
+  }
+  close(fd);
+  if (_rdb.map == NULL) return;
+  hdr = (RDBHDR *) _rdb.map;
+  if (strncmp(hdr->magic, RDB_MAGIC, 8) != 0 ||
+      hdr->version != RDB_VERSION ||
+      hdr->size != sizeof(RDBREC) ||
+      hdr->hash != _rdb.hash ||
+      _rdb.msize < sizeof(RDBHDR) + hdr->nrec*sizeof(RDBREC)) {
+    MPrintf(-1, "stale radial db rejected: %s\n", _rdb.fn);
+    UnloadRadialDB();
+    _rdb.loaded = 1;
+    return;
+  }
+  _rdb.rec = (RDBREC *) (((char *) _rdb.map) + sizeof(RDBHDR));
+  _rdb.nrec = hdr->nrec;
+}
+
+/*
+** fill the key of a record, orbitals are identified by n and kappa.
+** returns -1 if the database is off, or any orbital is not bound.
+*/
+static int RadialDBKey(RDBREC *r, int type, int k, int m, int g,
+		       double x, int n, int *ko) {
+  int i, kd[5];
+  ORBITAL *orb;
+
+  if (_rdb.prefix[0] == '\0') return -1;
+  memset(r, 0, sizeof(RDBREC));
+  r->type = type;
+  r->k = k;
+  r->m = m;
+  r->g = g;
+  r->x = x;
+  for (i = 0; i < n; i++) {
+    orb = GetOrbital(ko[i]);
+    if (orb->n <= 0) return -1;
+    kd[i] = (orb->n << 8) + orb->kappa + 128;
+  }
+  if (type == RDB_SLATER) {
+    kd[4] = k;
+    SortSlaterKey(kd);
+  }
+  for (i = 0; i < n; i++) {
+    r->n[i] = kd[i] >> 8;
+    r->kappa[i] = (kd[i] & 0xFF) - 128;
+  }
+  return 0;
+}
+
+/* look up the integral of the record key r in the database */
+static int RadialDBGet(RDBREC *r) {
+  RDBREC *p;
+
+  if (!_rdb.loaded) {
+#pragma omp critical(radial_db)
+    {
+      if (!_rdb.loaded) LoadRadialDB();
+    }
+  }
+  p = NULL;
+  if (_rdb.nrec > 0) {
+    p = bsearch(r, _rdb.rec, _rdb.nrec, sizeof(RDBREC), RDBCmp);
+  }
+  if (p == NULL) {
+#pragma omp atomic
+    _rdb.nmiss++;
+    return -1;
+  }
+#pragma omp atomic
+  _rdb.nhit++;
+  r->r = p->r;
+  return 0;
+}
+
+/* record a newly computed integral, to be saved by FlushRadialDB */
+static void RadialDBAdd(RDBREC *r, double v) {
+#if USE_MPI == 1
+  /* all ranks read the database, only rank 0 writes it */
+  if (MyRankMPI() != 0) return;
+#endif
+  r->r = v;
+#pragma omp critical(radial_db)
+  {
+    if (_rdb.pend == NULL) {
+      _rdb.pend = malloc(sizeof(ARRAY));
+      ArrayInit(_rdb.pend, sizeof(RDBREC), 4096);
+    }
+    ArrayAppend(_rdb.pend, r, NULL);
+  }
+}
+
+/* merge the new integrals into the database file */
+int FlushRadialDB(void) {
+  RDBHDR hdr;
+  RDBREC *a, *p;
+  long i, n, m;
+  char tfn[1200];
+  FILE *f;
+  int r = 0;
+
+#pragma omp critical(radial_db)
+  {
+    if (_rdb.pend != NULL && _rdb.pend->dim > 0 && _rdb.loaded) {
+      n = _rdb.pend->dim;
+      a = malloc(sizeof(RDBREC)*(n + _rdb.nrec));
+      for (i = 0; i < n; i++) {
+	p = (RDBREC *) ArrayGet(_rdb.pend, i);
+	memcpy(a+i, p, sizeof(RDBREC));
+      }
+      if (_rdb.nrec > 0) {
+	memcpy(a+n, _rdb.rec, sizeof(RDBREC)*_rdb.nrec);
+      }
+      n += _rdb.nrec;
+      qsort(a, n, sizeof(RDBREC), RDBCmp);
+      m = 0;
+      for (i = 0; i < n; i++) {
+	if (m > 0 && RDBCmp(a+m-1, a+i) == 0) continue;
+	if (m < i) memcpy(a+m, a+i, sizeof(RDBREC));
+	m++;
+      }
+      memset(&hdr, 0, sizeof(hdr));
+      strncpy(hdr.magic, RDB_MAGIC, 8);
+      hdr.version = RDB_VERSION;
+      hdr.size = sizeof(RDBREC);
+      hdr.hash = _rdb.hash;
+      hdr.nrec = m;
+      sprintf(tfn, "%s.%d", _rdb.fn, (int) getpid());
+      f = fopen(tfn, "w");
+      if (f == NULL) {
+	printf("cannot open radial db: %s\n", tfn);
+	r = -1;
+      } else {
+	fwrite(&hdr, sizeof(RDBHDR), 1, f);
+	fwrite(a, sizeof(RDBREC), m, f);
+	fclose(f);
+	UnloadRadialDB();
+	if (rename(tfn, _rdb.fn) != 0) {
+	  printf("cannot rename radial db: %s\n", _rdb.fn);
+	  r = -1;
+	}
+      }
+      free(a);
+      ArrayFree(_rdb.pend, NULL);
+    }
+  }
+  return r;
+}
+
+static void FlushRadialDBAtExit(void) {
+  FlushRadialDB();
+}
+
+/*
+** use the radial integral database with the file name prefix fn,
+** an empty name turns it off.
+*/
+int SetRadialDB(char *fn) {
+  static int atx = 0;
+
+  FlushRadialDB();
+  UnloadRadialDB();
+  if (fn == NULL) fn = "";
+  strncpy(_rdb.prefix, fn, 1023);
+  _rdb.nhit = 0;
+  _rdb.nmiss = 0;
+  if (_rdb.prefix[0] && !atx) {
+    atexit(FlushRadialDBAtExit);
+    atx = 1;
+  }
+  return 0;
+}
+
+void RadialDBStats(long *nhit, long *nmiss) {
+  *nhit = _rdb.nhit;
+  *nmiss = _rdb.nmiss;
+}
+
+static int RadialDBSlaterKey(RDBREC *r, int k0, int k1, int k2, int k3,
+			     int k, int mode) {
+  int ko[4];
+
+  ko[0] = k0;
+  ko[1] = k1;
+  ko[2] = k2;
+  ko[3] = k3;
+  return RadialDBKey(r, RDB_SLATER, k, mode==0?1:mode, 0, 0.0, 4, ko);
+}
+
 void LoadRadialMultipole(char *fn) {
   int i, j, k, g, ak, ik, ig;
   char s1[16], s2[16];
@@ -683,6 +1051,7 @@ int RestorePotential(char *fn, POTENTIAL *p) {
   n = BFileRead(&p->sturm_idx, sizeof(double), 1, f);
   AllocPotMem(p, maxrp);
   n = BFileRead(p->dws, sizeof(double), p->nws, f);
+  ResetRadialPowers();
   /*
   n = BFileRead(p->Z, sizeof(double), p->maxrp, f);
   n = BFileRead(p->dZ, sizeof(double), p->maxrp, f);
@@ -922,10 +1291,20 @@ static void InitFltAryData(void *p, int n) {
   d = (FLTARY *) p;
   for (i = 0; i < n; i++) {
     d[i].npts = -1;
+    d[i].nq = 0;
+    d[i].nb = 0;
     d[i].yk = NULL;
   }
 }
 
+static int FltAryDataSize(void *p) {
+  FLTARY *d;
+
+  d = (FLTARY *) p;
+  if (d->npts > 0) return d->nb;
+  return 0;
+}
+
 int FreeSimpleArray(MULTI *ma) {
   MultiFreeData(ma, NULL);
   return 0;
@@ -933,6 +1312,7 @@ int FreeSimpleArray(MULTI *ma) {
 
 int FreeSlaterArray(void) {
   FreeSimpleArray(slater_array);
+  FreeSimpleArray(slater_array5);
   return 0;
 }
 
@@ -955,6 +1335,8 @@ static void FreeFltAryData(void *p) {
     free(dp->yk);    
     dp->yk = NULL;
     dp->npts = -1;
+    dp->nq = 0;
+    dp->nb = 0;
   }
 }
 
@@ -1633,6 +2015,7 @@ int SetRadialGrid(int maxrp, double ratio, double asymp,
   for (i = 0; i < NKSEP1; i++) {
     potential->sturm_ene[i] = 0.0;
   }
+  ResetRadialPowers();
   return 0;  
 }
 
@@ -2334,8 +2717,7 @@ int OptimizeLoop(AVERAGE_CONFIG *acfg) {
 	  no_old = 1;	
 	} else if (orb->isol == 1) {
 	  orb_old.energy = orb->energy; 
-	  free(orb->wfun);
-	  orb->wfun = NULL;
+	  FreeOrbitalWfun(orb);
 	  orb->isol = 0;
 	  no_old = 0;
 	} else {
@@ -2542,6 +2924,7 @@ int OptimizeRadial(int ng, int *kg, int ic, double *weight, int ife) {
   /* setup the radial grid if not yet */
   if (potential->flag == 0) {
     SetOrbitalRGrid(potential);
+    ResetRadialPowers();
   }
   
   int nmax = potential->nmax-1;
@@ -3001,6 +3384,7 @@ int SolveDirac(ORBITAL *orb) {
       }
     }
   }
+  OrbitalToArena(orb);
 #ifdef PERFORM_STATISTICS
   stop = clock();
   rad_timing.dirac += stop - start;
@@ -3579,16 +3963,262 @@ ORBITAL *GetNewOrbital(int n, int kappa, double e) {
   return orb;
 }
 
+typedef struct _BORB_ {
+  int n, kappa;
+  double e;
+} BORB;
+
+static int CompareBORB(const void *p1, const void *p2) {
+  const BORB *a = (const BORB *) p1;
+  const BORB *b = (const BORB *) p2;
+
+  if (a->n != b->n) return a->n < b->n ? -1 : 1;
+  if (a->kappa != b->kappa) return a->kappa < b->kappa ? -1 : 1;
+  if (a->n == 0 && fabs(a->e - b->e) >= EPS10) return a->e < b->e ? -1 : 1;
+  return 0;
+}
+
+/*
+** solve the orbitals (n[i], kappa[i], e[i]) that are not yet in the
+** table concurrently, e[i] is the energy of the free orbitals, n[i] = 0.
+** each orbital is solved into a private copy with the thread-private
+** work space, and the solutions are published into the orbitals array
+** at once. an orbital solved by another thread in the meantime is kept.
+** returns the number of orbitals added.
+*/
+int SolveOrbitalsBatch(int m, int *n, int *kappa, double *e) {
+  BORB *b;
+  ORBITAL *orbs, *orb;
+  int i, j, k, nb, ns, isol;
+
+  if (m <= 0) return 0;
+  b = malloc(sizeof(BORB)*m);
+  nb = 0;
+  for (i = 0; i < m; i++) {
+    if (n[i] == 0 && e[i] <= 0) continue;
+    k = OrbitalExists(n[i], kappa[i], n[i]==0?e[i]:0.0);
+    if (k >= 0 && GetOrbital(k)->isol) continue;
+    b[nb].n = n[i];
+    b[nb].kappa = kappa[i];
+    b[nb].e = n[i]==0?e[i]:0.0;
+    nb++;
+  }
+  if (nb == 0) {
+    free(b);
+    return 0;
+  }
+  qsort(b, nb, sizeof(BORB), CompareBORB);
+  j = 0;
+  for (i = 1; i < nb; i++) {
+    if (CompareBORB(b+j, b+i) == 0) continue;
+    j++;
+    if (j < i) b[j] = b[i];
+  }
+  nb = j+1;
+  orbs = malloc(sizeof(ORBITAL)*nb);
+  InitOrbitalData(orbs, nb);
+  for (i = 0; i < nb; i++) {
+    orbs[i].n = b[i].n;
+    orbs[i].kappa = b[i].kappa;
+    orbs[i].energy = b[i].e;
+  }
+  free(b);
+
+  ResetWidMPI();
+#pragma omp parallel default(shared) private(i, j)
+  {
+    for (i = 0; i < nb; i++) {
+      int skip = SkipMPI();
+      if (skip) continue;
+      j = SolveDirac(&orbs[i]);
+      if (j < 0) {
+	MPrintf(-1, "Error occured in solving Dirac eq. err = %d\n", j);
+	Abort(1);
+      }
+    }
+  }
+
+  ns = 0;
+  if (orbitals->lock) SetLock(orbitals->lock);
+  for (i = 0; i < nb; i++) {
+    if (orbs[i].isol == 0) continue;
+    k = OrbitalExistsNoLock(orbs[i].n, orbs[i].kappa, orbs[i].energy);
+    if (k >= 0) {
+      orb = GetOrbital(k);
+      if (orb->isol) {
+	FreeOrbitalData(&orbs[i]);
+	continue;
+      }
+    } else {
+      orb = GetNewOrbitalNoLock(orbs[i].n, orbs[i].kappa, orbs[i].energy);
+      k = orb->idx;
+    }
+    /* the lock-free readers test isol, set it after the data */
+    isol = orbs[i].isol;
+    orbs[i].isol = 0;
+    memcpy(orb, &orbs[i], sizeof(ORBITAL));
+    orb->idx = k;
+#pragma omp flush
+    orb->isol = isol;
+    ns++;
+  }
+  if (orbitals->lock) ReleaseLock(orbitals->lock);
+  free(orbs);
+  return ns;
+}
+
+/*
+** free the wavefunctions of the continuum orbitals at the m energies e.
+** the orbitals stay in the table marked unsolved, so that their indices
+** remain valid and OrbitalIndex solves them again if needed.
+*/
+int ReleaseContinua(int m, double *e) {
+  ORBITAL *orb;
+  int i, j, nr;
+
+  if (m <= 0) return 0;
+  nr = 0;
+  if (orbitals->lock) SetLock(orbitals->lock);
+  for (i = 0; i < n_orbitals; i++) {
+    orb = GetOrbital(i);
+    if (orb->n != 0 || orb->isol == 0) continue;
+    for (j = 0; j < m; j++) {
+      if (fabs(orb->energy - e[j]) < EPS10) break;
+    }
+    if (j == m) continue;
+    FreeOrbitalData(orb);
+    nr++;
+  }
+  if (orbitals->lock) ReleaseLock(orbitals->lock);
+  return nr;
+}
+
+static double *ArenaBlock(int i) {
+  return _orb_arena.chunk[i/ORB_ARENA_CHUNK] +
+    ((size_t)(i%ORB_ARENA_CHUNK))*_orb_arena.bsize;
+}
+
+/* release the chunks if no block is in use */
+static void ResetOrbitalArena(void) {
+  int i;
+
+  if (_orb_arena.nblocks > _orb_arena.nfree) return;
+  for (i = 0; i < ORB_ARENA_NCHUNKS; i++) {
+    if (_orb_arena.chunk[i] == NULL) break;
+    free(_orb_arena.base[i]);
+    _orb_arena.base[i] = NULL;
+    _orb_arena.chunk[i] = NULL;
+  }
+  _orb_arena.nblocks = 0;
+  _orb_arena.nfree = 0;
+  _orb_arena.bsize = 0;
+}
+
+/* a block for n doubles, returns -1 if it cannot be provided */
+static int ArenaAlloc(int n) {
+  int i, c, bsize;
+  size_t size, pa;
+  void *p;
+
+  bsize = ORB_ARENA_ALIGN/sizeof(double);
+  bsize = ((n+bsize-1)/bsize)*bsize;
+  if (_orb_arena.lock) SetLock(_orb_arena.lock);
+  if (_orb_arena.bsize != bsize) {
+    ResetOrbitalArena();
+    if (_orb_arena.nblocks > 0) {
+      if (_orb_arena.lock) ReleaseLock(_orb_arena.lock);
+      return -1;
+    }
+    _orb_arena.bsize = bsize;
+  }
+  if (_orb_arena.nfree > 0) {
+    i = _orb_arena.free[--_orb_arena.nfree];
+  } else {
+    i = _orb_arena.nblocks;
+    c = i/ORB_ARENA_CHUNK;
+    if (c >= ORB_ARENA_NCHUNKS) {
+      if (_orb_arena.lock) ReleaseLock(_orb_arena.lock);
+      return -1;
+    }
+    if (_orb_arena.chunk[c] == NULL) {
+      size = sizeof(double)*((size_t)bsize)*ORB_ARENA_CHUNK;
+      p = malloc(size+ORB_ARENA_ALIGN);
+      if (p == NULL) {
+	if (_orb_arena.lock) ReleaseLock(_orb_arena.lock);
+	return -1;
+      }
+      _orb_arena.base[c] = p;
+      p = (void *) ((((size_t) p)+ORB_ARENA_ALIGN-1) &
+		    ~((size_t) (ORB_ARENA_ALIGN-1)));
+#ifdef MADV_HUGEPAGE
+      if (size >= (1<<21)) {
+	/* the advice takes page aligned ranges */
+	pa = (((size_t) p)+4095) & ~((size_t) 4095);
+	madvise((void *) pa, (((size_t) p)+size-pa) & ~((size_t) 4095),
+		MADV_HUGEPAGE);
+      }
+#endif
+      _orb_arena.chunk[c] = (double *) p;
+    }
+    _orb_arena.nblocks++;
+  }
+  if (_orb_arena.lock) ReleaseLock(_orb_arena.lock);
+  return i;
+}
+
+static void ArenaFree(int i) {
+  if (_orb_arena.lock) SetLock(_orb_arena.lock);
+  if (_orb_arena.nfree == _orb_arena.mfree) {
+    _orb_arena.mfree += ORB_ARENA_CHUNK;
+    if (_orb_arena.free == NULL) {
+      _orb_arena.free = malloc(sizeof(int)*_orb_arena.mfree);
+    } else {
+      _orb_arena.free = realloc(_orb_arena.free, 
+				sizeof(int)*_orb_arena.mfree);
+    }
+  }
+  _orb_arena.free[_orb_arena.nfree++] = i;
+  if (_orb_arena.lock) ReleaseLock(_orb_arena.lock);
+}
+
+/* move the wavefunction of a solved bound orbital into the arena */
+void OrbitalToArena(ORBITAL *orb) {
+  int i;
+  
+  if (orb->n <= 0 || orb->wfun == NULL) return;
+  if (orb->iwf >= 0) {
+    if (orb->wfun == ArenaBlock(orb->iwf)) return;
+    ArenaFree(orb->iwf);
+    orb->iwf = -1;
+  }
+  i = ArenaAlloc(2*potential->maxrp);
+  if (i < 0) return;
+  memcpy(ArenaBlock(i), orb->wfun, sizeof(double)*2*potential->maxrp);
+  free(orb->wfun);
+  orb->wfun = ArenaBlock(i);
+  orb->iwf = i;
+}
+
+static void FreeOrbitalWfun(ORBITAL *orb) {
+  if (orb->iwf >= 0) {
+    if (orb->wfun && orb->wfun != ArenaBlock(orb->iwf)) {
+      free(orb->wfun);
+    }
+    ArenaFree(orb->iwf);
+    orb->iwf = -1;
+  } else if (orb->wfun) {
+    free(orb->wfun);
+  }
+  orb->wfun = NULL;
+}
+
 void FreeOrbitalData(void *p) {
   ORBITAL *orb;
 
   orb = (ORBITAL *) p;
   //RemoveOrbMap(orb);
-  if (orb->wfun) {
-    free(orb->wfun);
-  }
+  FreeOrbitalWfun(orb);
   if (orb->phase) free(orb->phase);
-  orb->wfun = NULL;
   orb->phase = NULL;
   orb->isol = 0;
   orb->ilast = -1;
@@ -3615,6 +4245,9 @@ int ClearOrbitalTable(int m) {
     n_continua = 0;
     ArrayFree(orbitals, FreeOrbitalData);
     RemoveOrbMap(0);
+    if (_orb_arena.lock) SetLock(_orb_arena.lock);
+    ResetOrbitalArena();
+    if (_orb_arena.lock) ReleaseLock(_orb_arena.lock);
   } else {
     for (i = n_orbitals-1; i >= 0; i--) {
       orb = GetOrbital(i);
@@ -4825,7 +5458,7 @@ double ConfigHamilton(CONFIG *cfg, ORBITAL *orb0, ORBITAL *orb1, double xdf) {
 int ResidualPotential(double *s, int k0, int k1) {
   int i;
   ORBITAL *orb1, *orb2;
-  int index[2];
+  unsigned long long key;
   LOCK *lock = NULL;
   double *p, z, *p1, *p2, *q1, *q2;
 
@@ -4838,15 +5471,13 @@ int ResidualPotential(double *s, int k0, int k1) {
   }
 
   if (k0 > k1) {
-    index[0] = k1;
-    index[1] = k0;
+    key = ResidualKey(k1, k0);
   } else {
-    index[0] = k0;
-    index[1] = k1;
+    key = ResidualKey(k0, k1);
   }
   int myrank = MyRankMPI()+1;
-  p = (double *) MultiSet(residual_array, index, NULL, &lock,
-			  InitDoubleData, NULL);
+  p = (double *) MultiSet64(residual_array, key, NULL, &lock,
+			    InitDoubleData, NULL);
   int locked = 0;
   if (lock && !(p && *p)) {
     SetLock(lock);
@@ -5179,6 +5810,22 @@ int MultipoleRadialFRGrid(double **p0, int m, int k1, int k2, int gauge) {
   rcl = ReducedCL(GetJFromKappa(kappa1), abs(2*m), 
 		  GetJFromKappa(kappa2));
   double *pt = (double *) malloc(sizeof(double)*n_awgrid);
+  RDBREC rdb;
+  int irdb;
+  for (i = 0; i < n_awgrid; i++) {
+    irdb = RadialDBKey(&rdb, RDB_MULTIPOLE, index[0], 0, gauge,
+		       awgrid[i], 2, index+1);
+    if (irdb < 0 || RadialDBGet(&rdb) < 0) break;
+    pt[i] = rdb.r;
+  }
+  if (i == n_awgrid) {
+    *p0 = *p1 = pt;
+    if (locked) ReleaseLock(lock);
+#pragma omp atomic
+    multipole_array->iset -= myrank;
+#pragma omp flush
+    return n_awgrid;
+  }
   if (fabs(rcl) < EPS10) {
     for (i = 0; i < n_awgrid; i++) {
       pt[i] = 0;
@@ -5279,6 +5926,13 @@ int MultipoleRadialFRGrid(double **p0, int m, int k1, int k2, int gauge) {
   rad_timing.radial_1e += stop - start;
 #endif
 
+  if (irdb == 0) {
+    for (i = 0; i < n_awgrid; i++) {
+      RadialDBKey(&rdb, RDB_MULTIPOLE, index[0], 0, gauge,
+		  awgrid[i], 2, index+1);
+      RadialDBAdd(&rdb, pt[i]);
+    }
+  }
   *p0 = *p1 = pt;
   if (locked) ReleaseLock(lock);
 #pragma omp atomic
@@ -6286,6 +6940,20 @@ double QED1E(int k0, int k1) {
 #pragma omp flush
     return *p;
   }
+  RDBREC rdb;
+  int irdb = RadialDBKey(&rdb, RDB_QED1E, 0, 0, 0, 0.0, 2, index);
+  if (irdb == 0 && RadialDBGet(&rdb) == 0) {
+    r = rdb.r;
+    if (k0 == k1 && optimize_control.mce < 20) {
+      orb1->qed = r;
+    }
+    *p = r;
+    if (locked) ReleaseLock(lock);
+#pragma omp atomic
+    qed1e_array->iset -= myrank;
+#pragma omp flush
+    return r;
+  }
   r = 0.0;
   if (orb1->kappa != orb2->kappa) {
     printf("dk: %d %d %d %d\n", orb1->n, orb1->kappa, orb2->n, orb2->kappa);
@@ -6310,6 +6978,7 @@ double QED1E(int k0, int k1) {
     }
   }
   *p = r;
+  if (irdb == 0) RadialDBAdd(&rdb, r);
   if (locked) ReleaseLock(lock);
 #pragma omp atomic
   qed1e_array->iset -= myrank;
@@ -6615,13 +7284,24 @@ double BreitS(int k0, int k1, int k2, int k3, int k) {
       return r;
     }
   }
-  double *z = _zk;
-  int npts = BreitSYK(k0, k1, k, z);
-  orb2 = GetOrbitalSolved(k2);
-  orb3 = GetOrbitalSolved(k3);
-  Integrate(z, orb2, orb3, 6, &r, 0);
+  RDBREC rdb;
+  int irdb = -1;
+  if (breit_array->maxsize != 0) {
+    irdb = RadialDBKey(&rdb, RDB_BREIT, k, -1, 0, 0.0, 4, index);
+  }
+  if (irdb == 0 && RadialDBGet(&rdb) == 0) {
+    r = rdb.r;
+    irdb = -1;
+  } else {
+    double *z = _zk;
+    int npts = BreitSYK(k0, k1, k, z);
+    orb2 = GetOrbitalSolved(k2);
+    orb3 = GetOrbitalSolved(k3);
+    Integrate(z, orb2, orb3, 6, &r, 0);
+  }
   if (breit_array->maxsize != 0) {
     if (!r) r = 1e-100;
+    if (irdb == 0) RadialDBAdd(&rdb, r);
     *p0 = r;
     if (locked) ReleaseLock(lock);
 #pragma omp atomic
@@ -6981,6 +7661,20 @@ double BreitWW(int k0, int k1, int k2, int k3, int k,
       if (locked) ReleaseLock(lock);
 #pragma omp atomic
       wbreit_array->iset -= myrank;
+#pragma omp flush
+      return r;
+    }
+  }
+  RDBREC rdb;
+  int irdb = -1;
+  if (wbreit_array->maxsize != 0) {
+    irdb = RadialDBKey(&rdb, RDB_BREIT, k, mbr, 1, 0.0, 4, index);
+    if (irdb == 0 && RadialDBGet(&rdb) == 0) {
+      r = rdb.r;
+      *p = r;
+      if (locked) ReleaseLock(lock);
+#pragma omp atomic
+      wbreit_array->iset -= myrank;
 #pragma omp flush
       return r;
     }
@@ -7097,6 +7791,7 @@ double BreitWW(int k0, int k1, int k2, int k3, int k,
   if (wbreit_array->maxsize != 0) {
     if (!r) r = 1e-100;
     *p = r;
+    if (irdb == 0) RadialDBAdd(&rdb, r);
     if (locked) ReleaseLock(lock);
 #pragma omp atomic
     wbreit_array->iset -= myrank;
@@ -7146,7 +7841,8 @@ double Breit(int k0, int k1, int k2, int k3, int k,
 int Slater(double *s, int k0, int k1, int k2, int k3, int k, int mode) {
   int index[5];
   double *p;
-  int ilast, i, npts, m;
+  int ilast, i, npts, m, irdb;
+  RDBREC rdb;
   ORBITAL *orb0, *orb1, *orb2, *orb3;
   double norm;
 #ifdef PERFORM_STATISTICS
@@ -7159,14 +7855,23 @@ int Slater(double *s, int k0, int k1, int k2, int k3, int k, int mode) {
   index[2] = k2;
   index[3] = k3;
   index[4] = k;  
+  irdb = -1;
 
   LOCK *lock = NULL;
   int locked = 0;
   int myrank = MyRankMPI()+1;
+  MULTI *sa = slater_array;
+  unsigned long long key;
   if (abs(mode) < 2) {
     SortSlaterKey(index);
-    p = (double *) MultiSet(slater_array, index, NULL, &lock,
-			    InitDoubleData, NULL);
+    if (SlaterKey(index, &key) == 0) {
+      p = (double *) MultiSet64(sa, key, NULL, &lock,
+				InitDoubleData, NULL);
+    } else {
+      sa = slater_array5;
+      p = (double *) MultiSet(sa, index, NULL, &lock,
+			      InitDoubleData, NULL);
+    }
     if (lock && !(p && *p)) {
       SetLock(lock);
       locked = 1;
@@ -7176,6 +7881,11 @@ int Slater(double *s, int k0, int k1, int k2, int k3, int k, int mode) {
   }
   if (p && *p) {
     *s = *p;
+  } else if (p &&
+	     (irdb = RadialDBSlaterKey(&rdb, k0, k1, k2, k3, k, mode)) == 0 &&
+	     RadialDBGet(&rdb) == 0) {
+    *s = rdb.r;
+    *p = *s;
   } else {
     orb0 = GetOrbitalSolved(k0);
     orb1 = GetOrbitalSolved(k1);
@@ -7235,11 +7945,12 @@ int Slater(double *s, int k0, int k1, int k2, int k3, int k, int mode) {
       break;
     }      
     if (p) *p = *s;
+    if (irdb == 0) RadialDBAdd(&rdb, *s);
   }
   if (locked) ReleaseLock(lock);
   if (p) {
 #pragma omp atomic
-    slater_array->iset -= myrank;
+    sa->iset -= myrank;
   }
 #pragma omp flush
 #ifdef PERFORM_STATISTICS 
@@ -7249,6 +7960,114 @@ int Slater(double *s, int k0, int k1, int k2, int k3, int k, int mode) {
   return 0;
 }
 
+/* calculate n slater integrals R^k(k0 k1[i]; k2 k3[i]) sharing the
+   Yk potential of k0 and k2. the cached integrals are reused, the
+   potential is built only once for the missing ones. mode is as in 
+   Slater(), out may be NULL if only the cache is to be filled.
+   returns the number of integrals evaluated. */
+int SlaterBatch(int k0, int k2, int k, int n, int *k1, int *k3,
+		double *out, int mode) {
+  int i, m, nm, index[5];
+  unsigned long long key;
+  double s, norm, **p;
+  RDBREC rdb;
+  MULTI **sa;
+  ORBITAL *orb0, *orb1, *orb2, *orb3;
+  LOCK *lock;
+  int myrank = MyRankMPI()+1;
+#ifdef PERFORM_STATISTICS
+  clock_t start, stop; 
+  start = clock();
+#endif
+
+  if (n <= 0) return 0;
+  if (abs(mode) > 1) {
+    for (i = 0; i < n; i++) {
+      Slater(&s, k0, k1[i], k2, k3[i], k, mode);
+      if (out) out[i] = s;
+    }
+    return n;
+  }
+
+  p = malloc(sizeof(double *)*n);
+  sa = malloc(sizeof(MULTI *)*n);
+  nm = 0;
+  for (i = 0; i < n; i++) {
+    index[0] = k0;
+    index[1] = k1[i];
+    index[2] = k2;
+    index[3] = k3[i];
+    index[4] = k;
+    SortSlaterKey(index);
+    lock = NULL;
+    if (SlaterKey(index, &key) == 0) {
+      sa[i] = slater_array;
+      p[i] = (double *) MultiSet64(sa[i], key, NULL, &lock,
+				   InitDoubleData, NULL);
+    } else {
+      sa[i] = slater_array5;
+      p[i] = (double *) MultiSet(sa[i], index, NULL, &lock,
+				 InitDoubleData, NULL);
+    }
+    if (!(*p[i]) &&
+	RadialDBSlaterKey(&rdb, k0, k1[i], k2, k3[i], k, mode) == 0 &&
+	RadialDBGet(&rdb) == 0) {
+      *p[i] = rdb.r;
+    }
+    if (*p[i]) {
+      if (out) out[i] = *p[i];
+      p[i] = NULL;
+#pragma omp atomic
+      sa[i]->iset -= myrank;
+    } else {
+      nm++;
+    }
+  }
+
+  if (nm > 0) {
+    orb0 = GetOrbitalSolved(k0);
+    orb2 = GetOrbitalSolved(k2);
+    if (mode < 0) {
+      GetYk(k, _yk, orb0, orb2, k0, k2, -2);
+    } else {
+      GetYk(k, _yk, orb0, orb2, k0, k2, -1);
+    }
+    for (m = 0; m < potential->maxrp; m++) {
+      _yk[m] /= potential->rad[m];
+    }
+    for (i = 0; i < n; i++) {
+      if (p[i] == NULL) continue;
+      orb1 = GetOrbitalSolved(k1[i]);
+      orb3 = GetOrbitalSolved(k3[i]);
+      if (mode < 0) {
+	Integrate(_yk, orb1, orb3, 2, &s, 0);
+	norm  = orb0->qr_norm;
+	norm *= orb1->qr_norm;
+	norm *= orb2->qr_norm;
+	norm *= orb3->qr_norm;
+	s *= norm;
+      } else {
+	Integrate(_yk, orb1, orb3, 1, &s, 0);
+      }
+      *p[i] = s;
+      if (out) out[i] = s;
+      if (RadialDBSlaterKey(&rdb, k0, k1[i], k2, k3[i], k, mode) == 0) {
+	RadialDBAdd(&rdb, s);
+      }
+#pragma omp atomic
+      sa[i]->iset -= myrank;
+    }
+  }
+  free(p);
+  free(sa);
+#pragma omp flush
+#ifdef PERFORM_STATISTICS 
+  stop = clock();
+  rad_timing.radial_2e += stop - start;
+#endif
+  return nm;
+}
+
 /* reorder the orbital index appears in the slater integral, so that it is
    in a form: a <= b <= d, a <= c, and if (a == b), c <= d. */ 
 void SortSlaterKey(int *kd) {
@@ -7341,15 +8160,16 @@ void PrepSlater(int ib0, int iu0, int ib1, int iu1,
 		int ib2, int iu2, int ib3, int iu3) {
 #pragma omp parallel default(shared)
   {
-  int k, kmax, kk, i, j, p, q, m, ilast;
+  int k, kmax, kk, i, j, p, q, nb;
   int j0, j1, j2, j3, k0, k1, k2, k3;
-  int index[6];
-  double *dp;
+  int *kb1, *kb3;
   ORBITAL *orb0, *orb1, *orb2, *orb3;
   int c = 0;
 
-  int myrank = MyRankMPI()+1;
   double wt0 = WallTime();
+  nb = Max(1, (iu1-ib1+1)*(iu3-ib3+1));
+  kb1 = malloc(sizeof(int)*nb);
+  kb3 = malloc(sizeof(int)*nb);
   kmax = GetMaxRank();
   for (kk = 0; kk <= kmax; kk += 2) {
     k = kk/2;
@@ -7363,11 +8183,7 @@ void PrepSlater(int ib0, int iu0, int ib1, int iu1,
 	if (k0 > slater_cut.kl0 || k2 > slater_cut.kl0) continue;
 	int skip = SkipMPI();
 	if (skip) continue;	     
-	GetYk(k, _yk, orb0, orb2, i, p, -1);
-	ilast = potential->maxrp-1;
-	for (m = 0; m <= ilast; m++) {
-	  _yk[m] /= potential->rad[m];
-	}
+	nb = 0;
 	for (j = ib1; j <= iu1; j++) {
 	  if (j < i) continue;
 	  orb1 = GetOrbital(j);
@@ -7381,38 +8197,105 @@ void PrepSlater(int ib0, int iu0, int ib1, int iu1,
 		IsOdd((k1+k3)/2+k) ||
 		!Triangle(j0, j2, kk) ||
 		!Triangle(j1, j3, kk)) continue;
-	    index[0] = i;
-	    index[1] = j;
-	    index[2] = p;
-	    index[3] = q;
-	    index[4] = k;
-	    index[5] = 0;
-	    LOCK *lock = NULL;
-	    dp = MultiSet(slater_array, index, NULL, &lock,
-			  InitDoubleData, NULL);
-	    c++;
-	    //if (lock) SetLock(lock);
-	    if (*dp == 0) {
-	      Integrate(_yk, orb1, orb3, 1, dp, 0);
-	    }
-	    //if (lock) ReleaseLock(lock);
-	    slater_array->iset -= myrank;
+	    kb1[nb] = j;
+	    kb3[nb] = q;
+	    nb++;
 	  }
 	}
+	SlaterBatch(i, p, k, nb, kb1, kb3, NULL, 1);
+	c += nb;
       }
     }
   }
+  free(kb1);
+  free(kb3);
   double wt1 = WallTime();
   MPrintf(-1, "PrepSlater: %d %g\n", c, wt1-wt0);
   }
 }
       
+/*
+** tables of ln(r) and r^k on the radial grid, shared by all threads.
+** r^k is built on the first use of each k, and the tables are reset
+** whenever the grid changes.
+*/
+void ResetRadialPowers(void) {
+  int k;
+
+#pragma omp critical(radial_powers)
+  {
+    if (_rpow_lnr != NULL) {
+      free(_rpow_lnr);
+      _rpow_lnr = NULL;
+    }
+    for (k = 0; k < MAXRPOW; k++) {
+      if (_rpow[k] != NULL) {
+	free(_rpow[k]);
+	_rpow[k] = NULL;
+      }
+    }
+    _rpow_n = 0;
+    _rpow_maxlnr = 0.0;
+  }
+#pragma omp flush
+}
+
+/* r^k on the grid, NULL if k is not tabulated or r^k would overflow */
+static double *RadialPowers(int k) {
+  int i, n;
+  double *p, a;
+
+  if (k < 0 || k >= MAXRPOW) {
+#ifdef PERFORM_STATISTICS
+    rad_timing.nrpow_pow++;
+#endif
+    return NULL;
+  }
+  p = _rpow[k];
+  if (p == NULL) {
+#pragma omp critical(radial_powers)
+    {
+      n = potential->maxrp;
+      if (_rpow_lnr == NULL) {
+	_rpow_lnr = malloc(sizeof(double)*n);
+	_rpow_maxlnr = 0.0;
+	for (i = 0; i < n; i++) {
+	  _rpow_lnr[i] = log(potential->rad[i]);
+	  a = fabs(_rpow_lnr[i]);
+	  if (a > _rpow_maxlnr) _rpow_maxlnr = a;
+	}
+	_rpow_n = n;
+      }
+      if (_rpow[k] == NULL && _rpow_n == n &&
+	  k*_rpow_maxlnr < MAXRPOWLN) {
+	p = malloc(sizeof(double)*n);
+	for (i = 0; i < n; i++) {
+	  p[i] = pow(potential->rad[i], k);
+	}
+#pragma omp flush
+	_rpow[k] = p;
+      }
+      p = _rpow[k];
+    }
+  }
+#ifdef PERFORM_STATISTICS
+  if (p) rad_timing.nrpow_table++;
+  else rad_timing.nrpow_pow++;
+#endif
+  return p;
+}
+
 int GetYk0(int k, double *yk, ORBITAL *orb1, ORBITAL *orb2, int type) {
   int i, ilast, i0;
-  double a, max;
+  double a, max, *rk;
 
-  for (i = 0; i < potential->maxrp; i++) {
-    _dwork1[i] = pow(potential->rad[i], k);
+  rk = RadialPowers(k);
+  if (rk) {
+    memcpy(_dwork1, rk, sizeof(double)*potential->maxrp);
+  } else {
+    for (i = 0; i < potential->maxrp; i++) {
+      _dwork1[i] = pow(potential->rad[i], k);
+    }
   }
   Integrate(_dwork1, orb1, orb2, type, _zk, 0);
   for (i = 0; i < potential->maxrp; i++) {
@@ -7435,8 +8318,15 @@ int GetYk0(int k, double *yk, ORBITAL *orb1, ORBITAL *orb2, int type) {
     }
     i0 = i;
   } else i0 = 0;
-  for (i = i0; i < potential->maxrp; i++) {
-    _dwork1[i] = pow(potential->rad[i0]/potential->rad[i], k+1);
+  if (rk) {
+    a = rk[i0]*potential->rad[i0];
+    for (i = i0; i < potential->maxrp; i++) {
+      _dwork1[i] = a/(rk[i]*potential->rad[i]);
+    }
+  } else {
+    for (i = i0; i < potential->maxrp; i++) {
+      _dwork1[i] = pow(potential->rad[i0]/potential->rad[i], k+1);
+    }
   }
   Integrate(_dwork1, orb1, orb2, type, _xk, 0);
   ilast = potential->maxrp - 1;    
@@ -7454,15 +8344,27 @@ int GetYk0(int k, double *yk, ORBITAL *orb1, ORBITAL *orb2, int type) {
 */      
 int GetYk1(int k, double *yk, ORBITAL *orb1, ORBITAL *orb2, int type) {
   int i, ilast;
-  double r0, a;
+  double r0, a, b, *rk;
+#ifdef PERFORM_STATISTICS 
+  clock_t start, stop;
+  start = clock();
+#endif
   
   ilast = Min(orb1->ilast, orb2->ilast);
   r0 = sqrt(potential->rad[0]*potential->rad[ilast]);  
-  for (i = 0; i < potential->maxrp; i++) {
-    _dwork1[i] = pow(potential->rad[i]/r0, k);
+  a = pow(r0, k);
+  rk = RadialPowers(k);
+  if (rk) {
+    b = 1.0/a;
+    for (i = 0; i < potential->maxrp; i++) {
+      _dwork1[i] = rk[i]*b;
+    }
+  } else {
+    for (i = 0; i < potential->maxrp; i++) {
+      _dwork1[i] = pow(potential->rad[i]/r0, k);
+    }
   }
   Integrate(_dwork1, orb1, orb2, type, _zk, 0);
-  a = pow(r0, k);
   for (i = 0; i < potential->maxrp; i++) {
     _zk[i] /= _dwork1[i];
     yk[i] = _zk[i];
@@ -7475,58 +8377,193 @@ int GetYk1(int k, double *yk, ORBITAL *orb1, ORBITAL *orb2, int type) {
   for (i = 0; i < potential->maxrp; i++) {
     yk[i] += _xk[i]/_dwork1[i];
   }
+#ifdef PERFORM_STATISTICS 
+  stop = clock();
+  rad_timing.radial_yk += stop - start;
+#endif
       
   return 0;
 }
       
+/*
+** compress the first n points of yk for the cache, with the absolute
+** error bounded by tol*max|yk|. the two asymptotic parameters c0 and
+** c1 are stored first. each block of YKQBLOCK points is then stored
+** as the number of bits per point, the offset and step in float,
+** and the 8 or 16 bit codes, or the floats themselves if 16 bits do
+** not meet the error bound. returns NULL if nothing is saved
+** compared to the plain floats.
+*/
+static unsigned char *CompressYk(double *yk, int n, float c0, float c1,
+				 double tol, int *nb) {
+  unsigned char *p, *q;
+  int i, j, m, nbits;
+  double a, b, e;
+  float f0, f1;
+  unsigned short u;
+
+  e = 0.0;
+  for (i = 0; i < n; i++) {
+    a = fabs(yk[i]);
+    if (a > e) e = a;
+  }
+  e *= tol;
+  p = malloc(2*sizeof(float) + n*sizeof(float) +
+	     ((n+YKQBLOCK-1)/YKQBLOCK)*(1+2*sizeof(float)));
+  memcpy(p, &c0, sizeof(float));
+  memcpy(p+sizeof(float), &c1, sizeof(float));
+  q = p + 2*sizeof(float);
+  for (i = 0; i < n; i += YKQBLOCK) {
+    m = Min(YKQBLOCK, n-i);
+    a = yk[i];
+    b = yk[i];
+    for (j = 1; j < m; j++) {
+      if (yk[i+j] < a) a = yk[i+j];
+      if (yk[i+j] > b) b = yk[i+j];
+    }
+    if (b - a <= 2*e) nbits = 0;
+    else if (b - a <= 510*e) nbits = 8;
+    else if (b - a <= 131070*e) nbits = 16;
+    else nbits = 32;
+    *(q++) = nbits;
+    if (nbits == 32) {
+      for (j = 0; j < m; j++) {
+	f0 = yk[i+j];
+	memcpy(q, &f0, sizeof(float));
+	q += sizeof(float);
+      }
+      continue;
+    }
+    if (nbits == 0) {
+      f0 = 0.5*(a+b);
+      f1 = 0.0;
+    } else {
+      f0 = a;
+      f1 = (b-a)/((1<<nbits)-1);
+    }
+    memcpy(q, &f0, sizeof(float));
+    q += sizeof(float);
+    memcpy(q, &f1, sizeof(float));
+    q += sizeof(float);
+    if (nbits == 0) continue;
+    for (j = 0; j < m; j++) {
+      u = (unsigned short) Max(0, Min((1<<nbits)-1,
+				      (int) floor((yk[i+j]-f0)/f1 + 0.5)));
+      if (nbits == 8) {
+	*(q++) = (unsigned char) u;
+      } else {
+	memcpy(q, &u, sizeof(u));
+	q += sizeof(u);
+      }
+    }
+  }
+  *nb = q - p;
+  if (*nb >= (n+2)*sizeof(float)) {
+    free(p);
+    return NULL;
+  }
+  return realloc(p, *nb);
+}
+
+/* restore the n points of yk and the asymptotic parameters */
+static void DecompressYk(unsigned char *p, int n, double *yk,
+			 double *c0, double *c1) {
+  int i, j, m, nbits;
+  float f0, f1;
+  unsigned short u;
+
+  memcpy(&f0, p, sizeof(float));
+  memcpy(&f1, p+sizeof(float), sizeof(float));
+  *c0 = f0;
+  *c1 = f1;
+  p += 2*sizeof(float);
+  for (i = 0; i < n; i += YKQBLOCK) {
+    m = Min(YKQBLOCK, n-i);
+    nbits = *(p++);
+    if (nbits == 32) {
+      for (j = 0; j < m; j++) {
+	memcpy(&f0, p, sizeof(float));
+	p += sizeof(float);
+	yk[i+j] = f0;
+      }
+      continue;
+    }
+    memcpy(&f0, p, sizeof(float));
+    p += sizeof(float);
+    memcpy(&f1, p, sizeof(float));
+    p += sizeof(float);
+    if (nbits == 0) {
+      for (j = 0; j < m; j++) yk[i+j] = f0;
+    } else if (nbits == 8) {
+      for (j = 0; j < m; j++) yk[i+j] = f0 + ((double)f1)*p[j];
+      p += m;
+    } else {
+      for (j = 0; j < m; j++) {
+	memcpy(&u, p, sizeof(u));
+	p += sizeof(u);
+	yk[i+j] = f0 + ((double)f1)*u;
+      }
+    }
+  }
+}
+
+/*
+** set the relative error of the compressed Yk cache, 0 to store the
+** plain floats.
+*/
+void SetYkCompression(double tol) {
+  _yk_qtol = tol;
+}
+
 int GetYk(int k, double *yk, ORBITAL *orb1, ORBITAL *orb2, 
 	  int k1, int k2, int type) {
   int i, i0, i1, n, npts, ic0, ic1;
-  double a, b, a2, b2, max, max1;
-  int index[3];
+  double a, b, a2, b2, max, max1, c0, c1, *rk;
+  unsigned long long key;
   FLTARY *syk;
 
   syk = NULL;
   LOCK *lock = NULL;
   int locked = 0;
   int myrank = MyRankMPI()+1;
-  if (yk_array->maxsize != 0) {
-    if (k1 <= k2) {
-      index[0] = k1;
-      index[1] = k2;
-    } else {
-      index[0] = k2;
-      index[1] = k1;
-    }
-    index[2] = k;
-    syk = (FLTARY *) MultiSet(yk_array, index, NULL, &lock,
-			      InitFltAryData, FreeFltAryData);
+  if (yk_array->maxsize != 0 &&
+      YkKey(Min(k1, k2), Max(k1, k2), k, &key) == 0) {
+    syk = (FLTARY *) MultiSet64(yk_array, key, NULL, &lock,
+				InitFltAryData, FreeFltAryData);
     if (lock && syk->npts <= 0) {
       SetLock(lock);
       locked = 1;
     }
     if (syk->npts > 0) {
       npts = syk->npts-2;
-      for (i = npts-1; i < potential->maxrp; i++) {
-	_dwork1[i] = pow(potential->rad[i], k);
+      rk = RadialPowers(k);
+      if (rk == NULL) {
+	for (i = npts-1; i < potential->maxrp; i++) {
+	  _dwork1[i] = pow(potential->rad[i], k);
+	}
+	rk = _dwork1;
       }
-      for (i = 0; i < npts; i++) {
-	yk[i] = syk->yk[i];
+      if (syk->nq) {
+	DecompressYk((unsigned char *) syk->yk, npts, yk, &c0, &c1);
+      } else {
+	for (i = 0; i < npts; i++) {
+	  yk[i] = syk->yk[i];
+	}
+	c0 = syk->yk[npts];
+	c1 = syk->yk[npts+1];
       }
-      ic0 = npts;
-      ic1 = npts+1;
       i0 = npts-1;
-      a = syk->yk[i0]*_dwork1[i0];
+      a = yk[i0]*rk[i0];
       for (i = npts; i < potential->maxrp; i++) {
 	b = potential->rad[i] - potential->rad[i0];
-	b = syk->yk[ic1]*b;
+	b = c1*b;
 	if (b < -20) {
-	  yk[i] = syk->yk[ic0];
+	  yk[i] = c0;
 	} else {
-	  yk[i] = (a - syk->yk[ic0])*exp(b);
-	  yk[i] += syk->yk[ic0];
+	  yk[i] = (a - c0)*exp(b);
+	  yk[i] += c0;
 	}
-	yk[i] /= _dwork1[i];
+	yk[i] /= rk[i];
       }    
     }
   }
@@ -7567,6 +8604,7 @@ int GetYk(int k, double *yk, ORBITAL *orb1, ORBITAL *orb2,
     if (syk != NULL) {
       int size = sizeof(float)*(npts+2);
       syk->yk = malloc(size);
+      syk->nb = size;
       AddMultiSize(yk_array, size);
       for (i = 0; i < npts ; i++) {
 	syk->yk[i] = yk[i];
@@ -7600,11 +8638,23 @@ int GetYk(int k, double *yk, ORBITAL *orb1, ORBITAL *orb2,
       if (syk->yk[ic1] >= 0) {
 	syk->yk[ic1] = -10.0/(potential->rad[i1]-potential->rad[i0]);
       }
+      if (_yk_qtol > 0) {
+	unsigned char *qyk;
+	qyk = CompressYk(yk, npts, syk->yk[ic0], syk->yk[ic1],
+			 _yk_qtol, &size);
+	if (qyk != NULL) {
+	  AddMultiSize(yk_array, size - syk->nb);
+	  free(syk->yk);
+	  syk->yk = (float *) qyk;
+	  syk->nb = size;
+	  syk->nq = 1;
+	}
+      }
       syk->npts = npts+2;
     }
   }
   if (locked) ReleaseLock(lock);  
-  if (yk_array->maxsize != 0) {
+  if (syk != NULL) {
 #pragma omp atomic
     yk_array->iset -= myrank;
   }
@@ -7720,6 +8770,62 @@ void AddEvenPoints(double *r, double *r1, int i0, int i1, int t) {
   }
 }
 
+/* x[i] = a[i]*b[i]*f[i]*dr[i] for i0 <= i <= i1 */
+static SIMD_CLONES void ProductKernel1(int i0, int i1, double *x,
+				       double *a, double *b,
+				       double *f, double *dr) {
+  int i;
+
+  for (i = i0; i <= i1; i++) {
+    x[i] = a[i]*b[i];
+    x[i] *= f[i]*dr[i];
+  }
+}
+
+/* x[i] = (a1[i]*b1[i] + s*a2[i]*b2[i])*f[i]*dr[i], s = 1 or -1 */
+static SIMD_CLONES void ProductKernel2(int i0, int i1, double *x,
+				       double *a1, double *b1,
+				       double *a2, double *b2, double s,
+				       double *f, double *dr) {
+  int i;
+
+  for (i = i0; i <= i1; i++) {
+    x[i] = a1[i]*b1[i];
+    x[i] += s*(a2[i]*b2[i]);
+    x[i] *= f[i]*dr[i];
+  }
+}
+
+/* the integrand of the types 1-6 between i0 and i1 */
+static void IntegrandProduct(int type, int i0, int i1, double *x, double *f,
+			     double *large1, double *small1,
+			     double *large2, double *small2) {
+  double *dr = potential->dr_drho;
+
+  switch (type) {
+  case 1:
+    ProductKernel2(i0, i1, x, large1, large2, small1, small2, 1.0, f, dr);
+    break;
+  case 2:
+    ProductKernel1(i0, i1, x, large1, large2, f, dr);
+    break;
+  case 3:
+    ProductKernel1(i0, i1, x, small1, small2, f, dr);
+    break;
+  case 4:
+    ProductKernel2(i0, i1, x, large1, small2, small1, large2, 1.0, f, dr);
+    break;
+  case 5:
+    ProductKernel2(i0, i1, x, large1, small2, small1, large2, -1.0, f, dr);
+    break;
+  case 6:
+    ProductKernel1(i0, i1, x, large1, small2, f, dr);
+    break;
+  default:
+    break;
+  }
+}
+
 int IntegrateSubRegion(int i0, int i1, 
 		       double *f, ORBITAL *orb1, ORBITAL *orb2,
 		       int t, double *r, int m, double *ext) {
@@ -7750,13 +8856,11 @@ int IntegrateSubRegion(int i0, int i1,
     large2 = Large(orb2);
     small1 = Small(orb1);
     small2 = Small(orb2);
+    if (type > 6) return -1;
+    IntegrandProduct(type, i0, i1, x, f, large1, small1, large2, small2);
+    i = i1+1;
     switch (type) {
     case 1: /* type = 1 */
-      for (i = i0; i <= i1; i++) {
-	x[i] = large1[i] * large2[i];
-	x[i] += small1[i] * small2[i];
-	x[i] *= f[i]*potential->dr_drho[i];
-      }
       if (i1 == orb1->ilast && orb1->n == 0 && i < potential->maxrp) {
 	if (i <= orb2->ilast) {
 	  ip = i+1;
@@ -7800,10 +8904,6 @@ int IntegrateSubRegion(int i0, int i1,
       }
       break;
     case 2: /* type = 2 */
-      for (i = i0; i <= i1; i++) {
-	x[i] = large1[i] * large2[i];
-	x[i] *= f[i]*potential->dr_drho[i];
-      }
       if (i1 == orb1->ilast && orb1->n == 0 && i < potential->maxrp) {
 	if (i <= orb2->ilast) {
 	  ip = i+1;
@@ -7843,10 +8943,6 @@ int IntegrateSubRegion(int i0, int i1,
       }
       break;
     case 3: /*type = 3 */
-      for (i = i0; i <= i1; i++) {
-	x[i] = small1[i] * small2[i];
-	x[i] *= f[i]*potential->dr_drho[i];
-      }
       if (i1 == orb1->ilast && orb1->n == 0 && i < potential->maxrp) {
 	if (i <= orb2->ilast) {
 	  ip = i+1;
@@ -7886,11 +8982,6 @@ int IntegrateSubRegion(int i0, int i1,
       }
       break;
     case 4: /*type = 4 */
-      for (i = i0; i <= i1; i++) {
-	x[i] = large1[i] * small2[i];
-	x[i] += small1[i] * large2[i];
-	x[i] *= f[i]*potential->dr_drho[i];
-      }
       if (i1 == orb1->ilast && orb1->n == 0 && i < potential->maxrp) {
 	if (i <= orb2->ilast) {
 	  ip = i+1;
@@ -7934,11 +9025,6 @@ int IntegrateSubRegion(int i0, int i1,
       }
       break;
     case 5: /* type = 5 */
-      for (i = i0; i <= i1; i++) {
-	x[i] = large1[i] * small2[i];
-	x[i] -= small1[i] * large2[i];
-	x[i] *= f[i]*potential->dr_drho[i];
-      } 
       if (i1 == orb1->ilast && orb1->n == 0 && i < potential->maxrp) {
 	if (i <= orb2->ilast) {
 	  ip = i+1;
@@ -7982,10 +9068,6 @@ int IntegrateSubRegion(int i0, int i1,
       }
       break;
     case 6: /* type = 6 */
-      for (i = i0; i <= i1; i++) {
-	x[i] = large1[i] * small2[i];
-	x[i] *= f[i]*potential->dr_drho[i];
-      }
       if (i1 == orb1->ilast && orb1->n == 0 && i < potential->maxrp) {
 	if (i <= orb2->ilast) {
 	  ip = i+1;
@@ -8671,6 +9753,12 @@ int IntegrateSinCos(int j, double *x, double *y,
   return 0;
 }
 
+/*
+** m < 100 limits the size of the arrays in MB, 100 <= m < 200 sets
+** their clean thresholds. m = 200 sets the relative error of the
+** compressed Yk cache, and m = 300, 301 the fraction of the limit
+** kept by the lru eviction of yk_array and slater_array.
+*/
 void LimitArrayRadial(int m, double n) {
   int i;
   
@@ -8682,6 +9770,7 @@ void LimitArrayRadial(int m, double n) {
     if (n < 0) n = ARYCTH;
     yk_array->cth = n;
     slater_array->cth = n;
+    slater_array5->cth = n;
     breit_array->cth = n;
     wbreit_array->cth = n;
     gos_array->cth = n;
@@ -8704,9 +9793,11 @@ void LimitArrayRadial(int m, double n) {
     break;
   case 1:
     LimitMultiSize(slater_array, n);
+    LimitMultiSize(slater_array5, n);
     break;
   case 101:
     slater_array->cth = n;
+    slater_array5->cth = n;
     break;
   case 2:
     LimitMultiSize(breit_array, n);
@@ -8770,6 +9861,16 @@ void LimitArrayRadial(int m, double n) {
   case 124:
     xbreit_array[m-120]->cth = n;    
     break;
+  case 200:
+    SetYkCompression(n);
+    break;
+  case 300:
+    SetMultiLRU(yk_array, n, FltAryDataSize);
+    break;
+  case 301:
+    SetMultiLRU(slater_array, n, NULL);
+    SetMultiLRU(slater_array5, n, NULL);
+    break;
   default:
     printf("nothing is done\n");
     break;
@@ -8838,10 +9939,27 @@ int InitRadial(void) {
   orbitals = malloc(sizeof(ARRAY));
   if (!orbitals) return -1;
   if (ArrayInit(orbitals, sizeof(ORBITAL), _orbitals_block) < 0) return -1;
-  ndim = 5;
+  memset(&_orb_arena, 0, sizeof(ORBITAL_ARENA));
+#if USE_MPI == 2
+  _orb_arena.lock = (LOCK *) malloc(sizeof(LOCK));
+  if (0 != InitLock(_orb_arena.lock)) {
+    printf("cannot InitLock in InitRadial\n");
+    free(_orb_arena.lock);
+    _orb_arena.lock = NULL;
+    Abort(1);
+  }
+#endif
+  ndim = 2;
+  for (i = 0; i < ndim; i++) blocks[i] = MULTI_BLOCK2;
   slater_array = (MULTI *) malloc(sizeof(MULTI));
   MultiInit(slater_array, sizeof(double), ndim, blocks, "slater_array");
   slater_array->cth = cth;
+
+  ndim = 5;
+  for (i = 0; i < ndim; i++) blocks[i] = MULTI_BLOCK6;
+  slater_array5 = (MULTI *) malloc(sizeof(MULTI));
+  MultiInit(slater_array5, sizeof(double), ndim, blocks, "slater_array5");
+  slater_array5->cth = cth;
   
   ndim = 5;
   for (i = 0; i < ndim; i++) blocks[i] = MULTI_BLOCK5;
@@ -8889,6 +10007,8 @@ int InitRadial(void) {
   MultiInit(gos_array, sizeof(double *), ndim, blocks, "gos_array");
   gos_array->cth = cth;
 
+  ndim = 2;
+  for (i = 0; i < ndim; i++) blocks[i] = MULTI_BLOCK2;
   yk_array = (MULTI *) malloc(sizeof(MULTI));
   MultiInit(yk_array, sizeof(FLTARY), ndim, blocks, "yk_array");
   yk_array->cth = cth;
@@ -8907,6 +10027,7 @@ int InitRadial(void) {
 void SetRadialCleanFlags(void) {  
   int i;
   SetMultiCleanFlag(slater_array);
+  SetMultiCleanFlag(slater_array5);
   SetMultiCleanFlag(yk_array);
   SetMultiCleanFlag(breit_array);
   for (i = 0; i < 5; i++) {
@@ -8921,9 +10042,11 @@ int ReinitRadial(int m) {
 #pragma omp barrier
 #pragma omp master
   {
+  FlushRadialDB();
+  UnloadRadialDB();
   SetSlaterCut(-1, -1);
   ClearOrbitalTable(m);
-  FreeSimpleArray(slater_array);
+  FreeSlaterArray();
   FreeBreitArray();
   FreeSimpleArray(residual_array);
   FreeSimpleArray(qed1e_array);
@@ -9179,12 +10302,105 @@ int TestIntegrate(void) {
   return 0;
 }
 
+static double KernelDiff(double *x, double *y, int i0, int i1) {
+  int i;
+  double d, s;
+
+  d = 0.0;
+  s = 0.0;
+  for (i = i0; i <= i1; i++) {
+    d = Max(d, fabs(x[i]-y[i]));
+    s = Max(s, fabs(y[i]));
+  }
+  if (s > 0) d /= s;
+  return d;
+}
+
+/* compare the vectorized integrand and newton-cotes kernels with
+   the plain loops on the orbitals k1 and k2. returns the number of
+   results differing by more than the relative tolerance. */
+int TestIntegrateKernels(int k1, int k2) {
+  int i, t, m, id, n, nf, ilast;
+  double *x, *y, *r0, *r1, *dr, d, tol = 1e-10;
+  double *large1, *large2, *small1, *small2;
+  ORBITAL *orb1, *orb2;
+
+  orb1 = GetOrbitalSolved(k1);
+  orb2 = GetOrbitalSolved(k2);
+  if (orb1 == NULL || orb2 == NULL) return -1;
+  large1 = Large(orb1);
+  large2 = Large(orb2);
+  small1 = Small(orb1);
+  small2 = Small(orb2);
+  dr = potential->dr_drho;
+  n = potential->maxrp;
+  ilast = Min(orb1->ilast, orb2->ilast);
+  x = malloc(sizeof(double)*n*4);
+  y = x + n;
+  r0 = y + n;
+  r1 = r0 + n;
+  for (i = 0; i < n; i++) {
+    _xk[i] = potential->rad[i];
+  }
+  nf = 0;
+  for (t = 1; t <= 6; t++) {
+    IntegrandProduct(t, 0, ilast, x, _xk, large1, small1, large2, small2);
+    for (i = 0; i <= ilast; i++) {
+      switch (t) {
+      case 1:
+	y[i] = large1[i]*large2[i] + small1[i]*small2[i];
+	break;
+      case 2:
+	y[i] = large1[i]*large2[i];
+	break;
+      case 3:
+	y[i] = small1[i]*small2[i];
+	break;
+      case 4:
+	y[i] = large1[i]*small2[i] + small1[i]*large2[i];
+	break;
+      case 5:
+	y[i] = large1[i]*small2[i] - small1[i]*large2[i];
+	break;
+      default:
+	y[i] = large1[i]*small2[i];
+	break;
+      }
+      y[i] *= _xk[i]*dr[i];
+    }
+    d = KernelDiff(x, y, 0, ilast);
+    if (d > tol) nf++;
+    printf("%d %2d %2d %12.5E\n", t, 0, 0, d);
+    for (m = -1; m <= 1; m += 2) {
+      for (id = -1; id <= 0; id++) {
+	for (i = 0; i < n; i++) {
+	  r0[i] = 0.0;
+	  r1[i] = 0.0;
+	}
+	NewtonCotes(r0, y, 0, ilast, m, id);
+	NewtonCotes0(r1, y, 0, ilast, m, id);
+	d = KernelDiff(r0, r1, 0, ilast);
+	if (d > tol) nf++;
+	printf("%d %2d %2d %12.5E\n", t, m, id, d);
+      }
+    }
+  }
+  free(x);
+  
+  return nf;
+}
+
 void RemoveOrbitalLock(void) {
   if (orbitals->lock) {
     DestroyLock(orbitals->lock);
     free(orbitals->lock);
     orbitals->lock = NULL;
   }
+  if (_orb_arena.lock) {
+    DestroyLock(_orb_arena.lock);
+    free(_orb_arena.lock);
+    _orb_arena.lock = NULL;
+  }
 }
 
 int TestIntegrate0(void) {
@@ -38,6 +38,9 @@ typedef struct _RAD_TIMING_ {
   double radial_2e;
   double dirac;
   double radial_slater;
+  double radial_yk;
+  long nrpow_table;
+  long nrpow_pow;
 } RAD_TIMING;
 
 int GetRadTiming(RAD_TIMING *t);
@@ -104,6 +107,8 @@ void AddOrbMap(ORBITAL *orb);
 void RemoveOrbMap(int m);
 ORBITAL *GetNewOrbitalNoLock(int n, int kappa, double e);
 ORBITAL *GetNewOrbital(int n, int kappa, double e);
+int SolveOrbitalsBatch(int m, int *n, int *kappa, double *e);
+int ReleaseContinua(int m, double *e);
 int GetNumBounds(void);
 int GetNumOrbitals(void);
 int GetNumContinua(void);
@@ -143,6 +148,14 @@ void DiExAvgConfig(AVERAGE_CONFIG *cfg, double *d0, double *d1);
 void DiExConfig(CONFIG *cfg, double *d0, double *d1);
 
 /* routines for radial integral calculations */
+void ResetRadialPowers(void);
+void SetYkCompression(double tol);
+unsigned long long HashBytes(unsigned long long h,
+			     const void *p, size_t n);
+unsigned long long PotentialHash(void);
+int SetRadialDB(char *fn);
+int FlushRadialDB(void);
+void RadialDBStats(long *nhit, long *nmiss);
 int GetYk(int k, double *yk, ORBITAL *orb1, ORBITAL *orb2, 
 	  int k1, int k2, int type);
 int Integrate(double *f, ORBITAL *orb1, ORBITAL *orb2, int type, double *r, int id);
@@ -159,6 +172,8 @@ double SelfEnergy(ORBITAL *orb1, ORBITAL *orb2);
 double SelfEnergyRatioWelton(ORBITAL *orb, ORBITAL *horb);
 double SelfEnergyRatio(ORBITAL *orb, ORBITAL *horb);
 int Slater(double *s, int k0, int k1, int k2, int k3, int k, int mode);
+int SlaterBatch(int k0, int k2, int k, int n, int *k1, int *k3,
+		double *out, int mode);
 int BreitX(ORBITAL *orb0, ORBITAL *orb1, int k, int m, int w, int mbr,
 	   double e, double *y);
 double BreitC(int n, int m, int k, int k0, int k1, int k2, int k3);
@@ -196,11 +211,13 @@ int InitRadial(void);
 int ReinitRadial(int m);
 void SetRadialCleanFlags(void);
 int TestIntegrate(void);
+int TestIntegrateKernels(int k1, int k2);
 int RestorePotential(char *fn, POTENTIAL *p);
 int SavePotential(char *fn, POTENTIAL *p);
 int ModifyPotential(char *fn, POTENTIAL *p);
 void OptimizeModSE(int n, int ka, double dr, int ni);
 void RemoveOrbitalLock(void);
+void OrbitalToArena(ORBITAL *orb);
 double GetHXS(POTENTIAL *p);
 int AddNewConfigToList(int k, int ni, int *kc, CONFIG *c0,
 		       int nb, int **kbc,
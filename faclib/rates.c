@@ -36,8 +36,6 @@ static int ixdist = 0;
 static DISTRIBUTION cxt_dist[MAX_DIST];
 
 #define QUAD_LIMIT 64
-static int _iwork[QUAD_LIMIT];
-static double _dwork[4*QUAD_LIMIT];
 
 #define N3BRI 2000
 static double gamma3b = 1.0;
@@ -57,7 +55,8 @@ static double _tpber[] = {-41.609, -20.88578477, -15.24262691,
 			  -12.59173513, -10.05431044,
 			  -8.29404964,  -5.62682143,  -4.50986001};  
 
-static struct {
+/* the arguments of an IntegrateRate call, passed to the integrand */
+typedef struct _RATE_ARGS_ {
   DISTRIBUTION *d;
   double (*Rate1E)(double, double, int, void *);
   double eth;
@@ -65,11 +64,13 @@ static struct {
   void *params;
   int i, f;
   int type;
-  int xlog, elog;
-  double eg[N3BRI], fg[N3BRI];
-} rate_args;
+  int xlog;
+} RATE_ARGS;
 
-#pragma omp threadprivate(rate_args, _iwork, _dwork)
+/* the three-body recombination distribution, set with the electron
+   distribution and shared by all threads */
+static int _tbr_elog = 0;
+static double _tbr_eg[N3BRI], _tbr_fg[N3BRI];
 
 #define NSEATON 19
 static double log_xseaton[NSEATON];
@@ -193,68 +194,69 @@ static void ThreeBodyDist(void) {
   if (emax/emin > 10.0) {
     emin = log(emin);
     emax = log(0.5*emax);
-    rate_args.elog = 1;
+    _tbr_elog = 1;
   } else {
     emax = 0.5*emax;
-    rate_args.elog = 0;
+    _tbr_elog = 0;
   }
   
   de = (emax - emin)/(N3BRI-1);
-  rate_args.eg[0] = emin;
-  rate_args.fg[0] = 0.0;
+  _tbr_eg[0] = emin;
+  _tbr_fg[0] = 0.0;
   for (i = 1; i < N3BRI; i++) {
-    rate_args.eg[i] = rate_args.eg[i-1] + de;
+    _tbr_eg[i] = _tbr_eg[i-1] + de;
   }
   y[0] = 0.0;
   
   c = DLOGAM(2.0*(gamma3b+1.0)) - 2.0*DLOGAM(gamma3b+1.0);
   c = exp(c);
   for (i = 1; i < N3BRI; i++) {
-    x = rate_args.eg[i];
-    if (rate_args.elog) x = exp(x);
+    x = _tbr_eg[i];
+    if (_tbr_elog) x = exp(x);
     for (j = 1; j <= i; j++) {
-      t = rate_args.eg[j];
-      if (rate_args.elog) t = exp(t);
+      t = _tbr_eg[j];
+      if (_tbr_elog) t = exp(t);
       y[j] = d->dist(t, d->params)/sqrt(t);
-      if (rate_args.elog) y[j] *= t;
+      if (_tbr_elog) y[j] *= t;
       t = 2*x - t;
       y[j] *= d->dist(t, d->params)/sqrt(t);
       t /= 2*x;
       y[j] *= c*pow(t*(1.0-t), gamma3b);
     }
-    rate_args.fg[i] = Simpson(y, 0, i)*de;
+    _tbr_fg[i] = Simpson(y, 0, i)*de;
   }  
 }
 
-static double RateIntegrand(double *e) {
+static double RateIntegrand(double e, void *p) {
+  RATE_ARGS *ra = (RATE_ARGS *) p;
   double a, b, x;
-  double p = 1.46366E-12; /* (h^2/2m)^1.5/(4*pi) cm^3*eV^1.5 */
+  double c = 1.46366E-12; /* (h^2/2m)^1.5/(4*pi) cm^3*eV^1.5 */
 
-  if (rate_args.xlog) {
-    x = exp(*e);
+  if (ra->xlog) {
+    x = exp(e);
   } else {
-    x = *e;
+    x = e;
   }
 
-  if (rate_args.type != -RT_CI) {
-    a = rate_args.d->dist(x, rate_args.d->params);
+  if (ra->type != -RT_CI) {
+    a = ra->d->dist(x, ra->d->params);
   } else {
-    if (x > rate_args.eth) {
-      b = 0.5*(x - rate_args.eth);
-      if (rate_args.elog) b = log(b);
-      if (b < rate_args.eg[0]) a = rate_args.fg[0];
-      else if (b > rate_args.eg[N3BRI-1]) a = rate_args.fg[N3BRI-1];
+    if (x > ra->eth) {
+      b = 0.5*(x - ra->eth);
+      if (_tbr_elog) b = log(b);
+      if (b < _tbr_eg[0]) a = _tbr_fg[0];
+      else if (b > _tbr_eg[N3BRI-1]) a = _tbr_fg[N3BRI-1];
       else {
-	UVIP3P(3, N3BRI, rate_args.eg, rate_args.fg, 1, &b, &a);
-	a *= 2.0*p*sqrt(x)/(x-rate_args.eth);
+	UVIP3P(3, N3BRI, _tbr_eg, _tbr_fg, 1, &b, &a);
+	a *= 2.0*c*sqrt(x)/(x-ra->eth);
 	a *= VelocityFromE(x, -1.0)/VelocityFromE(x, 1.0);
       }
     } else {
       a = 0.0;
     }
   }
-  b = rate_args.Rate1E(x, rate_args.eth, rate_args.np, rate_args.params);
-  if (rate_args.xlog) {
+  b = ra->Rate1E(x, ra->eth, ra->np, ra->params);
+  if (ra->xlog) {
     x = x*a*b;
   } else {
     x = a*b;
@@ -262,16 +264,16 @@ static double RateIntegrand(double *e) {
   return x;
 }
 
-/* provide fortran access with cfortran.h */
-FCALLSCFUN1(DOUBLE, RateIntegrand, RATEINTEGRAND, rateintegrand, PDOUBLE)
-	    
 double IntegrateRate(int idist, double eth, double bound, 
 		     int np, void *params, int i0, int f0, int type, 
 		     double (*Rate1E)(double, double, int, void *)) { 
+  RATE_ARGS ra;
   double result;
-  int neval, ier, limit, lenw, last, n, ix, iy;
+  int neval, ier, n, ix, iy;
   double epsabs, epsrel, abserr;
   double a, b, a0, b0, r0, *eg;
+  int iwork[QUAD_LIMIT+1];
+  double dwork[4*(QUAD_LIMIT+1)];
 
   if (_maxwell_gauss && idist == 0 && iedist == 0) {
     const double maxwell_const = 1.12837967;
@@ -295,60 +297,56 @@ double IntegrateRate(int idist, double eth, double bound,
   epsabs = rate_epsabs;
   epsrel = rate_epsrel;
 
-  limit = QUAD_LIMIT;
-  lenw = 4*limit;
-  
-  rate_args.Rate1E = Rate1E;
-  if (idist == 0) rate_args.d = ele_dist + iedist;
-  else if (idist == 1) rate_args.d = pho_dist + ipdist;
-  else rate_args.d = cxt_dist + ixdist;
-  rate_args.eth = eth;
-  rate_args.np = np;
-  rate_args.params = params;
-  rate_args.i = i0;
-  rate_args.f = f0;
-  rate_args.type = type;
-  rate_args.xlog = rate_args.d->xlog;
+  ra.Rate1E = Rate1E;
+  if (idist == 0) ra.d = ele_dist + iedist;
+  else if (idist == 1) ra.d = pho_dist + ipdist;
+  else ra.d = cxt_dist + ixdist;
+  ra.eth = eth;
+  ra.np = np;
+  ra.params = params;
+  ra.i = i0;
+  ra.f = f0;
+  ra.type = type;
+  ra.xlog = ra.d->xlog;
   
   if ((idist == 0 && iedist == MAX_DIST-1) ||
       (idist == 1 && ipdist == MAX_DIST-1)) {
-    n = rate_args.d->params[0];
-    ix = rate_args.d->params[1];
-    iy = rate_args.d->params[2];
-    eg = &(rate_args.d->params[3]);
+    n = ra.d->params[0];
+    ix = ra.d->params[1];
+    iy = ra.d->params[2];
+    eg = &(ra.d->params[3]);
     a = eg[0];
     b = eg[n-1];
-    rate_args.xlog = ix;
+    ra.xlog = ix;
   } else {
-    n = rate_args.d->nparams;  
-    b = rate_args.d->params[n-1];
-    a = rate_args.d->params[n-2];    
-    if (rate_args.xlog < 0) {
+    n = ra.d->nparams;  
+    b = ra.d->params[n-1];
+    a = ra.d->params[n-2];    
+    if (ra.xlog < 0) {
       if (b/a > 10) {
-	rate_args.xlog = 1;
+	ra.xlog = 1;
 	a = log(a);
 	b = log(b);
       } else {
-	rate_args.xlog = 0;
+	ra.xlog = 0;
       }
     }
   }
   
-  if (rate_args.xlog) {
+  if (ra.xlog) {
     bound = log(bound);
   }
   if (bound > a) a = bound;
   if (b <= a) return 0.0;
-  if (idist == 0 && iedist == 0 && rate_args.xlog == 0) {
-    a0 = rate_args.d->params[0];
+  if (idist == 0 && iedist == 0 && ra.xlog == 0) {
+    a0 = ra.d->params[0];
     b0 = 5.0*a0;
     a0 = a;
     if (b < b0) b0 = b;
     r0 = 0.0;
     if (b0 > a0) {
-      DQAGS(C_FUNCTION(RATEINTEGRAND, rateintegrand), 
-	    a0, b0, epsabs, epsrel, &result, 
-	    &abserr, &neval, &ier, limit, lenw, &last, _iwork, _dwork);
+      ier = QuadAGS(RateIntegrand, &ra, a0, b0, epsabs, epsrel,
+		    &result, &abserr, &neval, QUAD_LIMIT, iwork, dwork);
       r0 += result;
       if (abserr > epsabs && abserr > r0*epsrel) {
 	if (ier != 0 && rate_iprint) {
@@ -356,7 +354,7 @@ double IntegrateRate(int idist, double eth, double bound,
 		  "IntegrateRate Error0: %d %d %10.3E %10.3E %10.3E %10.3E\n", 
 		  ier, neval, a0, b0, result, abserr);
 	  MPrintf(-1, "%6d %6d %2d Eth = %10.3E\n", 
-		  rate_args.i, rate_args.f, type, eth);
+		  ra.i, ra.f, type, eth);
 	  Abort(1);
 	}
       }
@@ -366,9 +364,8 @@ double IntegrateRate(int idist, double eth, double bound,
       b0 = a0;
     }
     if (b > b0) {
-      DQAGS(C_FUNCTION(RATEINTEGRAND, rateintegrand), 
-	    b0, b, epsabs, epsrel, &result, 
-	    &abserr, &neval, &ier, limit, lenw, &last, _iwork, _dwork);
+      ier = QuadAGS(RateIntegrand, &ra, b0, b, epsabs, epsrel,
+		    &result, &abserr, &neval, QUAD_LIMIT, iwork, dwork);
       r0 += result;
       if (abserr > epsabs && abserr > r0*epsrel) {
 	if (ier != 0 && rate_iprint) {
@@ -376,7 +373,7 @@ double IntegrateRate(int idist, double eth, double bound,
 		  "IntegrateRate Error1: %d %d %10.3E %10.3E %10.3E %10.3E\n", 
 		  ier, neval, b0, b, result, abserr);
 	  MPrintf(-1, "%6d %6d %2d Eth = %10.3E\n", 
-		  rate_args.i, rate_args.f, type, eth);
+		  ra.i, ra.f, type, eth);
 	  Abort(1);
 	}
       }
@@ -384,9 +381,8 @@ double IntegrateRate(int idist, double eth, double bound,
     if (r0 < 0.0) r0 = 0.0;
     return r0;
   } else {
-    DQAGS(C_FUNCTION(RATEINTEGRAND, rateintegrand), 
-	  a, b, epsabs, epsrel, &result, 
-	  &abserr, &neval, &ier, limit, lenw, &last, _iwork, _dwork);
+    ier = QuadAGS(RateIntegrand, &ra, a, b, epsabs, epsrel,
+		  &result, &abserr, &neval, QUAD_LIMIT, iwork, dwork);
     r0 = result;
     if (abserr > epsabs && abserr > r0*epsrel) {
       if (ier != 0 && rate_iprint) {
@@ -394,7 +390,7 @@ double IntegrateRate(int idist, double eth, double bound,
 		"IntegrateRate Error2: %d %d %10.3E %10.3E %10.3E %10.3E\n", 
 		ier, neval, a, b, result, abserr);
 	MPrintf(-1, "%6d %6d %2d Eth = %10.3E\n", 
-		rate_args.i, rate_args.f, type, eth);
+		ra.i, ra.f, type, eth);
 	Abort(1);
       }
     }
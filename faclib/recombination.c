@@ -153,11 +153,19 @@ int SetAICut(double c) {
 }
 
 int SetRRTEGrid(int n, double emin, double emax) {
+  if (n > MAXNTE) {
+    printf("Max # of grid points reached \n");
+    return -1;
+  }
   n_tegrid = SetTEGrid(tegrid, log_te, n, emin, emax);
   return n_tegrid;
 }
 
 int SetRRTEGridDetail(int n, double *x) {
+  if (n > MAXNTE) {
+    printf("Max # of grid points reached \n");
+    return -1;
+  }
   n_tegrid = SetTEGridDetail(tegrid, log_te, n, x);
   return n_tegrid;
 }
@@ -2692,6 +2700,9 @@ int SaveAI(int nlow, int *low, int nup, int *up, char *fn,
 	  ((double)radt.radial_1e)/CLOCKS_PER_SEC,
 	  ((double)radt.radial_slater)/CLOCKS_PER_SEC,
 	  ((double)radt.radial_2e)/CLOCKS_PER_SEC);
+  fprintf(perform_log, "Yk: %6.1E, RPowTable: %ld, RPowCall: %ld\n",
+	  ((double)radt.radial_yk)/CLOCKS_PER_SEC,
+	  radt.nrpow_table, radt.nrpow_pow);
 
   fprintf(perform_log, "\n");
 #endif /* PERFORM_STATISTICS */
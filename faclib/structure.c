@@ -58,6 +58,7 @@ static int angz_dim, angz_dim2;
 static ANGZ_DATUM *angz_array;
 static ANGZ_DATUM *angzxz_array;
 static ANGZ_DATUM *angmz_array;
+static int angz_memo = 0;
 static ANGULAR_FROZEN ang_frozen;
 
 static int ncorrections = 0;
@@ -84,6 +85,34 @@ static double diag_bcut = 5e-2;
 static int diag_nzm = 100;
 static int diag_nbm = 32;
 static double diag_bignore = 0.25;
+static int davidson_nlev = 0;
+static int davidson_dmin = 1000;
+static int davidson_nblock = 0;
+static int davidson_mmax = 0;
+static int davidson_maxiter = 200;
+static double davidson_tol = 1e-6;
+static int full_mode = 0;
+static int full_dmin = 200;
+static int full_nlev = 0;
+static double full_ewin = 0.0;
+static int sparse_mode = 0;
+static int sparse_dmin = 200;
+static int ham_block = 1;
+static int pdiag_mode = 0;
+static int pdiag_dmin = 2000;
+static int pdiag_nb = 64;
+static int _dist_ham = 0;
+static char _ham_ckpt[1024] = "";
+static int sched_mode = 2;
+static int incr_mode = 0;
+static unsigned long long _incr_hash = 0;
+static int _diag_mt = 0;
+#if USE_MPI == 1 && defined(USE_SCALAPACK)
+static int _blacs_ctxt = -1;
+static int _blacs_ctxt0 = -1;
+static int _blacs_nprow, _blacs_npcol, _blacs_myrow, _blacs_mycol;
+#endif
+static int _partial_diag = 0;
 static int full_name = 0;
 
 static int sym_pp = -1;
@@ -599,15 +628,470 @@ int ConstructHamiltonEB(int n, int *ilev) {
   return -1;
 }
 
+/*
+** number of electrons to be moved to turn the configuration cj into
+** ci, or -1 if the two have different numbers of electrons. the
+** shells of both are in the order given by CompareShellInvert.
+*/
+static int ConfigExcitation(CONFIG *ci, CONFIG *cj) {
+  int i, j, c, d, di, dj;
+
+  i = 0;
+  j = 0;
+  di = 0;
+  dj = 0;
+  while (i < ci->n_shells || j < cj->n_shells) {
+    if (i == ci->n_shells) c = -1;
+    else if (j == cj->n_shells) c = 1;
+    else c = CompareShell(ci->shells+i, cj->shells+j);
+    if (c > 0) {
+      di += ci->shells[i].nq;
+      i++;
+    } else if (c < 0) {
+      dj += cj->shells[j].nq;
+      j++;
+    } else {
+      d = ci->shells[i].nq - cj->shells[j].nq;
+      if (d > 0) di += d;
+      else dj -= d;
+      i++;
+      j++;
+    }
+  }
+  if (di != dj) return -1;
+  return di;
+}
+
+static size_t ConfigPairIndex(int a, int b) {
+  if (a > b) return ((size_t)a*(a+1))/2 + b;
+  return ((size_t)b*(b+1))/2 + a;
+}
+
+static int ConfigPairInteract(unsigned char *g, int a, int b) {
+  size_t k;
+
+  k = ConfigPairIndex(a, b);
+  return (g[k>>3] >> (k&7)) & 1;
+}
+
+/*
+** the configurations of the hamiltonian basis. cid[i] is set to the
+** label of the configuration of h->basis[i], consecutive states of a
+** configuration sharing one label. the labels of the states below and
+** above h->dim are distinct. NULL is returned if some basis state is
+** not built from a configuration.
+*/
+static CONFIG **BasisConfigs(SYMMETRY *sym, HAMILTON *h, int *cid, int *nc) {
+  int i, n;
+  STATE *s;
+  CONFIG **cs, *c;
+
+  cs = malloc(sizeof(CONFIG *)*h->n_basis);
+  n = 0;
+  for (i = 0; i < h->n_basis; i++) {
+    s = (STATE *) ArrayGet(&(sym->states), h->basis[i]);
+    if (s->kgroup < 0) {
+      free(cs);
+      return NULL;
+    }
+    c = GetConfig(s);
+    if (n == 0 || c != cs[n-1] || i == h->dim) {
+      cs[n++] = c;
+    }
+    cid[i] = n-1;
+  }
+  *nc = n;
+  return cs;
+}
+
+/*
+** the configuration-pair interaction graph of the basis configurations
+** cs. the bits of the returned array mark the pairs which may have
+** nonzero hamiltonian matrix elements between their states, i.e.,
+** those differing by at most two electrons and allowed by ci_level.
+** np returns the number of the interacting pairs.
+*/
+static unsigned char *ConfigInteractGraph(int n, CONFIG **cs, long *np) {
+  int i, j, d;
+  unsigned char *g;
+  size_t k;
+
+  k = ((size_t)n*(n+1))/2;
+  g = calloc((k>>3)+1, sizeof(unsigned char));
+  *np = 0;
+  for (j = 0; j < n; j++) {
+    if (cs[j]->n_shells == 0) continue;
+    for (i = 0; i <= j; i++) {
+      if (cs[i]->n_shells == 0) continue;
+      switch (ci_level) {
+      case 1:
+	if (cs[i] != cs[j]) continue;
+      case 2:
+	if (cs[i]->nnrs != cs[j]->nnrs) continue;
+	if (memcmp(cs[i]->nrs, cs[j]->nrs, sizeof(int)*cs[i]->nnrs)) continue;
+      case 3:
+	if (cs[i]->igroup != cs[j]->igroup) continue;
+      }
+      d = ConfigExcitation(cs[i], cs[j]);
+      if (d < 0 || d > 2) continue;
+      k = ConfigPairIndex(i, j);
+      g[k>>3] |= 1 << (k&7);
+      (*np)++;
+    }
+  }
+  return g;
+}
+
+static void FreeHamiltonCSR(HAMILTON *h) {
+  if (h->csr_p) free(h->csr_p);
+  if (h->csr_i) free(h->csr_i);
+  if (h->csr_a) free(h->csr_a);
+  h->csr_p = NULL;
+  h->csr_i = NULL;
+  h->csr_a = NULL;
+  h->nnz = 0;
+}
+
+/*
+** store the nonzero elements of the dim x dim block of the packed
+** hamiltonian in compressed rows of its lower triangle, row j holding
+** the column j of the packed upper triangle.
+*/
+static void BuildHamiltonCSR(HAMILTON *h) {
+  int i, j, n;
+  size_t k, m, t;
+  double *ap;
+
+  FreeHamiltonCSR(h);
+  n = h->dim;
+  t = ((size_t)n*(n+1))/2;
+  k = 0;
+  for (m = 0; m < t; m++) {
+    if (h->hamilton[m]) k++;
+  }
+  h->csr_p = malloc(sizeof(size_t)*(n+1));
+  h->csr_i = malloc(sizeof(int)*(k>0?k:1));
+  h->csr_a = malloc(sizeof(double)*(k>0?k:1));
+  k = 0;
+  ap = h->hamilton;
+  for (j = 0; j < n; j++) {
+    h->csr_p[j] = k;
+    for (i = 0; i <= j; i++) {
+      if (ap[i]) {
+	h->csr_i[k] = i;
+	h->csr_a[k] = ap[i];
+	k++;
+      }
+    }
+    ap += j+1;
+  }
+  h->csr_p[n] = k;
+  h->nnz = k;
+}
+
+/*
+** fill the block of the packed hamiltonian between the basis states
+** i0..i1-1 and j0..j1-1 of two configurations, with i0 <= j0. the
+** off-diagonal elements between the states at or above iz are zero.
+*/
+static void HamiltonConfigBlock(int isym, HAMILTON *h, int i0, int i1,
+				int j0, int j1, int iz, double *x) {
+  int i, j, t, ni;
+
+  ni = i1 - i0;
+  if (i1 <= iz || j1 <= iz) {
+    HamiltonElementBlock(isym, ni, h->basis+i0, j1-j0, h->basis+j0,
+			 i0 == j0, x);
+    for (j = j0; j < j1; j++) {
+      t = j*(j+1)/2;
+      for (i = i0; i < i1 && i <= j; i++) {
+	h->hamilton[i+t] = x[(i-i0)+(j-j0)*ni];
+      }
+    }
+    return;
+  }
+  for (j = j0; j < j1; j++) {
+    t = j*(j+1)/2;
+    for (i = i0; i < i1 && i <= j; i++) {
+      if (i != j && i >= iz && j >= iz) continue;
+      h->hamilton[i+t] = HamiltonElement(isym, h->basis[i], h->basis[j]);
+    }
+  }
+}
+
+/*
+** number of the lowest of the n sorted eigenvalues d that are kept,
+** at most nlev, and within ewin of the lowest one.
+*/
+static int PartialLevels(int n, double *d, int nlev, double ewin) {
+  int k;
+
+  k = n;
+  if (nlev > 0 && nlev < k) k = nlev;
+  if (ewin > 0) {
+    while (k > 1 && d[k-1]-d[0] > ewin) k--;
+  }
+  return k;
+}
+
+#if USE_MPI == 1 && defined(USE_SCALAPACK)
+/*
+** the nprow x npcol process grid of the distributed hamiltonians, with
+** nprow the largest divisor of nproc not above its square root, and
+** the 1x1 grid on rank 0 that receives the mixing coefficients.
+*/
+static int DistGrid(void) {
+  char order[] = "R";
+  int np, nr;
+
+  if (_blacs_ctxt >= 0) return _blacs_ctxt;
+  np = NProcMPI();
+  for (nr = (int) sqrt((double) np); nr > 1; nr--) {
+    if (np%nr == 0) break;
+  }
+  BLACS_GET(-1, 0, &_blacs_ctxt);
+  BLACS_GRIDINIT(&_blacs_ctxt, order, nr, np/nr);
+  BLACS_GRIDINFO(_blacs_ctxt, &_blacs_nprow, &_blacs_npcol,
+		 &_blacs_myrow, &_blacs_mycol);
+  BLACS_GET(-1, 0, &_blacs_ctxt0);
+  BLACS_GRIDINIT(&_blacs_ctxt0, order, 1, 1);
+  return _blacs_ctxt;
+}
+
+/*
+** allocate the local tiles of the dim x dim hamiltonian distributed
+** block-cyclically in pdiag_nb x pdiag_nb blocks over the grid.
+*/
+static int AllocDistHam(HAMILTON *h) {
+  int ctxt, lld, info;
+  size_t t;
+
+  ctxt = DistGrid();
+  h->pmloc = NUMROC(h->dim, pdiag_nb, _blacs_myrow, 0, _blacs_nprow);
+  h->pnloc = NUMROC(h->dim, pdiag_nb, _blacs_mycol, 0, _blacs_npcol);
+  lld = Max(1, h->pmloc);
+  DESCINIT(h->pdesc, h->dim, h->dim, pdiag_nb, pdiag_nb, 0, 0,
+	   ctxt, lld, &info);
+  if (info) {
+    MPrintf(-1, "DESCINIT ERROR: %d %d %d\n", h->pj, h->dim, info);
+    return -1;
+  }
+  t = (size_t)lld*h->pnloc;
+  if (h->pham) free(h->pham);
+  h->pham = (double *) malloc(sizeof(double)*(t>0?t:1));
+  if (!(h->pham)) return -1;
+  return 0;
+}
+
+/*
+** evaluate the upper triangle of the distributed hamiltonian on the
+** local tiles. the local row or column l on the grid row or column p
+** of np is the global index ((l/nb)*np+p)*nb + l%nb. the off-diagonal
+** elements between the states at or above iz, and between the
+** configurations not connected in the graph cg, are zero.
+*/
+static void ConstructHamiltonDist(int isym, HAMILTON *h, int iz,
+				  unsigned char *cg, int *cid) {
+  int i, j, li, lj, nb, lld;
+  double *a;
+
+  nb = h->pdesc[4];
+  lld = h->pdesc[8];
+  for (lj = 0; lj < h->pnloc; lj++) {
+    j = ((lj/nb)*_blacs_npcol + _blacs_mycol)*nb + lj%nb;
+    a = h->pham + (size_t)lj*lld;
+    for (li = 0; li < h->pmloc; li++) {
+      i = ((li/nb)*_blacs_nprow + _blacs_myrow)*nb + li%nb;
+      if (i > j) {
+	a[li] = 0.0;
+      } else if (i != j && i >= iz && j >= iz) {
+	a[li] = 0.0;
+      } else if (cg && !ConfigPairInteract(cg, cid[i], cid[j])) {
+	a[li] = 0.0;
+      } else {
+	a[li] = HamiltonElement(isym, h->basis[i], h->basis[j]);
+      }
+    }
+  }
+}
+
+/*
+** diagonalize the distributed hamiltonian with PDSYEVD, collectively on
+** all ranks. the mixing coefficients of the kept levels, full_nlev and
+** full_ewin, are gathered to rank 0 only, which writes the levels;
+** the other ranks keep the eigenvalues. the local tiles are released.
+*/
+static int DiagonalizeHamiltonDist(HAMILTON *h) {
+  char jobz[] = "V";
+  char uplo[] = "U";
+  int n, i, k, lw, liw, info, descb[9];
+  int *iwork, iq;
+  size_t t;
+  double *w, *z, *work, q;
+
+  n = h->dim;
+  t = (size_t)h->pdesc[8]*h->pnloc;
+  w = (double *) malloc(sizeof(double)*n);
+  z = (double *) malloc(sizeof(double)*(t>0?t:1));
+  PDSYEVD(jobz, uplo, n, h->pham, 1, 1, h->pdesc, w, z, 1, 1, h->pdesc,
+	  &q, -1, &iq, -1, &info);
+  lw = (int) q;
+  liw = iq;
+  work = (double *) malloc(sizeof(double)*lw);
+  iwork = (int *) malloc(sizeof(int)*liw);
+  PDSYEVD(jobz, uplo, n, h->pham, 1, 1, h->pdesc, w, z, 1, 1, h->pdesc,
+	  work, lw, iwork, liw, &info);
+  free(work);
+  free(iwork);
+  free(h->pham);
+  h->pham = NULL;
+  if (info) {
+    MPrintf(0, "PDSYEVD ERROR: %d %d %d\n", h->pj, n, info);
+    free(w);
+    free(z);
+    return -1;
+  }
+  k = PartialLevels(n, w, full_nlev, full_ewin);
+  for (i = 0; i < 9; i++) descb[i] = 0;
+  descb[1] = -1;
+  if (MyRankMPI() == 0) {
+    h->msize = n + (size_t)n*k;
+    if (h->msize > h->msize0) {
+      free(h->mixing);
+      h->msize0 = h->msize;
+      h->mixing = (double *) malloc(sizeof(double)*h->msize);
+    }
+    DESCINIT(descb, n, k, n, k, 0, 0, _blacs_ctxt0, n, &info);
+  }
+  PDGEMR2D(n, k, z, 1, 1, h->pdesc, h->mixing+n, 1, 1, descb,
+	   h->pdesc[1]);
+  for (i = 0; i < n; i++) {
+    h->mixing[i] = i < k? w[i] : 0.0;
+  }
+  h->nlev = k;
+  h->diag_emin = w[0];
+  free(w);
+  free(z);
+  return 0;
+}
+#endif
+
+/*
+** in the incremental mode, the packed hamiltonian and the lowest
+** eigenvectors of a solved symmetry are retained. when the symmetry
+** is solved again with more configurations, the elements between the
+** unchanged states are copied instead of evaluated, and the davidson
+** iteration starts from the previous eigenvectors. the retained data
+** is only used with the same potential and ci level.
+*/
+static unsigned long long IncrHash(void) {
+  unsigned long long h;
+
+  h = PotentialHash();
+  h = HashBytes(h, &ci_level, sizeof(int));
+  return h;
+}
+
+static void FreeRetainedHamilton(HAMILTON *h) {
+  if (h->rbs) free(h->rbs);
+  if (h->rst) free(h->rst);
+  if (h->rham) free(h->rham);
+  if (h->rmix) free(h->rmix);
+  if (h->rmap) free(h->rmap);
+  h->rdim = 0;
+  h->rnlev = 0;
+  h->rbs = NULL;
+  h->rst = NULL;
+  h->rham = NULL;
+  h->rmix = NULL;
+  h->rmap = NULL;
+  h->rhash = 0;
+}
+
+static int IncrEligible(HAMILTON *h, int ip) {
+  return (incr_mode && ip == 0 && ci_level != -1 && h->dim > 0 &&
+	  h->n_basis == h->dim && h->hsp == NULL && h->heff == NULL &&
+	  h->pdim == 0);
+}
+
+/*
+** h->rmap[i] is the index of the basis state i in the retained basis,
+** or -1 if the state is new. the bases are both in increasing order
+** of the states. returns the number of the retained states.
+*/
+static int MapRetainedBasis(SYMMETRY *sym, HAMILTON *h, int m) {
+  STATE *s;
+  int i, t, n;
+
+  if (h->rmap) {
+    free(h->rmap);
+    h->rmap = NULL;
+  }
+  if (!m || h->rdim <= 0 || h->rhash != _incr_hash) return 0;
+  h->rmap = malloc(sizeof(int)*h->dim);
+  n = 0;
+  t = 0;
+  for (i = 0; i < h->dim; i++) {
+    h->rmap[i] = -1;
+    while (t < h->rdim && h->rbs[t] < h->basis[i]) t++;
+    if (t == h->rdim || h->rbs[t] != h->basis[i]) continue;
+    s = (STATE *) ArrayGet(&(sym->states), h->basis[i]);
+    if (memcmp(s, h->rst+t, sizeof(STATE)) != 0) continue;
+    h->rmap[i] = t;
+    n++;
+  }
+  if (n == 0) {
+    free(h->rmap);
+    h->rmap = NULL;
+  }
+  return n;
+}
+
+/*
+** retain the basis, the hamiltonian ham copied before the
+** diagonalization, and the lowest davidson_nlev eigenvectors of h.
+*/
+static void RetainHamilton(HAMILTON *h, double *ham) {
+  SYMMETRY *sym;
+  STATE *s;
+  size_t t;
+  int i, n;
+
+  FreeRetainedHamilton(h);
+  sym = GetSymmetry(h->pj);
+  n = h->dim;
+  h->rdim = n;
+  h->rhash = _incr_hash;
+  h->rham = ham;
+  h->rbs = malloc(sizeof(int)*n);
+  h->rst = malloc(sizeof(STATE)*n);
+  memcpy(h->rbs, h->basis, sizeof(int)*n);
+  for (i = 0; i < n; i++) {
+    s = (STATE *) ArrayGet(&(sym->states), h->basis[i]);
+    memcpy(h->rst+i, s, sizeof(STATE));
+  }
+  h->rnlev = Min(h->nlev, davidson_nlev);
+  if (h->rnlev > 0) {
+    t = (size_t)n*h->rnlev;
+    h->rmix = malloc(sizeof(double)*t);
+    memcpy(h->rmix, h->mixing+n, sizeof(double)*t);
+  }
+}
+
 int ConstructHamilton(int isym, int k0, int k, int *kg,
 		      int kp, int *kgp, int md) {
-  int i, j, j0, t, ti, jp, jd, m1, m2, m3, ip;
+  int i, j, j0, t, ti, jp, jd, m1, m2, m3, ip, nr;
   HAMILTON *h;
   SHAMILTON *hs;
   ARRAY *st;
   STATE *s;
   SYMMETRY *sym;
   double r;
+  unsigned char *cg;
+  char *co;
+  CONFIG **cs;
+  int *cid, *cb, nc, nb, mb, iz;
+  long ncp;
 #if (FAC_DEBUG >= DEBUG_STRUCTURE)
   char name[LEVEL_NAME_LEN];
 #endif
@@ -674,6 +1158,13 @@ int ConstructHamilton(int isym, int k0, int k, int *kg,
 	jp = kp;
       }
     }
+    h->pdim = 0;
+#if USE_MPI == 1 && defined(USE_SCALAPACK)
+    if (_dist_ham && pdiag_mode > 0 && ip == 0 && k0 > 0 && jp == 0 &&
+	diag_mode == 0 && NProcMPI() > 1 && j >= pdiag_dmin) {
+      h->pdim = j;
+    }
+#endif
     if (AllocHamMem(h, j, jp+j) == -1) goto ERROR;
     h->ndim = jd;
     if (k0 > 0) {
@@ -706,17 +1197,108 @@ int ConstructHamilton(int isym, int k0, int k, int *kg,
       }
     }
   }
-  if (m2 && !h->hsp) {
+#if USE_MPI == 1 && defined(USE_SCALAPACK)
+  if (m2 && h->pdim > 0) {
+    cg = NULL;
+    cid = malloc(sizeof(int)*h->n_basis);
+    cs = BasisConfigs(sym, h, cid, &nc);
+    if (cs) {
+      if (sparse_mode > 0 && h->dim >= sparse_dmin) {
+	cg = ConfigInteractGraph(nc, cs, &ncp);
+      }
+      free(cs);
+    }
+    iz = h->dim;
+    if (perturb_setzero == 2 && j0 < iz) iz = j0;
+    ConstructHamiltonDist(isym, h, iz, cg, cid);
+    if (cg) free(cg);
+    free(cid);
+  }
+#endif
+  if (m2 && !h->hsp && h->pdim == 0) {
     for (j = 0; j < h->hsize; j++) {
       h->hamilton[j] = 0;
     }
+    FreeHamiltonCSR(h);
+    /* the elements are evaluated in blocks of configuration pairs,
+       skipping the pairs which cannot interact in the sparse mode */
+    cg = NULL;
+    cb = NULL;
+    nb = 0;
+    mb = 0;
+    iz = 0;
+    cid = malloc(sizeof(int)*h->n_basis);
+    cs = BasisConfigs(sym, h, cid, &nc);
+    if (cs) {
+      if (sparse_mode > 0 && h->dim >= sparse_dmin) {
+	cg = ConfigInteractGraph(nc, cs, &ncp);
+      }
+      if (ham_block && m1 && k0 > 0 && h->dim > 0) {
+	nb = cid[h->dim-1]+1;
+	cb = malloc(sizeof(int)*(nb+1));
+	for (i = 0; i < h->dim; i++) {
+	  if (i == 0 || cid[i] != cid[i-1]) cb[cid[i]] = i;
+	}
+	cb[nb] = h->dim;
+	for (i = 0; i < nb; i++) {
+	  if (cb[i+1]-cb[i] > mb) mb = cb[i+1]-cb[i];
+	}
+	iz = jd;
+	if (perturb_setzero == 2 && j0 < iz) iz = j0;
+      }
+      free(cs);
+    }
+    /* the elements between the retained states are copied, once
+       only under mpi, where the partial matrices are summed */
+    nr = MapRetainedBasis(sym, h, incr_mode && ip == 0 && k0 > 0 && jp == 0);
+    co = NULL;
+    if (nr > 0) {
+      if (MyRankMPI() == 0) {
+	for (j = 0; j < h->dim; j++) {
+	  if (h->rmap[j] < 0) continue;
+	  t = j*(j+1)/2;
+	  ti = h->rmap[j]*(h->rmap[j]+1)/2;
+	  for (i = 0; i <= j; i++) {
+	    if (h->rmap[i] < 0) continue;
+	    h->hamilton[i+t] = h->rham[h->rmap[i]+ti];
+	  }
+	}
+      }
+      if (cb) {
+	co = malloc(sizeof(char)*nb);
+	for (i = 0; i < nb; i++) {
+	  co[i] = 1;
+	  for (j = cb[i]; j < cb[i+1]; j++) {
+	    if (h->rmap[j] < 0) {
+	      co[i] = 0;
+	      break;
+	    }
+	  }
+	}
+      }
+      MPrintf(0, "incremental hamilton: %3d %6d %6d\n", isym, h->dim, nr);
+    }
     ResetWidMPI();
 #pragma omp parallel default(shared) private(i,j,t,r)
     {
       int mr = MPIRank(NULL);
       int odim = h->odim;
       int ot = ((odim+1)*odim)/2;
-      for (j = 0; j < h->dim; j++) {
+      if (cb) {
+	int ib, jb;
+	double *xb = malloc(sizeof(double)*mb*mb);
+	for (jb = 0; jb < nb; jb++) {
+	  if (SkipMPI()) continue;
+	  for (ib = 0; ib <= jb; ib++) {
+	    if (co && co[ib] && co[jb]) continue;
+	    if (cg && !ConfigPairInteract(cg, ib, jb)) continue;
+	    HamiltonConfigBlock(isym, h, cb[ib], cb[ib+1], cb[jb], cb[jb+1],
+				iz, xb);
+	  }
+	}
+	free(xb);
+      }
+      for (j = 0; cb == NULL && j < h->dim; j++) {
 	int skip;
 	skip = SkipMPI();
 	if (skip) continue;
@@ -730,6 +1312,7 @@ int ConstructHamilton(int isym, int k0, int k, int *kg,
 	  }
 	}
 	for (i = 0; i <= j; i++) {
+	  if (nr > 0 && h->rmap[i] >= 0 && h->rmap[j] >= 0) continue;
 	  if (i != j && i >= jd && j >= jd) r = 0;
 	  else if (k0 < 0) {
 	    if (ip == 1) {
@@ -753,6 +1336,8 @@ int ConstructHamilton(int isym, int k0, int k, int *kg,
 	    }
 	  } else if (perturb_setzero == 2 && i != j && i >= j0 && j >= j0) {
 	    r = 0.0;
+	  } else if (cg && !ConfigPairInteract(cg, cid[i], cid[j])) {
+	    r = 0.0;
 	  } else {
 	    r = HamiltonElement(isym, h->basis[i], h->basis[j]);
 	  }
@@ -780,6 +1365,8 @@ int ConstructHamilton(int isym, int k0, int k, int *kg,
 	      } else {
 		r = h->oham[ot+i*(h->onbs-h->odim)+(kgp[j-h->dim]-h->odim)];
 	      }
+	    } else if (cg && !ConfigPairInteract(cg, cid[i], cid[j])) {
+	      r = 0.0;
 	    } else {
 	      r = HamiltonElement(isym, h->basis[i], h->basis[j]);
 	    }
@@ -810,6 +1397,17 @@ int ConstructHamilton(int isym, int k0, int k, int *kg,
 		    MPI_SUM, MPI_COMM_WORLD);
     }
 #endif
+    if (cg) {
+      BuildHamiltonCSR(h);
+      t = h->dim;
+      MPrintf(0, "sparse hamilton: %3d %6d %6d %10ld %12ld %12ld %8.5f\n",
+	      isym, h->dim, nc, ncp, (long) h->nnz, ((long) t*(t+1))/2,
+	      ((double) h->nnz)/(0.5*t*(t+1.0)));
+      free(cg);
+    }
+    if (cb) free(cb);
+    if (co) free(co);
+    free(cid);
   }
   if (m2 && h->hsp) {
     ConstructHamiltonBand(h, HamiltonElement);
@@ -1735,71 +2333,407 @@ void HamiltonElement1E2E(int isym, int isi, int isj, double *x1, double *x2) {
 	  s[2].nq_bra > s[2].j+1 || s[2].nq_ket > s[2].j+1) {
 	continue;
       }
-      s[3].nq_bra = s[2].nq_bra;
-      s[3].nq_ket = s[2].nq_ket;
-      r = Hamilton2E(n_shells, sbra, sket, s);
-      *x2 += r;
-#if (FAC_DEBUG >= DEBUG_STRUCTURE)
-      debug_integral(s, 2, r);
-#endif
-    }
-  } else {
-    for (i = 0; i < n_shells; i++) {
-      s[0].index = n_shells - i - 1;
-      s[1].index = s[0].index;
-      s[0].n = bra[i].n;
-      s[1].n = s[0].n;
-      s[0].kappa = bra[i].kappa;
-      s[1].kappa = s[0].kappa;
-      s[0].j = GetJ(bra+i);
-      s[1].j = s[0].j;
-      s[0].kl = GetL(bra+i);
-      s[1].kl = s[0].kl;
-      s[0].nq_bra = GetNq(bra+i);
-      s[0].nq_ket = s[0].nq_bra;
-      s[1].nq_bra = s[0].nq_bra;
-      s[1].nq_ket = s[1].nq_bra;
-      r = Hamilton1E(n_shells, sbra, sket, s);
-      *x1 += r;
-#if (FAC_DEBUG >= DEBUG_STRUCTURE)
-      debug_integral(s, 1, r);
-#endif
-      for (j = 0; j <= i; j++) {
-	s[2].nq_bra = GetNq(bra+j);
-	if (j == i && s[2].nq_bra < 2) continue;
-	s[2].nq_ket = s[2].nq_bra;
-	s[3].nq_bra = s[2].nq_bra;
-	s[3].nq_ket = s[3].nq_bra;
-	s[2].index = n_shells - j - 1;
-	s[3].index = s[2].index;
-	s[2].n = bra[j].n;
-	s[3].n = s[2].n;
-	s[2].kappa = bra[j].kappa;
-	s[3].kappa = s[2].kappa;
-	s[2].j = GetJ(bra+j);
-	s[3].j = s[2].j;
-	s[2].kl = GetL(bra+j);
-	s[3].kl = s[2].kl;
-	r = Hamilton2E(n_shells, sbra, sket, s);
-	*x2 += r;
-#if (FAC_DEBUG >= DEBUG_STRUCTURE)
-	debug_integral(s, 2, r);
-#endif
+      s[3].nq_bra = s[2].nq_bra;
+      s[3].nq_ket = s[2].nq_ket;
+      r = Hamilton2E(n_shells, sbra, sket, s);
+      *x2 += r;
+#if (FAC_DEBUG >= DEBUG_STRUCTURE)
+      debug_integral(s, 2, r);
+#endif
+    }
+  } else {
+    for (i = 0; i < n_shells; i++) {
+      s[0].index = n_shells - i - 1;
+      s[1].index = s[0].index;
+      s[0].n = bra[i].n;
+      s[1].n = s[0].n;
+      s[0].kappa = bra[i].kappa;
+      s[1].kappa = s[0].kappa;
+      s[0].j = GetJ(bra+i);
+      s[1].j = s[0].j;
+      s[0].kl = GetL(bra+i);
+      s[1].kl = s[0].kl;
+      s[0].nq_bra = GetNq(bra+i);
+      s[0].nq_ket = s[0].nq_bra;
+      s[1].nq_bra = s[0].nq_bra;
+      s[1].nq_ket = s[1].nq_bra;
+      r = Hamilton1E(n_shells, sbra, sket, s);
+      *x1 += r;
+#if (FAC_DEBUG >= DEBUG_STRUCTURE)
+      debug_integral(s, 1, r);
+#endif
+      for (j = 0; j <= i; j++) {
+	s[2].nq_bra = GetNq(bra+j);
+	if (j == i && s[2].nq_bra < 2) continue;
+	s[2].nq_ket = s[2].nq_bra;
+	s[3].nq_bra = s[2].nq_bra;
+	s[3].nq_ket = s[3].nq_bra;
+	s[2].index = n_shells - j - 1;
+	s[3].index = s[2].index;
+	s[2].n = bra[j].n;
+	s[3].n = s[2].n;
+	s[2].kappa = bra[j].kappa;
+	s[3].kappa = s[2].kappa;
+	s[2].j = GetJ(bra+j);
+	s[3].j = s[2].j;
+	s[2].kl = GetL(bra+j);
+	s[3].kl = s[2].kl;
+	r = Hamilton2E(n_shells, sbra, sket, s);
+	*x2 += r;
+#if (FAC_DEBUG >= DEBUG_STRUCTURE)
+	debug_integral(s, 2, r);
+#endif
+      }
+    }
+  }
+  /* the prefactor in the Wigner-Eckart theorem should be included in
+     the matrix element. for a scalar operator, this is [J]^{-1/2} */
+  x = sqrt(sbra[0].totalJ + 1.0);
+  if (IsOdd(phase)) x = -x;
+  *x1 /= x;
+  *x2 /= x;
+
+  if (isi == isj) {
+    *x1 += ci->delta;
+  }
+  free(sbra);
+  free(sket);
+}
+
+/*
+** a one- or two-body term of the hamiltonian between the states of a
+** pair of configurations. the interacting shells are fixed by the
+** configurations, and the radial integrals of the term are tabulated
+** on first use, so that they are evaluated once for all state pairs.
+*/
+typedef struct _HAM_TERM_ {
+  int type;
+  INTERACT_SHELL s[4];
+  int ks[4];
+  int nr;
+  double r1;
+  int nk;
+  char *ik;
+  double *sd;
+  double *se;
+} HAM_TERM;
+
+static void AddHamTerm(int *nt, HAM_TERM *t, int type, INTERACT_SHELL *s) {
+  HAM_TERM *p;
+
+  if (type == 1 && (s[0].j != s[1].j || s[0].kl != s[1].kl)) return;
+  p = t + (*nt);
+  p->type = type;
+  memcpy(p->s, s, sizeof(INTERACT_SHELL)*4);
+  if (type == 2) {
+    p->ks[0] = OrbitalIndex(s[0].n, s[0].kappa, 0.0);
+    p->ks[1] = OrbitalIndex(s[2].n, s[2].kappa, 0.0);
+    p->ks[2] = OrbitalIndex(s[1].n, s[1].kappa, 0.0);
+    p->ks[3] = OrbitalIndex(s[3].n, s[3].kappa, 0.0);
+    p->nk = Min(s[0].j+s[1].j, s[2].j+s[3].j)/2 + 1;
+  } else {
+    p->nk = 0;
+  }
+  p->nr = 0;
+  p->ik = NULL;
+  p->sd = NULL;
+  p->se = NULL;
+  (*nt)++;
+}
+
+/*
+** the list of terms in the order they are summed by
+** HamiltonElement1E2E.
+*/
+static int HamTerms(HAM_TERM *t, int n_shells, INTERACT_SHELL *s0,
+		    SHELL *bra) {
+  INTERACT_SHELL s[4];
+  int i, j, nt;
+
+  nt = 0;
+  memcpy(s, s0, sizeof(INTERACT_SHELL)*4);
+  if (s[0].index >= 0 && s[3].index >= 0) {
+    AddHamTerm(&nt, t, 2, s);
+  } else if (s[0].index >= 0) {
+    AddHamTerm(&nt, t, 1, s);
+    for (i = 0; i < n_shells; i++) {
+      s[2].index = n_shells - i - 1;
+      s[3].index = s[2].index;
+      s[2].n = bra[i].n;
+      s[3].n = s[2].n;
+      s[2].kappa = bra[i].kappa;
+      s[3].kappa = s[2].kappa;
+      s[2].j = GetJ(bra+i);
+      s[3].j = s[2].j;
+      s[2].kl = GetL(bra+i);
+      s[3].kl = s[2].kl;
+      s[2].nq_bra = GetNq(bra+i);
+      if (s[2].index == s[0].index) {
+	s[2].nq_ket = s[2].nq_bra - 1;
+      } else if (s[2].index == s[1].index) {
+	s[2].nq_ket = s[2].nq_bra + 1;
+      } else {
+	s[2].nq_ket = s[2].nq_bra;
+      }
+      if (s[2].nq_bra <= 0 || s[2].nq_ket <= 0 ||
+	  s[2].nq_bra > s[2].j+1 || s[2].nq_ket > s[2].j+1) {
+	continue;
+      }
+      s[3].nq_bra = s[2].nq_bra;
+      s[3].nq_ket = s[2].nq_ket;
+      AddHamTerm(&nt, t, 2, s);
+    }
+  } else {
+    for (i = 0; i < n_shells; i++) {
+      s[0].index = n_shells - i - 1;
+      s[1].index = s[0].index;
+      s[0].n = bra[i].n;
+      s[1].n = s[0].n;
+      s[0].kappa = bra[i].kappa;
+      s[1].kappa = s[0].kappa;
+      s[0].j = GetJ(bra+i);
+      s[1].j = s[0].j;
+      s[0].kl = GetL(bra+i);
+      s[1].kl = s[0].kl;
+      s[0].nq_bra = GetNq(bra+i);
+      s[0].nq_ket = s[0].nq_bra;
+      s[1].nq_bra = s[0].nq_bra;
+      s[1].nq_ket = s[1].nq_bra;
+      AddHamTerm(&nt, t, 1, s);
+      for (j = 0; j <= i; j++) {
+	s[2].nq_bra = GetNq(bra+j);
+	if (j == i && s[2].nq_bra < 2) continue;
+	s[2].nq_ket = s[2].nq_bra;
+	s[3].nq_bra = s[2].nq_bra;
+	s[3].nq_ket = s[3].nq_bra;
+	s[2].index = n_shells - j - 1;
+	s[3].index = s[2].index;
+	s[2].n = bra[j].n;
+	s[3].n = s[2].n;
+	s[2].kappa = bra[j].kappa;
+	s[3].kappa = s[2].kappa;
+	s[2].j = GetJ(bra+j);
+	s[3].j = s[2].j;
+	s[2].kl = GetL(bra+j);
+	s[3].kl = s[2].kl;
+	AddHamTerm(&nt, t, 2, s);
+      }
+    }
+  }
+  return nt;
+}
+
+/* the slater integrals of the multipole k of a two-body term */
+static void HamTermSlater(HAM_TERM *t, int k, double *sd, double *se) {
+  int js[4] = {0, 0, 0, 0};
+  int i;
+
+  i = k/2;
+  if (i >= t->nk) {
+    SlaterTotal(sd, se, js, t->ks, k, 0);
+    return;
+  }
+  if (t->ik == NULL) {
+    t->ik = calloc(t->nk, sizeof(char));
+    t->sd = malloc(sizeof(double)*t->nk);
+    t->se = malloc(sizeof(double)*t->nk);
+  }
+  if (se) {
+    if (!(t->ik[i] & 2)) {
+      SlaterTotal(t->sd+i, t->se+i, js, t->ks, k, 0);
+      t->ik[i] = 3;
+    }
+    *se = t->se[i];
+  } else if (!(t->ik[i] & 1)) {
+    SlaterTotal(t->sd+i, NULL, js, t->ks, k, 0);
+    t->ik[i] |= 1;
+  }
+  *sd = t->sd[i];
+}
+
+/* same as Hamilton1E, with the radial part taken from the term */
+static double HamTerm1E(int n_shells, SHELL_STATE *sbra, SHELL_STATE *sket,
+			HAM_TERM *t) {
+  int nk0, k, k1, k2;
+  int *k0;
+  double *x, z0, r0, e0, qed;
+  INTERACT_SHELL *s = t->s;
+
+  nk0 = 1;
+  k = 0;
+  k0 = &k;
+  x = &z0;
+  nk0 = AngularZ(&x, &k0, nk0, n_shells, sbra, sket, s, s+1);
+  if (fabs(z0) < EPS30) return 0.0;
+  if (!t->nr) {
+    k1 = OrbitalIndex(s[0].n, s[0].kappa, 0.0);
+    k2 = OrbitalIndex(s[1].n, s[1].kappa, 0.0);
+    ResidualPotential(&r0, k1, k2);
+    e0 = 0.0;
+    if (k1 == k2) {
+      e0 = (GetOrbital(k1))->energy;
+      r0 += e0;
+    }
+    qed = QED1E(k1, k2);
+    r0 += qed;
+    t->r1 = r0;
+    t->nr = 1;
+  }
+  z0 *= sqrt(s[0].j + 1.0);
+  return t->r1*z0;
+}
+
+/* same as Hamilton2E, with the slater integrals taken from the term */
+static double HamTerm2E(int n_shells, SHELL_STATE *sbra, SHELL_STATE *sket,
+			HAM_TERM *t) {
+  int nk0, nk, *kk, k, *kk0, i;
+  double *ang;
+  double se, sd, x;
+  double z0, *y;
+  INTERACT_SHELL *s = t->s;
+
+  z0 = 0.0;
+  nk0 = 0;
+  if (t->ks[1] == t->ks[2]) {
+    nk0 = 1;
+    k = 0;
+    kk0 = &k;
+    y = &z0;
+    nk0 = AngularZ(&y, &kk0, nk0, n_shells, sbra, sket, s, s+3);
+    if (nk0 > 0) {
+      z0 /= sqrt(s[0].j + 1.0);
+      if (IsOdd((s[0].j - s[2].j)/2)) z0 = -z0;
+    }
+  }
+
+  x = 0.0;
+  nk = AngularZxZ0(&ang, &kk, 0, n_shells, sbra, sket, s);
+  for (i = 0; i < nk; i++) {
+    sd = 0;
+    se = 0;
+    if (fabs(ang[i]) > EPS30) {
+      HamTermSlater(t, kk[i], &sd, &se);
+      x += ang[i] * (sd+se);
+    } else if (nk0 > 0) {
+      HamTermSlater(t, kk[i], &sd, NULL);
+    }
+    if (nk0 > 0) x -= z0 * sd;
+  }
+  if (nk > 0) {
+    free(ang);
+    free(kk);
+  }
+  return x;
+}
+
+/*
+** the hamiltonian matrix elements between the states isi[0..ni-1] of
+** one configuration and the states isj[0..nj-1] of another, returned
+** in x[i+j*ni]. the interacting shells, the list of terms and their
+** radial integrals are set up once for the configuration pair, and
+** only the angular coefficients are evaluated for each pair of
+** states. if tri is set, the two lists are the same and only the
+** elements with i <= j are computed. the results are identical to
+** those of HamiltonElement.
+*/
+void HamiltonElementBlock(int isym, int ni, int *isi, int nj, int *isj,
+			  int tri, double *x) {
+  CONFIG *ci, *cj;
+  SYMMETRY *sym;
+  STATE *si, *sj;
+  SHELL_STATE *sbra, *sket;
+  INTERACT_DATUM *idatum;
+  HAM_TERM *t;
+  int i, j, m, n_shells, nt;
+  double x1, x2, a, r;
+
+  for (i = 0; i < ni*nj; i++) x[i] = 0.0;
+  sym = GetSymmetry(isym);
+  si = (STATE *) ArrayGet(&(sym->states), isi[0]);
+  sj = (STATE *) ArrayGet(&(sym->states), isj[0]);
+  ci = GetConfig(si);
+  if (ci->n_shells == 0) return;
+  cj = GetConfig(sj);
+  if (cj->n_shells == 0) return;
+
+  switch (ci_level) {
+  case 1:
+    if (ci != cj) return;
+  case 2:
+    if (ci->nnrs != cj->nnrs) return;
+    else {
+      if (memcmp(ci->nrs, cj->nrs, sizeof(int)*ci->nnrs)) return;
+    }
+  case 3:
+    if (si->kgroup != sj->kgroup) return;
+  }
+
+  if (ci->n_csfs == 0 || cj->n_csfs == 0) {
+    for (j = 0; j < nj; j++) {
+      for (i = 0; i < ni; i++) {
+	if (tri && i > j) break;
+	x[i+j*ni] = HamiltonElement(isym, isi[i], isj[j]);
+      }
+    }
+    return;
+  }
+
+  idatum = NULL;
+  t = NULL;
+  nt = 0;
+  for (j = 0; j < nj; j++) {
+    sj = (STATE *) ArrayGet(&(sym->states), isj[j]);
+    for (i = 0; i < ni; i++) {
+      if (tri && i > j) break;
+      si = (STATE *) ArrayGet(&(sym->states), isi[i]);
+      n_shells = GetInteract(&idatum, &sbra, &sket,
+			     si->kgroup, sj->kgroup,
+			     si->kcfg, sj->kcfg,
+			     si->kstate, sj->kstate, 0);
+      if (n_shells <= 0) {
+	if (idatum == NULL || idatum->n_shells < 0) goto DONE;
+	continue;
+      }
+      if (t == NULL) {
+	m = 1 + n_shells + n_shells*(n_shells+1)/2;
+	t = malloc(sizeof(HAM_TERM)*m);
+	nt = HamTerms(t, n_shells, idatum->s, idatum->bra);
+      }
+      x1 = 0.0;
+      x2 = 0.0;
+      for (m = 0; m < nt; m++) {
+	if (t[m].type == 1) {
+	  r = HamTerm1E(n_shells, sbra, sket, t+m);
+	  x1 += r;
+	} else {
+	  r = HamTerm2E(n_shells, sbra, sket, t+m);
+	  x2 += r;
+	}
       }
+      a = sqrt(sbra[0].totalJ + 1.0);
+      if (IsOdd(idatum->phase)) a = -a;
+      x1 /= a;
+      x2 /= a;
+      if (isi[i] == isj[j]) {
+	x1 += ci->delta;
+      }
+      x[i+j*ni] = x1 + x2;
+      free(sbra);
+      free(sket);
     }
   }
-  /* the prefactor in the Wigner-Eckart theorem should be included in
-     the matrix element. for a scalar operator, this is [J]^{-1/2} */
-  x = sqrt(sbra[0].totalJ + 1.0);
-  if (IsOdd(phase)) x = -x;
-  *x1 /= x;
-  *x2 /= x;
 
-  if (isi == isj) {
-    *x1 += ci->delta;
+ DONE:
+  if (t) {
+    for (m = 0; m < nt; m++) {
+      if (t[m].ik) {
+	free(t[m].ik);
+	free(t[m].sd);
+	free(t[m].se);
+      }
+    }
+    free(t);
   }
-  free(sbra);
-  free(sket);
 }
 
 int SlaterCoeff(char *fn, int nlevs, int *ilevs,
@@ -2370,6 +3304,369 @@ void GenEigen(HAMILTON *h, char *trans, char *jobz, int n, double *ap,
   }
 }
 
+/*
+** add the contribution of the columns j0..j1-1 of the packed upper
+** triangle of H to y = H x.
+*/
+static void HamiltonMatVecCols(HAMILTON *h, int nb, int j0, int j1,
+			       double *x, double *y) {
+  int i, j, v;
+  double a, *ap, *xi, *yi, *xj, *yj;
+
+  if (h->nnz > 0) {
+    size_t k;
+    for (j = j0; j < j1; j++) {
+      xj = x + j*nb;
+      yj = y + j*nb;
+      for (k = h->csr_p[j]; k < h->csr_p[j+1]; k++) {
+	i = h->csr_i[k];
+	a = h->csr_a[k];
+	xi = x + i*nb;
+	yi = y + i*nb;
+	if (i == j) {
+	  for (v = 0; v < nb; v++) {
+	    yj[v] += a*xj[v];
+	  }
+	} else {
+	  for (v = 0; v < nb; v++) {
+	    yi[v] += a*xj[v];
+	    yj[v] += a*xi[v];
+	  }
+	}
+      }
+    }
+    return;
+  }
+  ap = h->hamilton + ((size_t)j0*(j0+1))/2;
+  for (j = j0; j < j1; j++) {
+    xj = x + j*nb;
+    yj = y + j*nb;
+    for (i = 0; i < j; i++) {
+      a = ap[i];
+      xi = x + i*nb;
+      yi = y + i*nb;
+      for (v = 0; v < nb; v++) {
+	yi[v] += a*xj[v];
+	yj[v] += a*xi[v];
+      }
+    }
+    a = ap[j];
+    for (v = 0; v < nb; v++) {
+      yj[v] += a*xj[v];
+    }
+    ap += j+1;
+  }
+}
+
+/*
+** y = H x for a block of nb vectors stored interleaved, x[i*nb+v],
+** where H is the packed upper triangle in h->hamilton. when a large
+** symmetry is diagonalized alone, the columns are shared among the
+** threads, each accumulating into its own copy of y.
+*/
+static void HamiltonMatVec(HAMILTON *h, int nb, double *x, double *y) {
+  int n;
+  size_t t, k;
+
+  n = h->dim;
+  t = (size_t)n*nb;
+  for (k = 0; k < t; k++) {
+    y[k] = 0.0;
+  }
+#if USE_MPI == 2
+  int np;
+  MPIRank(&np);
+  if (_diag_mt && np > 1) {
+    double *yt = malloc(sizeof(double)*t*(np-1));
+    ResetWidMPI();
+#pragma omp parallel default(shared) private(k)
+    {
+      int j, mr = MPIRank(NULL);
+      double *yr = mr == 0? y : yt + t*(mr-1);
+      if (mr > 0) {
+	for (k = 0; k < t; k++) {
+	  yr[k] = 0.0;
+	}
+      }
+      for (j = 0; j < n; j += 64) {
+	if (SkipMPI()) continue;
+	HamiltonMatVecCols(h, nb, j, Min(j+64, n), x, yr);
+      }
+    }
+    for (k = 0; k < t*(np-1); k++) {
+      y[k%t] += yt[k];
+    }
+    free(yt);
+    return;
+  }
+#endif
+  HamiltonMatVecCols(h, nb, 0, n, x, y);
+}
+
+/*
+** block davidson iteration for the lowest nev eigenpairs of the
+** hamiltonian, used instead of the full diagonalization for large
+** symmetries. the search space of at most mmax vectors is restarted
+** with the current ritz vectors when full. the ritz vectors are built
+** in place in h->mixing, in the layout of the full diagonalization,
+** and the remaining dim-nev vectors are zeroed. h->nlev is set to nev.
+** the space needed is 2*dim*mmax + 2*dim*nb + 3*mmax^2 + 5*mmax + dim
+** doubles in h->work, which holds for 2*mmax <= dim.
+*/
+static int DavidsonHamilton(HAMILTON *h, int nev, int nb, int mmax) {
+  char jobz[] = "V";
+  char uplo[] = "U";
+  int n, s, s0, nt, nc, nw, i, j, k, u, iter, info;
+  size_t t;
+  double *v, *w, *xb, *yb, *g, *gp, *q, *e, *ew, *d, *x, *wx, *vj, *r;
+  double a, c;
+
+  n = h->dim;
+  v = h->work;
+  w = v + (size_t)n*mmax;
+  xb = w + (size_t)n*mmax;
+  yb = xb + (size_t)n*nb;
+  g = yb + (size_t)n*nb;
+  gp = g + mmax*mmax;
+  q = gp + mmax*(mmax+1)/2;
+  e = q + mmax*mmax;
+  ew = e + mmax;
+  d = ew + 3*mmax;
+  /* the ritz vectors and H times them, both within the mixing array */
+  x = h->mixing + n;
+  wx = x + (size_t)n*nev;
+
+  for (i = 0; i < n; i++) {
+    d[i] = h->hamilton[(size_t)i*(i+1)/2+i];
+  }
+  /* start from the unit vectors of the lowest diagonal elements. in
+     the incremental mode, from the retained eigenvectors continued
+     into the new basis, completed with the unit vectors of the new
+     states first. */
+  ArgSort(n, d, h->iwork);
+  nw = 0;
+  if (h->rmap && h->rmix) nw = Min(nev, h->rnlev);
+ START:
+  for (k = 0; k < nw; k++) {
+    vj = v + (size_t)k*n;
+    r = h->rmix + (size_t)k*h->rdim;
+    for (i = 0; i < n; i++) {
+      vj[i] = h->rmap[i] < 0? 0.0 : r[h->rmap[i]];
+    }
+  }
+  for (u = 0; u < 2 && k < nev; u++) {
+    for (j = 0; j < n && k < nev; j++) {
+      i = h->iwork[j];
+      if (nw > 0 && (h->rmap[i] < 0) != (u == 0)) continue;
+      vj = v + (size_t)k*n;
+      for (t = 0; t < n; t++) vj[t] = 0.0;
+      vj[i] = 1.0;
+      k++;
+    }
+  }
+  s0 = 0;
+  s = nev;
+  for (iter = 0; ; iter++) {
+    /* orthonormalize the new vectors, dropping the dependent ones */
+    k = s0;
+    for (j = s0; j < s; j++) {
+      vj = v + (size_t)j*n;
+      a = 0.0;
+      for (t = 0; t < n; t++) a += vj[t]*vj[t];
+      if (a <= 0) continue;
+      a = 1.0/sqrt(a);
+      for (t = 0; t < n; t++) vj[t] *= a;
+      for (u = 0; u < 2; u++) {
+	for (i = 0; i < k; i++) {
+	  r = v + (size_t)i*n;
+	  a = 0.0;
+	  for (t = 0; t < n; t++) a += r[t]*vj[t];
+	  for (t = 0; t < n; t++) vj[t] -= a*r[t];
+	}
+      }
+      a = 0.0;
+      for (t = 0; t < n; t++) a += vj[t]*vj[t];
+      a = sqrt(a);
+      if (a < EPS8) continue;
+      a = 1.0/a;
+      r = v + (size_t)k*n;
+      for (t = 0; t < n; t++) r[t] = vj[t]*a;
+      k++;
+    }
+    if (iter == 0 && k < nev && nw > 0) {
+      nw = 0;
+      goto START;
+    }
+    if (k == s0) {
+      MPrintf(-1, "davidson stalled: %d %d %d %d\n", h->pj, n, nev, iter);
+      break;
+    }
+    s = k;
+    for (j = s0; j < s; j += nb) {
+      nt = Min(nb, s-j);
+      for (u = 0; u < nt; u++) {
+	vj = v + (size_t)(j+u)*n;
+	for (i = 0; i < n; i++) xb[i*nt+u] = vj[i];
+      }
+      HamiltonMatVec(h, nt, xb, yb);
+      for (u = 0; u < nt; u++) {
+	vj = w + (size_t)(j+u)*n;
+	for (i = 0; i < n; i++) vj[i] = yb[i*nt+u];
+      }
+    }
+    /* extend the projected matrix and diagonalize it */
+    for (j = s0; j < s; j++) {
+      vj = w + (size_t)j*n;
+      for (i = 0; i <= j; i++) {
+	r = v + (size_t)i*n;
+	a = 0.0;
+	for (t = 0; t < n; t++) a += r[t]*vj[t];
+	g[i*mmax+j] = a;
+	g[j*mmax+i] = a;
+      }
+    }
+    for (j = 0; j < s; j++) {
+      for (i = 0; i <= j; i++) {
+	gp[j*(j+1)/2+i] = g[i*mmax+j];
+      }
+    }
+    DSPEV(jobz, uplo, s, gp, e, q, s, ew, &info);
+    if (info) {
+      MPrintf(-1, "DAVIDSON DSPEV ERROR: %d %d %d\n", h->pj, iter, info);
+      return -1;
+    }
+    /* ritz vectors and residuals of the lowest nev */
+    nc = 0;
+    for (k = 0; k < nev; k++) {
+      vj = x + (size_t)k*n;
+      r = wx + (size_t)k*n;
+      for (i = 0; i < n; i++) {
+	vj[i] = 0.0;
+	r[i] = 0.0;
+      }
+      for (j = 0; j < s; j++) {
+	a = q[k*s+j];
+	for (i = 0; i < n; i++) {
+	  vj[i] += a*v[(size_t)j*n+i];
+	  r[i] += a*w[(size_t)j*n+i];
+	}
+      }
+      c = 0.0;
+      for (i = 0; i < n; i++) {
+	a = r[i] - e[k]*vj[i];
+	c += a*a;
+      }
+      if (sqrt(c) > davidson_tol) {
+	h->iwork[nc++] = k;
+      }
+    }
+    if (nc == 0) break;
+    if (iter >= davidson_maxiter) {
+      MPrintf(-1, "davidson not converged: %d %d %d %d %d\n",
+	      h->pj, n, nev, nc, iter);
+      break;
+    }
+    nt = Min(nc, nb);
+    if (s + nt > mmax) {
+      for (k = 0; k < nev; k++) {
+	memcpy(v+(size_t)k*n, x+(size_t)k*n, sizeof(double)*n);
+	memcpy(w+(size_t)k*n, wx+(size_t)k*n, sizeof(double)*n);
+	for (j = 0; j < nev; j++) {
+	  g[k*mmax+j] = 0.0;
+	}
+	g[k*mmax+k] = e[k];
+      }
+      s = nev;
+    }
+    /* the diagonal preconditioned corrections */
+    s0 = s;
+    for (u = 0; u < nt; u++) {
+      k = h->iwork[u];
+      vj = v + (size_t)(s+u)*n;
+      r = wx + (size_t)k*n;
+      for (i = 0; i < n; i++) {
+	a = e[k] - d[i];
+	if (fabs(a) < EPS8) a = a < 0? -EPS8 : EPS8;
+	vj[i] = (r[i] - e[k]*x[(size_t)k*n+i])/a;
+      }
+    }
+    s += nt;
+  }
+
+  for (k = 0; k < n; k++) {
+    h->mixing[k] = k < nev? e[k] : 0.0;
+  }
+  for (t = 0; t < (size_t)n*(n-nev); t++) {
+    wx[t] = 0.0;
+  }
+  h->nlev = nev;
+  h->diag_iter = iter;
+  return 0;
+}
+
+/*
+** dense diagonalization with the hamiltonian expanded to full
+** column-major storage: blocked reduction to tridiagonal form,
+** divide-and-conquer for the tridiagonal problem, and the back
+** transformation of the kept vectors only. with nlev > 0 only the
+** lowest nlev levels are kept, with ewin > 0 only those within ewin
+** of the lowest one. h->work holds the full matrix, the tridiagonal
+** eigenvectors and the workspace, 3*dim*dim + 7*dim + 1 doubles.
+*/
+static int FullDiagHamilton(HAMILTON *h, int nlev, double ewin) {
+  char uplo[] = "L";
+  char side[] = "L";
+  char trans[] = "N";
+  char compz[] = "I";
+  int n, i, j, k, lw, info;
+  size_t t;
+  double *a, *z, *w, *d, *e, *tau, *x;
+
+  n = h->dim;
+  t = (size_t)n*n;
+  a = h->work;
+  z = a + t;
+  w = z + t;
+  d = w + t + 4*n + 1;
+  e = d + n;
+  tau = e + n;
+  lw = n*n;
+
+  for (j = 0; j < n; j++) {
+    x = h->hamilton + (size_t)j*(j+1)/2;
+    for (i = 0; i <= j; i++) {
+      a[(size_t)i*n+j] = x[i];
+    }
+  }
+  DSYTRD(uplo, n, a, n, d, e, tau, w, lw, &info);
+  if (info) {
+    MPrintf(-1, "DSYTRD ERROR: %d %d %d\n", h->pj, n, info);
+    return -1;
+  }
+  DSTEDC(compz, n, d, e, z, n, w, lw+4*n+1, h->iwork, 3+5*n, &info);
+  if (info) {
+    MPrintf(-1, "DSTEDC ERROR: %d %d %d\n", h->pj, n, info);
+    return -1;
+  }
+  k = PartialLevels(n, d, nlev, ewin);
+  x = h->mixing + n;
+  memcpy(x, z, sizeof(double)*n*(size_t)k);
+  DORMTR(side, uplo, trans, n, k, a, n, tau, x, n, w, lw, &info);
+  if (info) {
+    MPrintf(-1, "DORMTR ERROR: %d %d %d\n", h->pj, n, info);
+    return -1;
+  }
+  for (i = 0; i < n; i++) {
+    h->mixing[i] = i < k? d[i] : 0.0;
+  }
+  x += (size_t)n*k;
+  for (t = 0; t < (size_t)n*(n-k); t++) {
+    x[t] = 0.0;
+  }
+  h->nlev = k;
+  return 0;
+}
+
 /*
 ** be careful that the h->hamilton or h->heff is overwritten
 ** after the DiagnolizeHamilton call
@@ -2400,6 +3697,7 @@ int DiagnolizeHamilton(HAMILTON *h) {
   np = m - n;
   ldz = n;
   t0 = n*(n+1);
+  h->nlev = n;
 
   lwork = h->lwork;
   liwork = h->liwork;
@@ -2416,6 +3714,30 @@ int DiagnolizeHamilton(HAMILTON *h) {
     return 0;
   }
 
+  if (_partial_diag && davidson_nlev > 0 && davidson_nlev < n &&
+      n >= davidson_dmin && m == n && h->hsp == NULL && h->heff == NULL) {
+    k = davidson_nblock;
+    if (k <= 0) k = Min(davidson_nlev, 32);
+    t = davidson_mmax;
+    if (t < davidson_nlev + k) t = davidson_nlev + 4*k;
+    if (2*t <= n) {
+      if (DavidsonHamilton(h, davidson_nlev, k, t) < 0) goto ERROR;
+      return 0;
+    }
+  }
+
+  if (full_mode > 0 && n >= full_dmin && m == n &&
+      h->hsp == NULL && h->heff == NULL &&
+      (double)n*n + 4.0*n + 1 < 2147483647.0) {
+    if (_partial_diag) {
+      k = FullDiagHamilton(h, full_nlev, full_ewin);
+    } else {
+      k = FullDiagHamilton(h, 0, 0.0);
+    }
+    if (k < 0) goto ERROR;
+    return 0;
+  }
+
   if (h->hsp) {
     w = h->mixing;
     mixing = w+m;
@@ -2998,7 +4320,7 @@ int AddToLevels(HAMILTON *h, int ng, int *kg) {
 
   if (h->pj < 0) {
     j = n_eblevels;
-    for (i = 0; i < d; i++) {
+    for (i = 0; i < h->nlev; i++) {
       k = GetPrincipleBasis(mix, d, NULL);
       lev.energy = h->mixing[i];
       lev.pj = h->pj;
@@ -3023,13 +4345,13 @@ int AddToLevels(HAMILTON *h, int ng, int *kg) {
     }
 
     n_eblevels = j;
-    if (i < d-1) return -2;
+    if (i < h->nlev-1) return -2;
     return 0;
   }
 
   int mce = ConfigEnergyMode();
   sym = GetSymmetry(h->pj);
-  for (i = 0; i < d; i++) {
+  for (i = 0; i < h->nlev; i++) {
     k = GetPrincipleBasis(mix, h->n_basis, NULL);
     s = (STATE *) ArrayGet(&(sym->states), h->basis[k]);
     if (ng > 0) {
@@ -3637,16 +4959,264 @@ int SolveStructureFrozen(char *fn, int ng, int *kg, int nc, int *kc,
     fflush(stdout);
   }
   }
-  
-  SortLevels(nlevels, -1, 0);
-  SaveLevels(fn, nlevels, -1);
-  return 0;
+  
+  SortLevels(nlevels, -1, 0);
+  SaveLevels(fn, nlevels, -1);
+  return 0;
+}
+
+/*
+** checkpoints of the hamiltonians solved in SolveStructure. each
+** symmetry is saved to its own file, prefix.isym, when diagonalized,
+** with the constructed hamiltonian and the mixing of the levels. the
+** header carries a hash of the potential, the basis, and the options
+** affecting the matrix or the levels kept, so a restarted run reuses
+** only the symmetries that are still valid.
+*/
+#define HCK_MAGIC "FACHCK1"
+#define HCK_VERSION 1
+
+typedef struct _HCKHDR_ {
+  char magic[8];
+  int version, isym;
+  unsigned long long hash;
+  int dim, ndim, orig_dim, n_basis, nlev;
+  size_t hsize;
+} HCKHDR;
+
+int SetHamiltonCheckpoint(char *fn) {
+  if (fn == NULL) fn = "";
+  strncpy(_ham_ckpt, fn, 1023);
+  return 0;
+}
+
+static unsigned long long HamiltonHash(int isym, int ng0, int ng, int *kg,
+				       int ngp, int *kgp, int md) {
+  unsigned long long h;
+  SYMMETRY *sym;
+  STATE *s;
+  CONFIG *c;
+  int t, i, p[16];
+  double x[3];
+
+  sym = GetSymmetry(isym);
+  h = PotentialHash();
+  p[0] = isym;
+  p[1] = md;
+  p[2] = ng0;
+  p[3] = ng;
+  p[4] = ngp;
+  p[5] = ci_level;
+  p[6] = perturb_setzero;
+  p[7] = sparse_mode;
+  p[8] = sparse_dmin;
+  p[9] = diag_mode;
+  p[10] = full_mode > 0? full_dmin : 0;
+  p[11] = full_nlev;
+  p[12] = davidson_nlev;
+  p[13] = davidson_nlev > 0? davidson_dmin : 0;
+  p[14] = sym_pp;
+  p[15] = sym_njj;
+  h = HashBytes(h, p, sizeof(int)*16);
+  if (sym_njj > 0) h = HashBytes(h, sym_jj, sizeof(int)*sym_njj);
+  x[0] = full_ewin;
+  x[1] = davidson_tol;
+  x[2] = perturb_threshold;
+  h = HashBytes(h, x, sizeof(double)*3);
+  if (ng > 0) h = HashBytes(h, kg, sizeof(int)*ng);
+  if (ngp > 0) h = HashBytes(h, kgp, sizeof(int)*ngp);
+  if (sym == NULL) return h;
+  for (t = 0; t < sym->n_states; t++) {
+    s = (STATE *) ArrayGet(&(sym->states), t);
+    if (!InGroups(s->kgroup, ng, kg) &&
+	!(ngp > 0 && InGroups(s->kgroup, ngp, kgp))) continue;
+    h = HashBytes(h, &t, sizeof(int));
+    h = HashBytes(h, s, sizeof(STATE));
+    if (s->kgroup < 0) continue;
+    c = GetConfig(s);
+    for (i = 0; i < c->n_shells; i++) {
+      p[0] = c->shells[i].n;
+      p[1] = c->shells[i].kappa;
+      p[2] = c->shells[i].nq;
+      h = HashBytes(h, p, sizeof(int)*3);
+    }
+  }
+  return h;
+}
+
+static void WriteHamiltonCkpt(HAMILTON *h, unsigned long long hk) {
+  char fn[1100], tfn[1110];
+  HCKHDR hdr;
+  FILE *f;
+  size_t n;
+  int r;
+
+  if (h->hsp || h->heff || h->pdim > 0) return;
+  sprintf(fn, "%s.%03d", _ham_ckpt, h->pj);
+  sprintf(tfn, "%s.tmp", fn);
+  memset(&hdr, 0, sizeof(HCKHDR));
+  strncpy(hdr.magic, HCK_MAGIC, 8);
+  hdr.version = HCK_VERSION;
+  hdr.isym = h->pj;
+  hdr.hash = hk;
+  hdr.dim = h->dim;
+  hdr.ndim = h->ndim;
+  hdr.orig_dim = h->orig_dim;
+  hdr.n_basis = h->n_basis;
+  hdr.nlev = h->nlev;
+  hdr.hsize = h->hsize;
+  f = fopen(tfn, "wb");
+  if (f == NULL) {
+    MPrintf(-1, "cannot open checkpoint file: %s\n", tfn);
+    return;
+  }
+  n = h->dim + (size_t)h->nlev*h->n_basis;
+  r = (fwrite(&hdr, sizeof(HCKHDR), 1, f) == 1 &&
+       fwrite(h->basis, sizeof(int), h->n_basis, f) == h->n_basis &&
+       fwrite(h->hamilton, sizeof(double), h->hsize, f) == h->hsize &&
+       fwrite(h->mixing, sizeof(double), n, f) == n);
+  if (fclose(f) != 0) r = 0;
+  if (r) r = (rename(tfn, fn) == 0);
+  if (!r) {
+    MPrintf(-1, "cannot write checkpoint file: %s\n", fn);
+    remove(tfn);
+  }
+}
+
+/*
+** restore the solved hamiltonian of symmetry isym from its checkpoint,
+** returns -1 if there is none, or it does not match the hash hk.
+*/
+static int ReadHamiltonCkpt(int isym, unsigned long long hk, int md) {
+  char fn[1100];
+  HCKHDR hdr;
+  HAMILTON *h;
+  FILE *f;
+  size_t n, t;
+  int r;
+
+  n = 0;
+  sprintf(fn, "%s.%03d", _ham_ckpt, isym);
+  f = fopen(fn, "rb");
+  if (f == NULL) return -1;
+  if (fread(&hdr, sizeof(HCKHDR), 1, f) != 1 ||
+      strncmp(hdr.magic, HCK_MAGIC, 8) != 0 ||
+      hdr.version != HCK_VERSION ||
+      hdr.isym != isym || hdr.hash != hk ||
+      hdr.dim <= 0 || hdr.nlev < 0 || hdr.nlev > hdr.dim) {
+    fclose(f);
+    MPrintf(0, "stale checkpoint ignored: %s\n", fn);
+    return -1;
+  }
+  h = GetHamilton(isym);
+  h->pj = isym;
+  h->pdim = 0;
+  r = AllocHamMem(h, hdr.dim, hdr.n_basis);
+  if (r == 0 && (h->hsp || h->hsize != hdr.hsize)) r = -1;
+  if (r == 0) {
+    n = hdr.dim + (size_t)hdr.nlev*hdr.n_basis;
+    if (fread(h->basis, sizeof(int), h->n_basis, f) != h->n_basis ||
+	fread(h->hamilton, sizeof(double), h->hsize, f) != h->hsize ||
+	fread(h->mixing, sizeof(double), n, f) != n) {
+      r = -1;
+    }
+  }
+  fclose(f);
+  if (r < 0) {
+    MPrintf(0, "cannot read checkpoint file: %s\n", fn);
+    AllocHamMem(h, -1, -1);
+    AllocHamMem(h, 0, 0);
+    return -1;
+  }
+  for (t = n; t < h->msize; t++) {
+    h->mixing[t] = 0.0;
+  }
+  h->ndim = hdr.ndim;
+  h->orig_dim = hdr.orig_dim;
+  h->exp_dim = 0;
+  h->nlev = hdr.nlev;
+  if (md%10) {
+    ConstructHamilton(isym, 0, 0, NULL, 0, NULL, 1);
+  }
+  return 0;
+}
+
+/*
+** order the symmetries by the estimated cost of their diagonalization,
+** largest first, so that the dynamic distribution over the threads or
+** ranks does not end waiting on a single large symmetry. returns the
+** number of the leading symmetries costing more than the share of one
+** thread, which are better solved one at a time using all threads.
+*/
+static int ScheduleSymmetries(int ns, int *order) {
+  double *c, ct;
+  int i, nb;
+  HAMILTON *h;
+
+  c = malloc(sizeof(double)*ns);
+  ct = 0.0;
+  for (i = 0; i < ns; i++) {
+    h = GetHamilton(i);
+    if (h->dim <= 0 || h->pdim > 0) c[i] = 0.0;
+    else c[i] = -((double)h->dim)*h->dim*h->n_basis;
+    ct -= c[i];
+    order[i] = i;
+  }
+  if (sched_mode > 0) ArgSort(ns, c, order);
+  nb = 0;
+#if USE_MPI == 2
+  int np;
+  MPIRank(&np);
+  if (sched_mode > 1 && np > 1) {
+    while (nb < ns && -c[order[nb]] > ct/np) nb++;
+  }
+#endif
+  free(c);
+  return nb;
+}
+
+static void SolveSymmetry(HAMILTON *h, char *fn, int ip, int ng0, int ng,
+			  int *kg, int ngp, int hck, unsigned long long hk) {
+  double *ham;
+  size_t t;
+
+  if (!hck) {
+    ham = NULL;
+    if (IncrEligible(h, ip)) {
+      t = ((size_t)h->dim*(h->dim+1))/2;
+      ham = malloc(sizeof(double)*t);
+      memcpy(ham, h->hamilton, sizeof(double)*t);
+    }
+    if (DiagnolizeHamilton(h) < 0) {
+      if (ham) free(ham);
+      FreeRetainedHamilton(h);
+      return;
+    }
+    if (ham) RetainHamilton(h, ham);
+    if (hk) WriteHamiltonCkpt(h, hk);
+  }
+  if (h->rmap) {
+    free(h->rmap);
+    h->rmap = NULL;
+  }
+  if (fn != NULL) {
+    if (ip == 0 || perturb_threshold < 0) {
+      if (ng0 < ng || ip || ngp > 0) {
+	AddToLevels(h, ng0, kg);
+      } else {
+	AddToLevels(h, 0, kg);
+      }
+    }
+  }
 }
 
 int SolveStructure(char *fn, char *hfn,
 		   int ng, int *kg, int ngp, int *kgp, int ip) {
-  int ng0, nlevels, ns, k, i, md, rh;
+  int ng0, nlevels, ns, k, i, md, rh, nbig;
+  int order[MAX_SYMMETRIES];
   HAMILTON *h;
+  unsigned long long hk[MAX_SYMMETRIES];
+  char hck[MAX_SYMMETRIES];
   if (ip > 10) {
     int n0, n1, k1;
     k1 = ip%100;
@@ -3688,9 +5258,24 @@ int SolveStructure(char *fn, char *hfn,
     AddToLevels(NULL, ng0, kg);
   } else {
     double wtb = WallTime();
+    for (i = 0; i < ns; i++) {
+      hk[i] = 0;
+      hck[i] = 0;
+    }
     if (rh == 0) {
+      /* large symmetries may be distributed over the mpi ranks when
+	 the packed hamiltonian is not needed after the diagonalization */
+      _dist_ham = (ip == 0 && fn != NULL && hfn == NULL);
+      if (incr_mode) _incr_hash = IncrHash();
       for (i = 0; i < ns; i++) {
-	k = ConstructHamilton(i, ng0, ng, kg, ngp, kgp, md);
+	/* the solved symmetries of an interrupted run are restored,
+	   only the final hamiltonians without iterative expansion */
+	if (_ham_ckpt[0] && (ip == 0 || perturb_threshold < 0)) {
+	  hk[i] = HamiltonHash(i, ng0, ng, kg, ngp, kgp, md);
+	  hck[i] = (ReadHamiltonCkpt(i, hk[i], md) == 0);
+	}
+	if (hck[i]) k = 0;
+	else k = ConstructHamilton(i, ng0, ng, kg, ngp, kgp, md);
 	h = GetHamilton(i);
 	h->orig_dim = h->dim;
 	h->exp_dim = 0;
@@ -3700,29 +5285,46 @@ int SolveStructure(char *fn, char *hfn,
 	  AllocHamMem(h, 0, 0);
 	}
       }
+      _dist_ham = 0;
+    }
+    /* only the lowest levels are needed, unless the mixing of all
+       states is used for the perturbative expansion of the basis */
+    _partial_diag = (ip == 0 || perturb_threshold < 0);
+#if USE_MPI == 1 && defined(USE_SCALAPACK)
+    for (i = 0; i < ns; i++) {
+      h = GetHamilton(i);
+      if (h->dim <= 0 || h->pdim == 0) continue;
+      if (DiagonalizeHamiltonDist(h) < 0) continue;
+      if (fn != NULL && MyRankMPI() == 0) {
+	if (ng0 < ng || ip || ngp > 0) {
+	  AddToLevels(h, ng0, kg);
+	} else {
+	  AddToLevels(h, 0, kg);
+	}
+      }
+    }
+#endif
+    nbig = ScheduleSymmetries(ns, order);
+    _diag_mt = 1;
+    for (k = 0; k < nbig; k++) {
+      i = order[k];
+      SolveSymmetry(GetHamilton(i), fn, ip, ng0, ng, kg, ngp, hck[i], hk[i]);
     }
+    _diag_mt = 0;
     ResetWidMPI();
 #pragma omp parallel default(shared) private(i, h)
     {
-      for (i = 0; i < ns; i++) {
+      int ii;
+      for (ii = nbig; ii < ns; ii++) {
+	i = order[ii];
 	h = GetHamilton(i);
-	if (h->dim <= 0) continue;
+	if (h->dim <= 0 || h->pdim > 0) continue;
 	int skip = SkipMPI();
 	if (skip) continue;
-	if (DiagnolizeHamilton(h) < 0) {
-	  continue;
-	}
-	if (fn != NULL) {
-	  if (ip == 0 || perturb_threshold < 0) {
-	    if (ng0 < ng || ip || ngp > 0) {
-	      AddToLevels(h, ng0, kg);
-	    } else {
-	      AddToLevels(h, 0, kg);
-	    }
-	  }
-	}
+	SolveSymmetry(h, fn, ip, ng0, ng, kg, ngp, hck[i], hk[i]);
       }
     }
+    _partial_diag = 0;
     if (ip > 0 && perturb_threshold >= 0) {
       int *isp0, *isp1, *ib, dim, np0, np1, j, t, iter;
       int dim0[MAX_SYMMETRIES];
@@ -3854,10 +5456,13 @@ int SolveStructure(char *fn, char *hfn,
 	  free(isp1);
 	  if (!done[i]) alldone = 0;
 	}
+	ScheduleSymmetries(ns, order);
 	ResetWidMPI();
 #pragma omp parallel default(shared) private(i, h)
 	{
-	  for (i = 0; i < ns; i++) {
+	  int ii;
+	  for (ii = 0; ii < ns; ii++) {
+	    i = order[ii];
 	    h = GetHamilton(i);
 	    if (h->dim <= 0) continue;
 	    int skip = SkipMPI();
@@ -4342,6 +5947,9 @@ int SaveLevels(char *fn, int m, int n) {
 	  ((double)radt.radial_1e)/CLOCKS_PER_SEC,
 	  ((double)radt.radial_slater)/CLOCKS_PER_SEC,
 	  ((double)radt.radial_2e)/CLOCKS_PER_SEC);
+  fprintf(perform_log, "Yk: %6.1E, RPowTable: %ld, RPowCall: %ld\n",
+	  ((double)radt.radial_yk)/CLOCKS_PER_SEC,
+	  radt.nrpow_table, radt.nrpow_pow);
   fprintf(perform_log, "\n");
   fflush(perform_log);
 #endif /* PERFORM_STATISTICS */
@@ -5500,6 +7108,376 @@ int AngularZxZFreeBoundStates(ANGZ_DATUM **ad, int ih1, int ih2) {
   return (*ad)->ns;
 }
 
+/*
+** on-demand memo of the level-pair angular coefficients of AngularZMix
+** and AngularZFreeBound. the entries live in angmz_array, in the same
+** layout as the tables filled by PrepAngular, so the transition,
+** excitation, ionization and autoionization modules share them.
+** with a cache file set by SetAngZCache, the entries are also saved
+** to disk, with the orbitals given by n and kappa. each record
+** carries the hashes of its two hamiltonians, and a later run only
+** reuses the records whose states and mixing are unchanged.
+*/
+#define AZC_MAGIC "FACAZC1"
+#define AZC_VERSION 1
+
+typedef struct _AZCHDR_ {
+  char magic[8];
+  int version, size;
+  long nrec;
+} AZCHDR;
+
+typedef struct _AZCREC_ {
+  unsigned long long h1, h2;
+  int ih1, ih2, is, type, nz;
+} AZCREC;
+
+typedef struct _AZCITEM_ {
+  double coeff;
+  short k, n0, kappa0, n1, kappa1;
+} AZCITEM;
+
+static struct {
+  char fn[1024];
+  int nhams, nlevels;
+  unsigned long long *hh;
+} _azc = {"", -1, -1, NULL};
+
+static void AllocAngMZArray(void) {
+  ANGZ_DATUM *a;
+  int i;
+
+#pragma omp critical(angz_memo)
+  {
+    if (angmz_array == NULL) {
+      a = malloc(sizeof(ANGZ_DATUM)*angz_dim2);
+      if (!a) {
+	printf("cannot allocate memory for angmz_array %d\n", angz_dim2);
+      }
+      for (i = 0; i < angz_dim2; i++) {
+	a[i].ns = 0;
+	a[i].nd = 0;
+	a[i].mk = NULL;
+	InitLock(&a[i].lock);
+      }
+#pragma omp flush
+      angmz_array = a;
+    }
+  }
+}
+
+/*
+** the memo slot of the levels i1 and i2 of the hamiltonians ih1 and
+** ih2, the table of the pair is allocated if create is set.
+*/
+static ANGZ_ARY *AngZMemoSlot(ANGZ_DATUM **pad, int ih1, int ih2,
+			      int i1, int i2, int create) {
+  ANGZ_DATUM *ad;
+  ANGZ_ARY **a;
+  int i, ns;
+
+  if (ih1 < 0 || ih2 < 0 || ih1 >= nhams || ih2 >= nhams) return NULL;
+  if (i1 < 0 || i1 >= hams[ih1].nlevs) return NULL;
+  if (i2 < 0 || i2 >= hams[ih2].nlevs) return NULL;
+  if (angmz_array == NULL) {
+    if (!create) return NULL;
+    AllocAngMZArray();
+  }
+  ad = &(angmz_array[ih1*_max_hams + ih2]);
+  if (ad->ns == 0) {
+    if (!create) return NULL;
+    SetLock(&ad->lock);
+    if (ad->ns == 0) {
+      ns = hams[ih1].nlevs*hams[ih2].nlevs;
+      a = malloc(sizeof(ANGZ_ARY *)*ns);
+      for (i = 0; i < ns; i++) {
+	a[i] = malloc(sizeof(ANGZ_ARY));
+	a[i]->nz = 0;
+	a[i]->az = NULL;
+      }
+      ad->angz = a;
+#pragma omp flush
+      ad->ns = ns;
+    }
+    ReleaseLock(&ad->lock);
+  }
+  if (pad) *pad = ad;
+  return (ad->angz)[i1*hams[ih2].nlevs + i2];
+}
+
+/* fill an empty memo slot, unless another thread did it first */
+static void AngZMemoStore(ANGZ_DATUM *ad, ANGZ_ARY *az, int nz, void *a) {
+  SetLock(&ad->lock);
+  if (az->nz == 0) {
+    az->az = a;
+#pragma omp flush
+    az->nz = nz > 0? nz : -1;
+    a = NULL;
+  }
+  ReleaseLock(&ad->lock);
+  if (a) free(a);
+}
+
+static unsigned long long AngZHamHash(int ih) {
+  unsigned long long h;
+  SHAMILTON *hs;
+  STATE *s;
+  LEVEL *lev;
+  CONFIG *c;
+  int t, i, p[4];
+
+  hs = hams + ih;
+  h = 0xcbf29ce484222325ULL;
+  p[0] = hs->pj;
+  p[1] = hs->nbasis;
+  p[2] = hs->nlevs;
+  p[3] = rydberg_ignored;
+  h = HashBytes(h, p, sizeof(int)*4);
+  h = HashBytes(h, &angz_cut, sizeof(double));
+  for (t = 0; t < hs->nbasis; t++) {
+    s = hs->basis[t];
+    h = HashBytes(h, s, sizeof(STATE));
+    if (s->kgroup < 0) continue;
+    c = GetConfig(s);
+    for (i = 0; i < c->n_shells; i++) {
+      p[0] = c->shells[i].n;
+      p[1] = c->shells[i].kappa;
+      p[2] = c->shells[i].nq;
+      h = HashBytes(h, p, sizeof(int)*3);
+    }
+  }
+  for (t = 0; t < hs->nlevs; t++) {
+    lev = hs->levs[t];
+    if (lev == NULL) continue;
+    h = HashBytes(h, &t, sizeof(int));
+    h = HashBytes(h, &lev->n_basis, sizeof(int));
+    h = HashBytes(h, lev->ibasis, sizeof(short)*lev->n_basis);
+    h = HashBytes(h, lev->mixing, sizeof(double)*lev->n_basis);
+  }
+  return h;
+}
+
+/*
+** the hashes are recomputed whenever hamiltonians or levels were
+** added since they were last taken.
+*/
+static unsigned long long AngZHash(int ih) {
+  int i;
+
+  if (_azc.hh == NULL || _azc.nhams != nhams || _azc.nlevels != n_levels) {
+    if (_azc.hh == NULL) _azc.hh = malloc(sizeof(unsigned long long)*angz_dim);
+    for (i = 0; i < angz_dim; i++) _azc.hh[i] = 0;
+    _azc.nhams = nhams;
+    _azc.nlevels = n_levels;
+  }
+  if (_azc.hh[ih] == 0) _azc.hh[ih] = AngZHamHash(ih);
+  return _azc.hh[ih];
+}
+
+static void LoadAngZCache(void) {
+  FILE *f;
+  AZCHDR hdr;
+  AZCREC r;
+  AZCITEM *t;
+  ANGZ_DATUM *ad;
+  ANGZ_ARY *az;
+  ANGULAR_ZMIX *am;
+  ANGULAR_ZFB *af;
+  long i;
+  int j, nt, n1, n2;
+  size_t nr;
+
+  f = fopen(_azc.fn, "rb");
+  if (f == NULL) return;
+  nr = fread(&hdr, sizeof(AZCHDR), 1, f);
+  if (nr != 1 || strncmp(hdr.magic, AZC_MAGIC, 8) != 0 ||
+      hdr.version != AZC_VERSION || hdr.size != sizeof(AZCITEM)) {
+    MPrintf(-1, "stale angular cache rejected: %s\n", _azc.fn);
+    fclose(f);
+    return;
+  }
+  nt = 0;
+  t = NULL;
+  n1 = 0;
+  n2 = 0;
+  for (i = 0; i < hdr.nrec; i++) {
+    if (fread(&r, sizeof(AZCREC), 1, f) != 1) break;
+    if (r.nz > nt) {
+      nt = r.nz;
+      if (t) free(t);
+      t = malloc(sizeof(AZCITEM)*nt);
+    }
+    if (r.nz > 0 && fread(t, sizeof(AZCITEM), r.nz, f) != r.nz) break;
+    if (r.ih1 >= nhams || r.ih2 >= nhams) continue;
+    if (AngZHash(r.ih1) != r.h1 || AngZHash(r.ih2) != r.h2) continue;
+    az = AngZMemoSlot(&ad, r.ih1, r.ih2, r.is/hams[r.ih2].nlevs,
+		      r.is%hams[r.ih2].nlevs, 1);
+    if (az == NULL || az->nz != 0) continue;
+    if (r.nz <= 0) {
+      AngZMemoStore(ad, az, 0, NULL);
+      n2++;
+      continue;
+    }
+    if (r.type == 0) {
+      am = malloc(sizeof(ANGULAR_ZMIX)*r.nz);
+      for (j = 0; j < r.nz; j++) {
+	am[j].coeff = t[j].coeff;
+	am[j].k = t[j].k;
+	am[j].k0 = OrbitalIndex(t[j].n0, t[j].kappa0, 0.0);
+	am[j].k1 = OrbitalIndex(t[j].n1, t[j].kappa1, 0.0);
+      }
+      AngZMemoStore(ad, az, r.nz, am);
+    } else {
+      af = malloc(sizeof(ANGULAR_ZFB)*r.nz);
+      for (j = 0; j < r.nz; j++) {
+	af[j].coeff = t[j].coeff;
+	af[j].kb = OrbitalIndex(t[j].n0, t[j].kappa0, 0.0);
+      }
+      AngZMemoStore(ad, az, r.nz, af);
+    }
+    n1++;
+  }
+  if (t) free(t);
+  fclose(f);
+  MPrintf(0, "angular cache loaded: %s %d %d\n", _azc.fn, n1, n2);
+}
+
+/*
+** look up the memo slot of a level pair, the cache file is read again
+** whenever hamiltonians have been added since the last read.
+*/
+static ANGZ_ARY *AngZMemoGet(ANGZ_DATUM **ad, int ih1, int ih2,
+			     int i1, int i2) {
+  static int nhams_loaded = -1;
+
+  if (_azc.fn[0] && nhams_loaded != nhams) {
+#pragma omp critical(angz_memo)
+    {
+      if (nhams_loaded != nhams) {
+	LoadAngZCache();
+	nhams_loaded = nhams;
+      }
+    }
+  }
+  return AngZMemoSlot(ad, ih1, ih2, i1, i2, 1);
+}
+
+/* write all memo entries to the cache file */
+int FlushAngZCache(void) {
+  char tfn[1100];
+  FILE *f;
+  AZCHDR hdr;
+  AZCREC r;
+  AZCITEM *t;
+  ANGZ_DATUM *ad;
+  ANGZ_ARY *az;
+  ANGULAR_ZMIX *am;
+  ANGULAR_ZFB *af;
+  ORBITAL *o0, *o1;
+  STATE *s1, *s2;
+  int ih1, ih2, is, j, nt, ok;
+
+  if (_azc.fn[0] == '\0' || angmz_array == NULL) return 0;
+#if USE_MPI == 1
+  if (MyRankMPI() != 0) return 0;
+#endif
+  sprintf(tfn, "%s.%d", _azc.fn, (int) getpid());
+  f = fopen(tfn, "wb");
+  if (f == NULL) {
+    printf("cannot open angular cache: %s\n", tfn);
+    return -1;
+  }
+  memset(&hdr, 0, sizeof(AZCHDR));
+  strncpy(hdr.magic, AZC_MAGIC, 8);
+  hdr.version = AZC_VERSION;
+  hdr.size = sizeof(AZCITEM);
+  fwrite(&hdr, sizeof(AZCHDR), 1, f);
+  nt = 0;
+  t = NULL;
+  for (ih1 = 0; ih1 < nhams; ih1++) {
+    for (ih2 = 0; ih2 < nhams; ih2++) {
+      ad = &(angmz_array[ih1*_max_hams + ih2]);
+      if (ad->ns != hams[ih1].nlevs*hams[ih2].nlevs) continue;
+      for (is = 0; is < ad->ns; is++) {
+	az = (ad->angz)[is];
+	if (az == NULL || az->nz == 0) continue;
+	r.h1 = AngZHash(ih1);
+	r.h2 = AngZHash(ih2);
+	r.ih1 = ih1;
+	r.ih2 = ih2;
+	r.is = is;
+	s1 = hams[ih1].basis[0];
+	s2 = hams[ih2].basis[0];
+	if (s1->kgroup < 0 || s2->kgroup < 0) break;
+	r.type = (GetGroup(s1->kgroup)->n_electrons !=
+		  GetGroup(s2->kgroup)->n_electrons);
+	r.nz = az->nz;
+	if (r.nz > nt) {
+	  nt = r.nz;
+	  if (t) free(t);
+	  t = malloc(sizeof(AZCITEM)*nt);
+	}
+	ok = 1;
+	for (j = 0; j < r.nz; j++) {
+	  memset(t+j, 0, sizeof(AZCITEM));
+	  if (r.type == 0) {
+	    am = ((ANGULAR_ZMIX *) az->az) + j;
+	    o0 = GetOrbital(am->k0);
+	    o1 = GetOrbital(am->k1);
+	    t[j].coeff = am->coeff;
+	    t[j].k = am->k;
+	    t[j].n1 = o1->n;
+	    t[j].kappa1 = o1->kappa;
+	    if (o1->n <= 0) ok = 0;
+	  } else {
+	    af = ((ANGULAR_ZFB *) az->az) + j;
+	    o0 = GetOrbital(af->kb);
+	    t[j].coeff = af->coeff;
+	  }
+	  t[j].n0 = o0->n;
+	  t[j].kappa0 = o0->kappa;
+	  if (o0->n <= 0) ok = 0;
+	}
+	if (!ok) continue;
+	fwrite(&r, sizeof(AZCREC), 1, f);
+	if (r.nz > 0) fwrite(t, sizeof(AZCITEM), r.nz, f);
+	hdr.nrec++;
+      }
+    }
+  }
+  if (t) free(t);
+  fseek(f, 0, SEEK_SET);
+  fwrite(&hdr, sizeof(AZCHDR), 1, f);
+  fclose(f);
+  if (rename(tfn, _azc.fn) != 0) {
+    printf("cannot rename angular cache: %s\n", _azc.fn);
+    return -1;
+  }
+  return 0;
+}
+
+static void FlushAngZCacheAtExit(void) {
+  FlushAngZCache();
+}
+
+/*
+** memoize the angular coefficients of level pairs, and keep them in
+** the file fn across runs. an empty name keeps the memo in memory only.
+*/
+int SetAngZCache(char *fn) {
+  static int atx = 0;
+
+  FlushAngZCache();
+  if (fn == NULL) fn = "";
+  strncpy(_azc.fn, fn, 1023);
+  angz_memo = 1;
+  if (_azc.fn[0] && !atx) {
+    atexit(FlushAngZCacheAtExit);
+    atx = 1;
+  }
+  return 0;
+}
+
 int PrepAngular(int n1, int *is1, int n2, int *is2) {
   int i1, i2, ih1, ih2, ns1, ns2, ne1, ne2;
   int iz, is, i, nz, ns;
@@ -5508,16 +7486,7 @@ int PrepAngular(int n1, int *is1, int n2, int *is2) {
   LEVEL *lev1, *lev2;
   ANGZ_DATUM *ad;
 
-  if (angmz_array == NULL) {
-    angmz_array = malloc(sizeof(ANGZ_DATUM)*angz_dim2);
-    if (!angmz_array) {
-      printf("cannot allocate memory for angmz_array %d\n", angz_dim2);
-    }
-    for (i = 0; i < angz_dim2; i++) {
-      angmz_array[i].ns = 0;
-      angmz_array[i].mk = NULL;
-    }
-  }
+  if (angmz_array == NULL) AllocAngMZArray();
 
   if (n2 == 0) {
     n2 = n1;
@@ -5758,7 +7727,7 @@ void PrepAngZStates(int n0, int *s0, int n1, int *s1) {
   free(ih1);
 }
 
-int AngularZFreeBound(ANGULAR_ZFB **ang, int lower, int upper) {
+static int AngularZFreeBoundNoMemo(ANGULAR_ZFB **ang, int lower, int upper) {
   int i, j, m;
   int nz, n;
   double r0;
@@ -5780,25 +7749,6 @@ int AngularZFreeBound(ANGULAR_ZFB **ang, int lower, int upper) {
   lev1 = GetLevel(lower);
   lev2 = GetLevel(upper);
 
-  if (angmz_array) {
-    ih1 = lev1->iham;
-    ih2 = lev2->iham;
-    if (ih1 >= 0 && ih2 >= 0) {
-      isz = ih1 * _max_hams + ih2;
-      ad = &(angmz_array[isz]);
-      nz = 0;
-      if (ad->ns > 0) {
-	isz0 = lev1->ilev * hams[ih2].nlevs + lev2->ilev;
-	nz = (ad->angz)[isz0]->nz;
-	if (nz > 0) {
-	  *ang = malloc(sizeof(ANGULAR_ZFB)*nz);
-	  memcpy(*ang, (ad->angz)[isz0]->az, sizeof(ANGULAR_ZFB)*nz);
-	}
-      }
-      if (nz != 0) return nz;
-    }
-  }
-
   sym1 = GetSymmetry(lev1->pj);
   sym2 = GetSymmetry(lev2->pj);
   j1 = lev1->pj;
@@ -5868,6 +7818,45 @@ int AngularZFreeBound(ANGULAR_ZFB **ang, int lower, int upper) {
   return n;
 }
 
+/*
+** the PrepAngular tables and the memo are consulted before the
+** coefficients are computed.
+*/
+int AngularZFreeBound(ANGULAR_ZFB **ang, int lower, int upper) {
+  LEVEL *lev1, *lev2;
+  ANGZ_DATUM *ad;
+  ANGZ_ARY *az;
+  ANGULAR_ZFB *a;
+  int nz;
+
+  lev1 = GetLevel(lower);
+  lev2 = GetLevel(upper);
+  if (angz_memo) {
+    az = AngZMemoGet(&ad, lev1->iham, lev2->iham, lev1->ilev, lev2->ilev);
+  } else {
+    az = AngZMemoSlot(&ad, lev1->iham, lev2->iham,
+		      lev1->ilev, lev2->ilev, 0);
+  }
+  if (az == NULL || (az->nz == 0 && !angz_memo)) {
+    return AngularZFreeBoundNoMemo(ang, lower, upper);
+  }
+  if (az->nz == 0) {
+    nz = AngularZFreeBoundNoMemo(ang, lower, upper);
+    a = NULL;
+    if (nz > 0) {
+      a = malloc(sizeof(ANGULAR_ZFB)*nz);
+      memcpy(a, *ang, sizeof(ANGULAR_ZFB)*nz);
+    }
+    AngZMemoStore(ad, az, nz, a);
+    return nz;
+  }
+  nz = az->nz;
+  if (nz <= 0) return 0;
+  *ang = malloc(sizeof(ANGULAR_ZFB)*nz);
+  memcpy(*ang, az->az, sizeof(ANGULAR_ZFB)*nz);
+  return nz;
+}
+
 int GetBaseJ(STATE *s) {
   int ih;
   if (s->kgroup >= 0) return -1;
@@ -5878,8 +7867,8 @@ int GetBaseJ(STATE *s) {
   return ih;
 }
 
-int AngularZMix(ANGULAR_ZMIX **ang, int lower, int upper, int mink, int maxk,
-		int *nmk, double **mbk) {
+static int AngularZMixNoMemo(ANGULAR_ZMIX **ang, int lower, int upper,
+			     int mink, int maxk, int *nmk, double **mbk) {
   int i, j, j1, j2, jb1, jb2;
   int kg1, kg2, kc1, kc2;
   int ih1, ih2, isz0, isz;
@@ -5909,43 +7898,6 @@ int AngularZMix(ANGULAR_ZMIX **ang, int lower, int upper, int mink, int maxk,
     *nmk = 0;
     *mbk = NULL;
   }
-  if (angmz_array) {
-    ih1 = lev1->iham;
-    ih2 = lev2->iham;
-    if (ih1 >= 0 && ih2 >= 0) {
-      if (ih1 > ih2) {
-	isz = ih2 * _max_hams + ih1;
-      } else {
-	isz = ih1 * _max_hams + ih2;
-      }
-      ad = &(angmz_array[isz]);
-      nz = 0;
-      if (ad->ns > 0) {
-	if (ih1 > ih2) {
-	  isz0 = lev2->ilev * hams[ih1].nlevs + lev1->ilev;
-	} else {
-	  isz0 = lev1->ilev * hams[ih2].nlevs + lev2->ilev;
-	}
-	nz = (ad->angz)[isz0]->nz;
-	if (nz > 0) {
-	  *ang = malloc(sizeof(ANGULAR_ZMIX)*nz);
-	  memcpy(*ang, (ad->angz)[isz0]->az, sizeof(ANGULAR_ZMIX)*nz);
-	}
-      }
-      if (nz != 0) {
-	if (nz > 0 && ih1 > ih2) {
-	  sym1 = GetSymmetry(lev1->pj);
-	  sym2 = GetSymmetry(lev2->pj);
-	  j1 = lev1->pj;
-	  j2 = lev2->pj;
-	  DecodePJ(j1, NULL, &j1);
-	  DecodePJ(j2, NULL, &j2);
-	  AngZSwapBraKet(nz, *ang, j1-j2);
-	}
-	return nz;
-      }
-    }
-  }
 
   sym1 = GetSymmetry(lev1->pj);
   sym2 = GetSymmetry(lev2->pj);
@@ -6207,6 +8159,77 @@ int AngularZMix(ANGULAR_ZMIX **ang, int lower, int upper, int mink, int maxk,
   return n;
 }
 
+/*
+** the PrepAngular tables and the memo hold the coefficients of all
+** ranks, with the level of the lower hamiltonian index on the left.
+** the memo is not used with the mbpt corrections.
+*/
+int AngularZMix(ANGULAR_ZMIX **ang, int lower, int upper, int mink, int maxk,
+		int *nmk, double **mbk) {
+  LEVEL *lev1, *lev2;
+  ANGZ_DATUM *ad;
+  ANGZ_ARY *az;
+  ANGULAR_ZMIX *a;
+  int ih1, ih2, i1, i2, j1, j2, i, n, nz, memo, swp;
+
+  lev1 = GetLevel(lower);
+  lev2 = GetLevel(upper);
+  swp = lev1->iham > lev2->iham;
+  if (swp) {
+    ih1 = lev2->iham;
+    ih2 = lev1->iham;
+    i1 = lev2->ilev;
+    i2 = lev1->ilev;
+  } else {
+    ih1 = lev1->iham;
+    ih2 = lev2->iham;
+    i1 = lev1->ilev;
+    i2 = lev2->ilev;
+  }
+  memo = angz_memo && mbpt_mk == 0;
+  if (memo) {
+    az = AngZMemoGet(&ad, ih1, ih2, i1, i2);
+  } else {
+    az = AngZMemoSlot(&ad, ih1, ih2, i1, i2, 0);
+  }
+  if (az == NULL || (az->nz == 0 && !memo)) {
+    return AngularZMixNoMemo(ang, lower, upper, mink, maxk, nmk, mbk);
+  }
+  if (nmk) {
+    *nmk = 0;
+    *mbk = NULL;
+  }
+  if (az->nz == 0) {
+    if (swp) {
+      nz = AngularZMixNoMemo(&a, upper, lower, -1, -1, NULL, NULL);
+    } else {
+      nz = AngularZMixNoMemo(&a, lower, upper, -1, -1, NULL, NULL);
+    }
+    AngZMemoStore(ad, az, nz, nz > 0? a : NULL);
+  }
+  nz = az->nz;
+  if (nz <= 0) return 0;
+  a = (ANGULAR_ZMIX *) az->az;
+  *ang = malloc(sizeof(ANGULAR_ZMIX)*nz);
+  n = 0;
+  for (i = 0; i < nz; i++) {
+    if (mink >= 0 && a[i].k < mink) continue;
+    if (maxk >= 0 && a[i].k > maxk) continue;
+    memcpy(*ang+n, a+i, sizeof(ANGULAR_ZMIX));
+    n++;
+  }
+  if (n == 0) {
+    free(*ang);
+    return 0;
+  }
+  if (swp) {
+    DecodePJ(lev1->pj, NULL, &j1);
+    DecodePJ(lev2->pj, NULL, &j2);
+    AngZSwapBraKet(n, *ang, j1-j2);
+  }
+  return n;
+}
+
 int AngularZxZFreeBound(ANGULAR_ZxZMIX **ang, int lower, int upper) {
   int i, j, j1, j2;
   int nz, n;
@@ -6687,9 +8710,15 @@ int FreeAngZArray(void) {
     free(angzxz_array);
     if (angmz_array) {
       for (i = 0; i < angz_dim2; i++) {
+	DestroyLock(&angmz_array[i].lock);
 	FreeAngZDatum(&(angmz_array[i]));
       }
       free(angmz_array);
+      angmz_array = NULL;
+    }
+    if (_azc.hh) {
+      free(_azc.hh);
+      _azc.hh = NULL;
     }
     angz_dim = 0;
     angz_dim2 = 0;
@@ -6712,6 +8741,7 @@ void FreeLevelData(void *p) {
 void FreeHamsArray() {
   int i;
 
+  FlushAngZCache();
   for (i = 0; i < nhams; i++) {
     if (hams[i].nbasis > 0) {
       free(hams[i].basis);
@@ -6817,6 +8847,7 @@ int AllocHamMem(HAMILTON *h, int hdim, int nbasis) {
     h->iham = -1;
     h->dim = 0;
     h->n_basis = 0;
+    h->nlev = 0;
     h->hsize = 0;
     h->msize = 0;
     h->dim0 = 0;
@@ -6832,9 +8863,22 @@ int AllocHamMem(HAMILTON *h, int hdim, int nbasis) {
     h->iwork = NULL;
     h->heff = NULL;
     h->hsp = NULL;
+    h->nnz = 0;
+    h->csr_p = NULL;
+    h->csr_i = NULL;
+    h->csr_a = NULL;
+    h->pdim = 0;
+    h->pmloc = 0;
+    h->pnloc = 0;
+    h->pham = NULL;
     return 0;
   }
   if (hdim < 0) {
+    FreeHamiltonCSR(h);
+    if (h->pham) {
+      free(h->pham);
+      h->pham = NULL;
+    }
     if (h->n_basis0 > 0) {
       free(h->basis);
     }
@@ -6860,8 +8904,15 @@ int AllocHamMem(HAMILTON *h, int hdim, int nbasis) {
   h->dim = hdim;
   h->iham = nhams;
   h->n_basis = nbasis;
+  h->nlev = hdim;
+  FreeHamiltonCSR(h);
 
-  h->msize = h->dim * h->n_basis + h->dim;
+  if (h->pdim > 0) {
+    /* grown to the kept levels after the distributed diagonalization */
+    h->msize = h->dim;
+  } else {
+    h->msize = h->dim * h->n_basis + h->dim;
+  }
   if (h->mixing == NULL) {
     h->msize0 = h->msize;
     h->mixing = (double *) malloc(sizeof(double)*(size_t)h->msize);
@@ -6871,6 +8922,22 @@ int AllocHamMem(HAMILTON *h, int hdim, int nbasis) {
     h->mixing = (double *) malloc(sizeof(double)*(size_t)h->msize);
   }
   if (!(h->mixing)) return -1;
+
+#if USE_MPI == 1 && defined(USE_SCALAPACK)
+  if (h->pdim > 0) {
+    h->hsize = 0;
+    if (h->basis == NULL) {
+      h->n_basis0 = h->n_basis;
+      h->basis = (int *) malloc(sizeof(int)*(size_t)(h->n_basis));
+    } else if (h->n_basis > h->n_basis0) {
+      h->n_basis0 = h->n_basis;
+      free(h->basis);
+      h->basis = (int *) malloc(sizeof(int)*(size_t)(h->n_basis));
+    }
+    if (!(h->basis)) return -1;
+    return AllocDistHam(h);
+  }
+#endif
   
   if (diag_mode > 0 && h->n_basis > diag_nbm) {
     h->hsp = malloc(sizeof(MATRIX));
@@ -6989,6 +9056,12 @@ int InitStructure(void) {
     _allhams[i].ondim = 0;
     _allhams[i].onbs = 0;
     _allhams[i].obs = NULL;
+    _allhams[i].rbs = NULL;
+    _allhams[i].rst = NULL;
+    _allhams[i].rham = NULL;
+    _allhams[i].rmix = NULL;
+    _allhams[i].rmap = NULL;
+    FreeRetainedHamilton(&_allhams[i]);
     _allhams[i].oham = NULL;
     _allhams[i].mmix = NULL;
     _allhams[i].perturb_iter = 0;
@@ -7017,6 +9090,7 @@ int ReinitStructure(int m) {
       int i;
       for (i = 0; i < MAX_SYMMETRIES; i++) {
 	_allhams[i].heff = NULL;
+	FreeRetainedHamilton(&_allhams[i]);
       }
     } else {
       CleanAngZArray();
@@ -7095,6 +9169,88 @@ void SetOptionStructure(char *s, char *sp, int ip, double dp) {
     diag_bignore = dp;
     return;
   }
+  if (0 == strcmp(s, "structure:full_mode")) {
+    full_mode = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:full_dmin")) {
+    full_dmin = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:full_nlev")) {
+    full_nlev = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:ham_block")) {
+    ham_block = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:angz_memo")) {
+    angz_memo = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:sched_mode")) {
+    sched_mode = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:pdiag_mode")) {
+    pdiag_mode = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:pdiag_dmin")) {
+    pdiag_dmin = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:pdiag_nb")) {
+    if (ip > 0) pdiag_nb = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:sparse_mode")) {
+    sparse_mode = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:sparse_dmin")) {
+    sparse_dmin = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:full_ewin")) {
+    full_ewin = dp/HARTREE_EV;
+    return;
+  }
+  if (0 == strcmp(s, "structure:davidson_nlev")) {
+    davidson_nlev = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:davidson_dmin")) {
+    davidson_dmin = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:davidson_nblock")) {
+    davidson_nblock = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:davidson_mmax")) {
+    davidson_mmax = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:davidson_maxiter")) {
+    davidson_maxiter = ip;
+    return;
+  }
+  if (0 == strcmp(s, "structure:davidson_tol")) {
+    davidson_tol = dp;
+    return;
+  }
+  if (0 == strcmp(s, "structure:incr_mode")) {
+    incr_mode = ip;
+    if (incr_mode == 0) {
+      int i;
+      for (i = 0; i < MAX_SYMMETRIES; i++) {
+	FreeRetainedHamilton(&_allhams[i]);
+      }
+    }
+    return;
+  }
   if (0 == strcmp(s, "structure:mix_cut")) {
     mix_cut = dp;
     return;
@@ -34,6 +34,7 @@ typedef struct _HAMILTON_ {
   int dim;
   int ndim;
   int n_basis;
+  int nlev;
   size_t hsize;
   size_t dsize;
   size_t dsize2;
@@ -46,6 +47,14 @@ typedef struct _HAMILTON_ {
   size_t liwork;
   int *basis;
   MATRIX *hsp;
+  size_t nnz;
+  size_t *csr_p;
+  int *csr_i;
+  double *csr_a;
+  int pdim;
+  int pdesc[9];
+  int pmloc, pnloc;
+  double *pham;
   double *hamilton;
   double *mixing;
   double *work;
@@ -57,6 +66,14 @@ typedef struct _HAMILTON_ {
   size_t ohsize;
   double *oham;
   int *obs;
+  int rdim;
+  int rnlev;
+  int *rbs;
+  STATE *rst;
+  double *rham;
+  double *rmix;
+  int *rmap;
+  unsigned long long rhash;
   double *mmix;
   int orig_dim;
   int exp_dim;
@@ -181,6 +198,8 @@ int ConstructHamiltonFrozen(int isym, int k, int *kg, int n,
 			    int nc, int *kc, int n0, int n1, int k0, int k1);
 void HamiltonElement1E2E(int isym, int isi, int isj, double *r1, double *r2);
 double HamiltonElement(int isym, int isi, int isj);
+void HamiltonElementBlock(int isym, int ni, int *isi, int nj, int *isj,
+			  int tri, double *x);
 double HamiltonElementFrozen(int ti, STATE *si, LEVEL *lev1,
 			     int tj, STATE *sj, LEVEL *lev2);
 double HamiltonElementFB(int ti, STATE *si, LEVEL *lev1,
@@ -282,6 +301,9 @@ void AddSlaterCoeff(double *c, double a, int n_shells,
 int WriteHamilton(char *fn, int ng0, int ng, int *kg, int ngp, int *kgp);
 int ReadHamilton(char *fn, int *ng0, int *ng, int **kg,
 		 int *ngp, int **kgp, int md);
+int SetHamiltonCheckpoint(char *fn);
+int SetAngZCache(char *fn);
+int FlushAngZCache(void);
 void GenEigen(HAMILTON *h, char *trans, char *jobz, int n, double *ap,
 	      double *w, double *wi, double *z,
 	      double *work, int lwork, int *info);
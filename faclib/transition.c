@@ -791,6 +791,9 @@ int SaveTransition0(int nlow, int *low, int nup, int *up,
 	  ((double)radt.radial_1e)/CLOCKS_PER_SEC,
 	  ((double)radt.radial_slater)/CLOCKS_PER_SEC,
 	  ((double)radt.radial_2e)/CLOCKS_PER_SEC);
+  fprintf(perform_log, "Yk: %6.1E, RPowTable: %ld, RPowCall: %ld\n",
+	  ((double)radt.radial_yk)/CLOCKS_PER_SEC,
+	  radt.nrpow_table, radt.nrpow_pow);
   fprintf(perform_log, "\n");
   fflush(perform_log);
 #endif /* PERFORM_STATISTICS */
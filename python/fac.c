@@ -1631,6 +1631,59 @@ static PyObject *PSolveBound(PyObject *self, PyObject *args) {
   return Py_BuildValue("d", orb->energy);
 }
 
+static PyObject *PSetHamiltonCheckpoint(PyObject *self, PyObject *args) {
+  char *fn;
+   
+  if (sfac_file) {
+    SFACStatement("SetHamiltonCheckpoint", args, NULL);
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  
+  if (!(PyArg_ParseTuple(args, "s", &fn))) {
+    return NULL;
+  }
+
+  SetHamiltonCheckpoint(fn);
+  
+  Py_INCREF(Py_None);
+  return Py_None;
+}
+
+static PyObject *PSetAngZCache(PyObject *self, PyObject *args) {
+  char *fn;
+   
+  if (sfac_file) {
+    SFACStatement("SetAngZCache", args, NULL);
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  
+  fn = "";
+  if (!(PyArg_ParseTuple(args, "|s", &fn))) {
+    return NULL;
+  }
+
+  SetAngZCache(fn);
+  
+  Py_INCREF(Py_None);
+  return Py_None;
+}
+
+static PyObject *PFlushAngZCache(PyObject *self, PyObject *args) {
+   
+  if (sfac_file) {
+    SFACStatement("FlushAngZCache", args, NULL);
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  FlushAngZCache();
+  
+  Py_INCREF(Py_None);
+  return Py_None;
+}
+
 static PyObject *PStructure(PyObject *self, PyObject *args) {
   int ng, i;
   int ip;
@@ -2727,7 +2780,7 @@ static PyObject *PCETableMSub(PyObject *self, PyObject *args) {
 
 static PyObject *PSetTEGrid(PyObject *self, PyObject *args) {
   int i, n;
-  double xg[MAXNTE];
+  double *xg;
   int ng, err;
   PyObject *p, *pi;
   double emin, emax;
@@ -2748,12 +2801,14 @@ static PyObject *PSetTEGrid(PyObject *self, PyObject *args) {
       return NULL;
     } else {
       ng = PySequence_Length(p);      
+      xg = (double *) malloc(sizeof(double)*ng);
       for (i = 0; i < ng; i++) {
 	pi = PySequence_GetItem(p, i);
 	xg[i] = PyFloat_AsDouble(pi)/HARTREE_EV;
 	Py_DECREF(pi);
       }
       err = SetCETEGridDetail(ng, xg);
+      free(xg);
     }
   } else if (n == 3) {
     if (!PyArg_ParseTuple(args, "idd", &ng, &emin, &emax)) 
@@ -2910,7 +2965,7 @@ static PyObject *PSetCEGridLimits(PyObject *self, PyObject *args) {
 
 static PyObject *PSetCEGrid(PyObject *self, PyObject *args) {
   int n;
-  double xg[MAXNE];
+  double *xg;
   int ng;
   double emin, emax, eth;
   PyObject *p, *pi;
@@ -2931,12 +2986,14 @@ static PyObject *PSetCEGrid(PyObject *self, PyObject *args) {
       err = SetCEEGrid(ng, -1.0, -1.0, 0.0);
     } else if (PyList_Check(p) || PyTuple_Check(p)) {
       ng = PySequence_Length(p);      
+      xg = (double *) malloc(sizeof(double)*ng);
       for (i = 0; i < ng; i++) {
 	pi = PySequence_GetItem(p, i);
 	xg[i] = PyFloat_AsDouble(pi)/HARTREE_EV;
 	Py_DECREF(pi);
       }
       err = SetCEEGridDetail(ng, xg);
+      free(xg);
     } else {
       return NULL;
     }
@@ -4197,6 +4254,21 @@ static PyObject *PTestIntegrate(PyObject *self, PyObject *args) {
   
 }
 
+static PyObject *PTestIntegrateKernels(PyObject *self, PyObject *args) { 
+  int k1, k2, n;
+
+  if (sfac_file) {
+    SFACStatement("TestIntegrateKernels", args, NULL);
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  if (!PyArg_ParseTuple(args, "ii", &k1, &k2)) return NULL;
+  n = TestIntegrateKernels(k1, k2);
+
+  return Py_BuildValue("i", n);
+}
+
 static PyObject *PCoulombBethe(PyObject *self, PyObject *args) { 
   char *s;
   double z, te, e1;
@@ -5291,6 +5363,58 @@ static PyObject *PLevelInfor(PyObject *self, PyObject *args) {
   }
 }
 
+static PyObject *PLevelTable(PyObject *self, PyObject *args) { 
+  PyObject *p;
+  char *fn;
+  int i, n;
+  EN_RECORD *r;
+  
+  if (!PyArg_ParseTuple(args, "s", &fn)) return NULL;
+
+  n = LevelTable(fn, &r);
+  if (n < 0) n = 0;
+  p = PyList_New(n);
+  for (i = 0; i < n; i++) {
+    if (r[i].ilev < 0) {
+      PyList_SetItem(p, i, Py_BuildValue("()"));
+    } else {
+      PyList_SetItem(p, i, Py_BuildValue("(diisss)", r[i].energy, 
+					 r[i].p, r[i].j, r[i].ncomplex,
+					 r[i].sname, r[i].name));
+    }
+  }
+  if (n > 0) free(r);
+  return p;
+}
+
+static PyObject *PFindLevelByName(PyObject *self, PyObject *args) { 
+  char *fn, *nc, *cnr, *cr;
+  int nele, k;
+  
+  if (!PyArg_ParseTuple(args, "sisss", &fn, &nele, &nc, &cnr, &cr)) 
+    return NULL;
+
+  k = FindLevelByName(fn, nele, nc, cnr, cr);
+  return Py_BuildValue("i", k);
+}
+
+static PyObject *PFindLevelsBySName(PyObject *self, PyObject *args) { 
+  PyObject *p;
+  char *fn, *nc, *cnr;
+  int nele, i, n, *ilev;
+  
+  if (!PyArg_ParseTuple(args, "siss", &fn, &nele, &nc, &cnr)) return NULL;
+
+  n = FindLevelsBySName(fn, nele, nc, cnr, &ilev);
+  if (n < 0) n = 0;
+  p = PyList_New(n);
+  for (i = 0; i < n; i++) {
+    PyList_SetItem(p, i, Py_BuildValue("i", ilev[i]));
+  }
+  if (n > 0) free(ilev);
+  return p;
+}
+
 static PyObject *PInterpCross(PyObject *self, PyObject *args) { 
   PyObject *p;
   int i, negy, i0, i1, mp;
@@ -5952,6 +6076,40 @@ static PyObject *PRestorePotential(PyObject *self, PyObject *args) {
 }
  
  
+static PyObject *PSetRadialDB(PyObject *self, PyObject *args) {
+  char *fn;
+   
+  if (sfac_file) {
+    SFACStatement("SetRadialDB", args, NULL);
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  
+  if (!(PyArg_ParseTuple(args, "s", &fn))) {
+    return NULL;
+  }
+
+  SetRadialDB(fn);
+  
+  Py_INCREF(Py_None);
+  return Py_None;
+}
+ 
+static PyObject *PFlushRadialDB(PyObject *self, PyObject *args) {
+  long nhit, nmiss;
+
+  if (sfac_file) {
+    SFACStatement("FlushRadialDB", args, NULL);
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  
+  FlushRadialDB();
+  RadialDBStats(&nhit, &nmiss);
+  
+  return Py_BuildValue("(ll)", nhit, nmiss);
+}
+ 
 static PyObject *PModifyPotential(PyObject *self, PyObject *args) {
   char *fn;
   POTENTIAL *p;
@@ -6301,6 +6459,9 @@ static struct PyMethodDef fac_methods[] = {
   {"MemENTable", PMemENTable, METH_VARARGS},
   {"LevelInfor", PLevelInfor, METH_VARARGS},
   {"LevelInfo", PLevelInfor, METH_VARARGS},
+  {"LevelTable", PLevelTable, METH_VARARGS},
+  {"FindLevelByName", PFindLevelByName, METH_VARARGS},
+  {"FindLevelsBySName", PFindLevelsBySName, METH_VARARGS},
   {"OptimizeRadial", POptimizeRadial, METH_VARARGS},
   {"PrepAngular", PPrepAngular, METH_VARARGS},
   {"RadialOverlaps", PRadialOverlaps, METH_VARARGS},
@@ -6387,11 +6548,15 @@ static struct PyMethodDef fac_methods[] = {
   {"SetUsrPEGridType", PSetUsrPEGridType, METH_VARARGS},
   {"SolveBound", PSolveBound, METH_VARARGS},
   {"SortLevels", PSortLevels, METH_VARARGS},
+  {"SetHamiltonCheckpoint", PSetHamiltonCheckpoint, METH_VARARGS},
+  {"SetAngZCache", PSetAngZCache, METH_VARARGS},
+  {"FlushAngZCache", PFlushAngZCache, METH_VARARGS},
   {"Structure", PStructure, METH_VARARGS},
   {"TestAngular", PTestAngular, METH_VARARGS},
   {"CoulombBethe", PCoulombBethe, METH_VARARGS}, 
   {"TestHamilton", PTestHamilton, METH_VARARGS}, 
   {"TestIntegrate", PTestIntegrate, METH_VARARGS}, 
+  {"TestIntegrateKernels", PTestIntegrateKernels, METH_VARARGS}, 
   {"TestMyArray", PTestMyArray, METH_VARARGS},        
   {"ReportMultiStats", PReportMultiStats, METH_VARARGS},     
   {"ElectronDensity", PElectronDensity, METH_VARARGS},  
@@ -6441,6 +6606,8 @@ static struct PyMethodDef fac_methods[] = {
   {"PrintCXTarget", PPrintCXTarget, METH_VARARGS},
   {"SavePotential", PSavePotential, METH_VARARGS},
   {"RestorePotential", PRestorePotential, METH_VARARGS},
+  {"SetRadialDB", PSetRadialDB, METH_VARARGS},
+  {"FlushRadialDB", PFlushRadialDB, METH_VARARGS},
   {"ModifyPotential", PModifyPotential, METH_VARARGS},
   {"WallTime", PWallTime, METH_VARARGS},
   {"InitializeMPI", PInitializeMPI, METH_VARARGS},
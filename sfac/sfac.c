@@ -1986,7 +1986,7 @@ static int PSetAvgConfig(int argc, char *argv[], int argt[],
 static int PSetCEGrid(int argc, char *argv[], int argt[], 
 		      ARRAY *variables) {
   int n, ng, i, err;
-  double xg[MAXNE];
+  double xg[MAXNARGS];
   double emin, emax, eth;
   char *vg[MAXNARGS];
   int ig[MAXNARGS];
@@ -2109,7 +2109,7 @@ static int PSetCEGridType(int argc, char *argv[], int argt[],
 static int PSetTEGrid(int argc, char *argv[], int argt[], 
 		      ARRAY *variables) {
   int i, n;
-  double xg[MAXNTE];
+  double xg[MAXNARGS];
   int ng, err;
   double emin, emax;
   char *vg[MAXNARGS];
@@ -3502,6 +3502,31 @@ static int PCutMixing(int argc, char *argv[], int argt[],
 
   return 0;  
 }
+static int PSetHamiltonCheckpoint(int argc, char *argv[], int argt[], 
+				  ARRAY *variables) {
+  if (argc != 1) return -1;
+  SetHamiltonCheckpoint(argv[0]);
+
+  return 0;
+}
+
+static int PSetAngZCache(int argc, char *argv[], int argt[], 
+			 ARRAY *variables) {
+  if (argc > 1) return -1;
+  if (argc == 0) SetAngZCache("");
+  else SetAngZCache(argv[0]);
+
+  return 0;
+}
+
+static int PFlushAngZCache(int argc, char *argv[], int argt[], 
+			   ARRAY *variables) {
+  if (argc != 0) return -1;
+  FlushAngZCache();
+
+  return 0;
+}
+
 static int PStructure(int argc, char *argv[], int argt[], 
 		      ARRAY *variables) {
   int ng, ngp;
@@ -3657,6 +3682,17 @@ static int PTestIntegrate(int argc, char *argv[], int argt[],
   return 0;
 }
 
+static int PTestIntegrateKernels(int argc, char *argv[], int argt[], 
+				 ARRAY *variables) {
+  int k1, k2;
+
+  if (argc != 2) return -1;
+  k1 = atoi(argv[0]);
+  k2 = atoi(argv[1]);
+  TestIntegrateKernels(k1, k2);
+  return 0;
+}
+
 static int PReportMultiStats(int argc, char *argv[], int argt[], 
 			     ARRAY *variables) {
   ReportMultiStats();
@@ -4764,6 +4800,22 @@ static int PRestorePotential(int argc, char *argv[], int argt[],
   return 0;
 } 
  
+static int PSetRadialDB(int argc, char *argv[], int argt[], 
+			ARRAY *variables) {
+  if (argc != 1) return -1;
+  SetRadialDB(argv[0]);
+
+  return 0;
+} 
+ 
+static int PFlushRadialDB(int argc, char *argv[], int argt[], 
+			  ARRAY *variables) {
+  if (argc != 0) return -1;
+  FlushRadialDB();
+
+  return 0;
+} 
+ 
 static int PModifyPotential(int argc, char *argv[], int argt[], 
 			  ARRAY *variables) {
   char *fn;
@@ -5311,10 +5363,14 @@ static METHOD methods[] = {
   {"SetUsrPEGridType", PSetUsrPEGridType, METH_VARARGS},
   {"SolveBound", PSolveBound, METH_VARARGS},
   {"SortLevels", PSortLevels, METH_VARARGS},
+  {"SetHamiltonCheckpoint", PSetHamiltonCheckpoint, METH_VARARGS},
+  {"SetAngZCache", PSetAngZCache, METH_VARARGS},
+  {"FlushAngZCache", PFlushAngZCache, METH_VARARGS},
   {"Structure", PStructure, METH_VARARGS},
   {"CoulombBethe", PCoulombBethe, METH_VARARGS}, 
   {"TestAngular", PTestAngular, METH_VARARGS}, 
   {"TestIntegrate", PTestIntegrate, METH_VARARGS}, 
+  {"TestIntegrateKernels", PTestIntegrateKernels, METH_VARARGS}, 
   {"TestMyArray", PTestMyArray, METH_VARARGS},   
   {"ReportMultiStats", PReportMultiStats, METH_VARARGS},   
   {"ElectronDensity", PElectronDensity, METH_VARARGS},  
@@ -5352,6 +5408,8 @@ static METHOD methods[] = {
   {"PrintCXTarget", PPrintCXTarget, METH_VARARGS},
   {"SavePotential", PSavePotential, METH_VARARGS},
   {"RestorePotential", PRestorePotential, METH_VARARGS},
+  {"SetRadialDB", PSetRadialDB, METH_VARARGS},
+  {"FlushRadialDB", PFlushRadialDB, METH_VARARGS},
   {"ModifyPotential", PModifyPotential, METH_VARARGS},
   {"WallTime", PWallTime, METH_VARARGS},
   {"InitializeMPI", PInitializeMPI, METH_VARARGS},